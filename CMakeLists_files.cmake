@@ -75,14 +75,19 @@ list (APPEND MAIN_SOURCE_FILES
 # find tests -name '*.cpp' -a ! -wholename '*/not-unit/*' -printf '\t%p\n' | sort
 list (APPEND TEST_SOURCE_FILES
   tests/test_autodiffhelpers.cpp
+  tests/test_autodiffarena.cpp
+  tests/test_autodiffkernels.cpp
   tests/test_autodiffmatrix.cpp
   tests/test_block.cpp
   tests/test_boprops_ad.cpp
+  tests/test_localautodiff.cpp
   tests/test_rateconverter.cpp
   tests/test_span.cpp
   tests/test_syntax.cpp
   tests/test_scalar_mult.cpp
+  tests/test_sparseproductcache.cpp
   tests/test_transmissibilitymultipliers.cpp
+  tests/test_wellblockmatrix.cpp
   tests/test_welldensitysegmented.cpp
   tests/test_vfpproperties.cpp
   tests/test_singlecellsolves.cpp
@@ -141,11 +146,14 @@ list (APPEND PROGRAM_SOURCE_FILES
 # find opm -name '*.h*' -a ! -name '*-pch.hpp' -printf '\t%p\n' | sort
 list (APPEND PUBLIC_HEADER_FILES
   opm/autodiff/AdditionalObjectDeleter.hpp
+  opm/autodiff/AutoDiffArena.hpp
   opm/autodiff/AutoDiffBlock.hpp
   opm/autodiff/AutoDiffHelpers.hpp
+  opm/autodiff/AutoDiffKernels.hpp
   opm/autodiff/AutoDiffMatrix.hpp
   opm/autodiff/AutoDiff.hpp
   opm/autodiff/BackupRestore.hpp
+  opm/autodiff/BlackoilCPRPreconditioner.hpp
   opm/autodiff/BlackoilDetails.hpp
   opm/autodiff/BlackoilModel.hpp
   opm/autodiff/BlackoilModelBase.hpp
@@ -175,10 +183,12 @@ list (APPEND PUBLIC_HEADER_FILES
   opm/autodiff/FlowMainPolymer.hpp
   opm/autodiff/FlowMainSequential.hpp
   opm/autodiff/FlowMainSolvent.hpp
+  opm/autodiff/FusedWellMatrixProduct.hpp
   opm/autodiff/GeoProps.hpp
   opm/autodiff/GridHelpers.hpp
   opm/autodiff/GridInit.hpp
   opm/autodiff/ImpesTPFAAD.hpp
+  opm/autodiff/IndexSelection.hpp
   opm/autodiff/ISTLSolver.hpp
   opm/autodiff/IterationReport.hpp
   opm/autodiff/moduleVersion.hpp
@@ -190,11 +200,13 @@ list (APPEND PUBLIC_HEADER_FILES
   opm/autodiff/NonlinearSolver.hpp
   opm/autodiff/NonlinearSolver_impl.hpp
   opm/autodiff/LinearisedBlackoilResidual.hpp
+  opm/autodiff/LocalAutoDiff.hpp
   opm/autodiff/ParallelDebugOutput.hpp
   opm/autodiff/ParallelOverlappingILU0.hpp
   opm/autodiff/ParallelRestrictedAdditiveSchwarz.hpp
   opm/autodiff/RateConverter.hpp
   opm/autodiff/RedistributeDataHandles.hpp
+  opm/autodiff/ResampledTableLinear.hpp
   opm/autodiff/SimFIBODetails.hpp
   opm/autodiff/SimulatorBase.hpp
   opm/autodiff/SimulatorBase_impl.hpp
@@ -222,12 +234,15 @@ list (APPEND PUBLIC_HEADER_FILES
   opm/autodiff/MultisegmentWells.hpp
   opm/autodiff/MultisegmentWells_impl.hpp
   opm/autodiff/WellHelpers.hpp
+  opm/autodiff/WellBlockMatrix.hpp
   opm/autodiff/StandardWells.hpp
   opm/autodiff/StandardWells_impl.hpp
   opm/autodiff/StandardWellsDense.hpp
   opm/autodiff/StandardWellsSolvent.hpp
   opm/autodiff/StandardWellsSolvent_impl.hpp
   opm/autodiff/MissingFeatures.hpp
+  opm/autodiff/MixedPrecisionPreconditioner.hpp
+  opm/autodiff/SparseProductCache.hpp
   opm/autodiff/ThreadHandle.hpp
   opm/polymer/CompressibleTpfaPolymer.hpp
   opm/polymer/GravityColumnSolverPolymer.hpp
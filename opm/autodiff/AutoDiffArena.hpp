@@ -0,0 +1,299 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_AUTODIFFARENA_HEADER_INCLUDED
+#define OPM_AUTODIFFARENA_HEADER_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace Opm
+{
+
+    /**
+     * Bump allocator for the storage of automatic differentiation
+     * temporaries.
+     *
+     * Memory is handed out from large chunks by advancing an offset, so
+     * the many short-lived diagonal jacobians created while assembling
+     * the residual do not each go through malloc and free. Every chunk
+     * counts the allocations living in it; once they are all released
+     * the chunk is rewound and reused. reset() is called at the start of
+     * each nonlinear iteration and rewinds all chunks that are free at
+     * that point.
+     *
+     * Allocations may outlive the arena and may be released from any
+     * thread: a chunk is only returned to the system when both the arena
+     * and the last allocation in it are gone. Allocating is only done by
+     * the thread which installed the arena with a Scope; allocations
+     * outside any scope fall back to malloc.
+     */
+    class AutoDiffArena
+    {
+    public:
+        /// Counters describing the allocation traffic through the arena.
+        struct Statistics
+        {
+            /// Allocations served from the arena.
+            std::size_t allocations = 0;
+            /// Bytes requested by these allocations.
+            std::size_t bytes = 0;
+            /// Chunks allocated from the system, i.e. the mallocs done
+            /// by the arena itself.
+            std::size_t chunkAllocations = 0;
+            /// Largest number of bytes held in chunks.
+            std::size_t peakChunkBytes = 0;
+        };
+
+        /// Makes an arena the one used by the calling thread while the
+        /// scope is alive.
+        class Scope
+        {
+        public:
+            explicit Scope(AutoDiffArena& arena)
+                : previous_(current())
+            {
+                current() = &arena;
+            }
+
+            ~Scope()
+            {
+                current() = previous_;
+            }
+
+        private:
+            Scope(const Scope&);
+            Scope& operator=(const Scope&);
+
+            AutoDiffArena* previous_;
+        };
+
+        /// Creates an arena allocating chunks of at least chunkBytes.
+        explicit AutoDiffArena(const std::size_t chunkBytes = std::size_t(1) << 22)
+            : chunkBytes_(chunkBytes),
+              current_(nullptr),
+              chunkBytesHeld_(0)
+        {
+        }
+
+        ~AutoDiffArena()
+        {
+            for (Chunk* chunk : chunks_) {
+                release(chunk);
+            }
+        }
+
+        /// Rewinds all chunks without live allocations and restarts the
+        /// counters of iterationStatistics().
+        void reset()
+        {
+            current_ = nullptr;
+            for (Chunk* chunk : chunks_) {
+                if (isFree(chunk)) {
+                    chunk->used = 0;
+                    if (current_ == nullptr) {
+                        current_ = chunk;
+                    }
+                }
+            }
+            thisIteration_ = Statistics();
+        }
+
+        /// Counters since construction.
+        const Statistics& statistics() const { return total_; }
+
+        /// Counters since the last call of reset().
+        const Statistics& iterationStatistics() const { return thisIteration_; }
+
+        /// The arena of the calling thread, or null if none is installed.
+        static AutoDiffArena*& current()
+        {
+            static thread_local AutoDiffArena* arena = nullptr;
+            return arena;
+        }
+
+        /// Allocates bytes from the current arena, or from the heap if
+        /// there is none.
+        static void* allocate(const std::size_t bytes)
+        {
+            AutoDiffArena* arena = current();
+            if (arena == nullptr) {
+                void* raw = std::malloc(headerBytes + bytes);
+                if (raw == nullptr) {
+                    throw std::bad_alloc();
+                }
+                *static_cast<Chunk**>(raw) = nullptr;
+                return static_cast<char*>(raw) + headerBytes;
+            }
+            return arena->allocateFromChunk(bytes);
+        }
+
+        /// Releases memory obtained from allocate().
+        static void deallocate(void* p)
+        {
+            if (p == nullptr) {
+                return;
+            }
+            char* raw = static_cast<char*>(p) - headerBytes;
+            Chunk* chunk = *reinterpret_cast<Chunk**>(raw);
+            if (chunk == nullptr) {
+                std::free(raw);
+            } else {
+                release(chunk);
+            }
+        }
+
+    private:
+        AutoDiffArena(const AutoDiffArena&);
+        AutoDiffArena& operator=(const AutoDiffArena&);
+
+        // Every allocation is preceded by a header pointing to its chunk,
+        // which also keeps the returned memory 16 byte aligned.
+        static const std::size_t headerBytes = 16;
+
+        struct Chunk
+        {
+            // One reference held by the arena plus one per allocation.
+            std::atomic<std::size_t> refs;
+            std::size_t capacity;
+            std::size_t used;
+            char* data;
+        };
+
+        static std::size_t roundUp(const std::size_t bytes)
+        {
+            return (bytes + headerBytes - 1) / headerBytes * headerBytes;
+        }
+
+        static bool isFree(Chunk* chunk)
+        {
+            return chunk->refs.load(std::memory_order_acquire) == 1;
+        }
+
+        static void release(Chunk* chunk)
+        {
+            if (chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::free(chunk->data);
+                delete chunk;
+            }
+        }
+
+        void* allocateFromChunk(const std::size_t bytes)
+        {
+            const std::size_t needed = headerBytes + roundUp(bytes);
+            if (current_ != nullptr && isFree(current_)) {
+                current_->used = 0;
+            }
+            if (current_ == nullptr || current_->used + needed > current_->capacity) {
+                current_ = nextChunk(needed);
+            }
+
+            char* raw = current_->data + current_->used;
+            current_->used += needed;
+            current_->refs.fetch_add(1, std::memory_order_relaxed);
+            *reinterpret_cast<Chunk**>(raw) = current_;
+
+            count(total_, bytes);
+            count(thisIteration_, bytes);
+            return raw + headerBytes;
+        }
+
+        Chunk* nextChunk(const std::size_t needed)
+        {
+            for (Chunk* chunk : chunks_) {
+                if (chunk != current_ && chunk->capacity >= needed && isFree(chunk)) {
+                    chunk->used = 0;
+                    return chunk;
+                }
+            }
+
+            Chunk* chunk = new Chunk;
+            chunk->capacity = std::max(chunkBytes_, needed);
+            chunk->used = 0;
+            chunk->data = static_cast<char*>(std::malloc(chunk->capacity));
+            if (chunk->data == nullptr) {
+                delete chunk;
+                throw std::bad_alloc();
+            }
+            chunk->refs.store(1, std::memory_order_relaxed);
+            chunks_.push_back(chunk);
+
+            chunkBytesHeld_ += chunk->capacity;
+            ++total_.chunkAllocations;
+            ++thisIteration_.chunkAllocations;
+            total_.peakChunkBytes = std::max(total_.peakChunkBytes, chunkBytesHeld_);
+            thisIteration_.peakChunkBytes = std::max(thisIteration_.peakChunkBytes, chunkBytesHeld_);
+            return chunk;
+        }
+
+        static void count(Statistics& stats, const std::size_t bytes)
+        {
+            ++stats.allocations;
+            stats.bytes += bytes;
+        }
+
+        std::size_t chunkBytes_;
+        std::vector<Chunk*> chunks_;
+        Chunk* current_;
+        std::size_t chunkBytesHeld_;
+        Statistics total_;
+        Statistics thisIteration_;
+    };
+
+
+
+    /**
+     * Standard allocator drawing from the arena of the calling thread,
+     * see AutoDiffArena. It is stateless, so containers using it can be
+     * swapped and moved freely.
+     */
+    template <class T>
+    class AutoDiffArenaAllocator
+    {
+    public:
+        typedef T value_type;
+
+        AutoDiffArenaAllocator() {}
+        template <class U>
+        AutoDiffArenaAllocator(const AutoDiffArenaAllocator<U>&) {}
+
+        T* allocate(const std::size_t n)
+        {
+            return static_cast<T*>(AutoDiffArena::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, std::size_t)
+        {
+            AutoDiffArena::deallocate(p);
+        }
+    };
+
+    template <class T, class U>
+    inline bool operator==(const AutoDiffArenaAllocator<T>&, const AutoDiffArenaAllocator<U>&) { return true; }
+
+    template <class T, class U>
+    inline bool operator!=(const AutoDiffArenaAllocator<T>&, const AutoDiffArenaAllocator<U>&) { return false; }
+
+} // namespace Opm
+
+#endif // OPM_AUTODIFFARENA_HEADER_INCLUDED
@@ -265,128 +265,174 @@ namespace Opm
             return *this;
         }
 
-        /// Elementwise operator +
-        AutoDiffBlock operator+(const AutoDiffBlock& rhs) const
+        /// Elementwise operator += with a constant.
+        AutoDiffBlock& operator+=(const V& rhs)
         {
-            if (jac_.empty() && rhs.jac_.empty()) {
-                return constant(val_ + rhs.val_);
-            }
-            if (jac_.empty()) {
-                return val_ + rhs;
-            }
-            if (rhs.jac_.empty()) {
-                return *this + rhs.val_;
-            }
-            std::vector<M> jac = jac_;
-            assert(numBlocks() == rhs.numBlocks());
-            int num_blocks = numBlocks();
+            val_ += rhs;
+            return *this;
+        }
+
+        /// Elementwise operator -= with a constant.
+        AutoDiffBlock& operator-=(const V& rhs)
+        {
+            val_ -= rhs;
+            return *this;
+        }
+
+        /// Elementwise operator *= with a constant.
+        /// The jacobians are scaled in place.
+        AutoDiffBlock& operator*=(const V& rhs)
+        {
+            const int num_blocks = numBlocks();
 #pragma omp parallel for schedule(static)
             for (int block = 0; block < num_blocks; ++block) {
-                assert(jac[block].rows() == rhs.jac_[block].rows());
-                assert(jac[block].cols() == rhs.jac_[block].cols());
-                jac[block] += rhs.jac_[block];
+                jac_[block].scaleRows(rhs);
             }
-            return function(val_ + rhs.val_, std::move(jac));
+            val_ *= rhs;
+            return *this;
         }
 
-        /// Elementwise operator -
-        AutoDiffBlock operator-(const AutoDiffBlock& rhs) const
+        /// Elementwise operator /= with a constant.
+        /// The jacobians are scaled in place.
+        AutoDiffBlock& operator/=(const V& rhs)
         {
-            if (jac_.empty() && rhs.jac_.empty()) {
-                return constant(val_ - rhs.val_);
-            }
-            if (jac_.empty()) {
-                return val_ - rhs;
-            }
-            if (rhs.jac_.empty()) {
-                return *this - rhs.val_;
-            }
-            std::vector<M> jac = jac_;
-            assert(numBlocks() == rhs.numBlocks());
-            int num_blocks = numBlocks();
+            if (!jac_.empty()) {
+                const V inv = rhs.inverse();
+                const int num_blocks = numBlocks();
 #pragma omp parallel for schedule(static)
-            for (int block = 0; block < num_blocks; ++block) {
-                assert(jac[block].rows() == rhs.jac_[block].rows());
-                assert(jac[block].cols() == rhs.jac_[block].cols());
-                jac[block] -= rhs.jac_[block];
+                for (int block = 0; block < num_blocks; ++block) {
+                    jac_[block].scaleRows(inv);
+                }
             }
-            return function(val_ - rhs.val_, std::move(jac));
+            val_ /= rhs;
+            return *this;
         }
 
-        /// Elementwise operator *
-        AutoDiffBlock operator*(const AutoDiffBlock& rhs) const
+        /// Operator *= with a scalar.
+        AutoDiffBlock& operator*=(const Scalar& rhs)
         {
-            if (jac_.empty() && rhs.jac_.empty()) {
-                return constant(val_ * rhs.val_);
+            for (M& jac : jac_) {
+                jac *= rhs;
             }
-            if (jac_.empty()) {
-                return val_ * rhs;
+            val_ *= rhs;
+            return *this;
+        }
+
+        // The binary operators below come in two variants. If the left
+        // operand is a temporary, e.g. an intermediate result of an
+        // expression like a * b * (c - d), its values and jacobians are
+        // updated in place and moved into the result. Chains of operations
+        // therefore allocate storage only once, and the jacobians of each
+        // step are scaled in place instead of being formed by products with
+        // diagonal matrices. Otherwise, the left operand is copied first.
+
+        /// Elementwise operator +
+        AutoDiffBlock operator+(const AutoDiffBlock& rhs) const &
+        {
+            AutoDiffBlock result(*this);
+            return std::move(result) + rhs;
+        }
+
+        /// Elementwise operator + reusing the storage of this temporary.
+        AutoDiffBlock operator+(const AutoDiffBlock& rhs) &&
+        {
+            *this += rhs;
+            return std::move(*this);
+        }
+
+        /// Elementwise operator -
+        AutoDiffBlock operator-(const AutoDiffBlock& rhs) const &
+        {
+            AutoDiffBlock result(*this);
+            return std::move(result) - rhs;
+        }
+
+        /// Elementwise operator - reusing the storage of this temporary.
+        AutoDiffBlock operator-(const AutoDiffBlock& rhs) &&
+        {
+            *this -= rhs;
+            return std::move(*this);
+        }
+
+        /// Elementwise operator *
+        AutoDiffBlock operator*(const AutoDiffBlock& rhs) const &
+        {
+            if (jac_.empty() && !rhs.jac_.empty()) {
+                AutoDiffBlock result(rhs);
+                result *= val_;
+                return result;
             }
+            AutoDiffBlock result(*this);
+            return std::move(result) * rhs;
+        }
+
+        /// Elementwise operator * reusing the storage of this temporary.
+        AutoDiffBlock operator*(const AutoDiffBlock& rhs) &&
+        {
             if (rhs.jac_.empty()) {
-                return *this * rhs.val_;
+                *this *= rhs.val_;
+                return std::move(*this);
+            }
+            if (jac_.empty()) {
+                AutoDiffBlock result(rhs);
+                result *= val_;
+                return result;
             }
-            int num_blocks = numBlocks();
-            std::vector<M> jac(num_blocks);
+            const int num_blocks = numBlocks();
             assert(numBlocks() == rhs.numBlocks());
-            M D1(val_.matrix().asDiagonal());
-            M D2(rhs.val_.matrix().asDiagonal());
 #pragma omp parallel for schedule(dynamic)
             for (int block = 0; block < num_blocks; ++block) {
                 assert(jac_[block].rows() == rhs.jac_[block].rows());
                 assert(jac_[block].cols() == rhs.jac_[block].cols());
-                if( jac_[block].nonZeros() == 0 && rhs.jac_[block].nonZeros() == 0 ) {
-                    jac[block] = M( D2.rows(), jac_[block].cols() );
-                }
-                else if( jac_[block].nonZeros() == 0 )
-                    jac[block] = D1*rhs.jac_[block];
-                else if ( rhs.jac_[block].nonZeros() == 0 ) {
-                    jac[block] = D2*jac_[block];
-                }
-                else {
-                    jac[block]  = D2*jac_[block];
-                    jac[block] += D1*rhs.jac_[block];
+                // (uv)' = v u' + u v'
+                jac_[block].scaleRows(rhs.val_);
+                if (rhs.jac_[block].nonZeros() != 0) {
+                    M udv(rhs.jac_[block]);
+                    jac_[block] += udv.scaleRows(val_);
                 }
             }
-            return function(val_ * rhs.val_, std::move(jac));
+            val_ *= rhs.val_;
+            return std::move(*this);
         }
 
         /// Elementwise operator /
-        AutoDiffBlock operator/(const AutoDiffBlock& rhs) const
+        AutoDiffBlock operator/(const AutoDiffBlock& rhs) const &
+        {
+            AutoDiffBlock result(*this);
+            return std::move(result) / rhs;
+        }
+
+        /// Elementwise operator / reusing the storage of this temporary.
+        AutoDiffBlock operator/(const AutoDiffBlock& rhs) &&
         {
-            if (jac_.empty() && rhs.jac_.empty()) {
-                return constant(val_ / rhs.val_);
+            if (rhs.jac_.empty()) {
+                *this /= rhs.val_;
+                return std::move(*this);
             }
+            // (u/v)' = u'/v - (u/v^2) v'. This agrees with the quotient
+            // rule form (v u' - u v')/v^2 only up to rounding.
+            const V inv = rhs.val_.inverse();
+            const V factor = -val_ * inv * inv;
             if (jac_.empty()) {
-                return val_ / rhs;
-            }
-            if (rhs.jac_.empty()) {
-                return *this / rhs.val_;
+                AutoDiffBlock result(rhs);
+                result *= factor;
+                result.val_ = val_ * inv;
+                return result;
             }
-            int num_blocks = numBlocks();
-            std::vector<M> jac(num_blocks);
+            const int num_blocks = numBlocks();
             assert(numBlocks() == rhs.numBlocks());
-            M D1(val_.matrix().asDiagonal());
-            M D2(rhs.val_.matrix().asDiagonal());
-            M D3((1.0/(rhs.val_*rhs.val_)).matrix().asDiagonal());
 #pragma omp parallel for schedule(dynamic)
             for (int block = 0; block < num_blocks; ++block) {
                 assert(jac_[block].rows() == rhs.jac_[block].rows());
                 assert(jac_[block].cols() == rhs.jac_[block].cols());
-                if( jac_[block].nonZeros() == 0 && rhs.jac_[block].nonZeros() == 0 ) {
-                    jac[block] = M( D3.rows(), jac_[block].cols() );
-                }
-                else if( jac_[block].nonZeros() == 0 ) {
-                    jac[block] =  D3 * ( D1*rhs.jac_[block]) * (-1.0);
-                }
-                else if ( rhs.jac_[block].nonZeros() == 0 )
-                {
-                    jac[block] = D3 * (D2*jac_[block]);
-                }
-                else {
-                    jac[block] = D3 * (D2*jac_[block] + (D1*rhs.jac_[block]*(-1.0)));
+                jac_[block].scaleRows(inv);
+                if (rhs.jac_[block].nonZeros() != 0) {
+                    M udv(rhs.jac_[block]);
+                    jac_[block] += udv.scaleRows(factor);
                 }
             }
-            return function(val_ / rhs.val_, std::move(jac));
+            val_ /= rhs.val_;
+            return std::move(*this);
         }
 
         /// I/O.
@@ -523,7 +569,19 @@ namespace Opm
     AutoDiffBlock<Scalar> operator*(const typename AutoDiffBlock<Scalar>::V& lhs,
                                     const AutoDiffBlock<Scalar>& rhs)
     {
-        return AutoDiffBlock<Scalar>::constant(lhs, rhs.blockPattern()) * rhs;
+        AutoDiffBlock<Scalar> result(rhs);
+        result *= lhs;
+        return result;
+    }
+
+
+    /// Elementwise multiplication with constant on the left, reusing a temporary.
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator*(const typename AutoDiffBlock<Scalar>::V& lhs,
+                                    AutoDiffBlock<Scalar>&& rhs)
+    {
+        rhs *= lhs;
+        return std::move(rhs);
     }
 
 
@@ -536,12 +594,33 @@ namespace Opm
     }
 
 
+    /// Elementwise multiplication with constant on the right, reusing a temporary.
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator*(AutoDiffBlock<Scalar>&& lhs,
+                                    const typename AutoDiffBlock<Scalar>::V& rhs)
+    {
+        return rhs * std::move(lhs); // Commutative operation.
+    }
+
+
     /// Elementwise addition with constant on the left.
     template <typename Scalar>
     AutoDiffBlock<Scalar> operator+(const typename AutoDiffBlock<Scalar>::V& lhs,
                                     const AutoDiffBlock<Scalar>& rhs)
     {
-        return AutoDiffBlock<Scalar>::constant(lhs, rhs.blockPattern()) + rhs;
+        AutoDiffBlock<Scalar> result(rhs);
+        result += lhs;
+        return result;
+    }
+
+
+    /// Elementwise addition with constant on the left, reusing a temporary.
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator+(const typename AutoDiffBlock<Scalar>::V& lhs,
+                                    AutoDiffBlock<Scalar>&& rhs)
+    {
+        rhs += lhs;
+        return std::move(rhs);
     }
 
 
@@ -554,12 +633,33 @@ namespace Opm
     }
 
 
+    /// Elementwise addition with constant on the right, reusing a temporary.
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator+(AutoDiffBlock<Scalar>&& lhs,
+                                    const typename AutoDiffBlock<Scalar>::V& rhs)
+    {
+        return rhs + std::move(lhs); // Commutative operation.
+    }
+
+
     /// Elementwise subtraction with constant on the left.
     template <typename Scalar>
     AutoDiffBlock<Scalar> operator-(const typename AutoDiffBlock<Scalar>::V& lhs,
                                     const AutoDiffBlock<Scalar>& rhs)
     {
-        return AutoDiffBlock<Scalar>::constant(lhs, rhs.blockPattern()) - rhs;
+        AutoDiffBlock<Scalar> result(rhs);
+        return lhs - std::move(result);
+    }
+
+
+    /// Elementwise subtraction with constant on the left, reusing a temporary.
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator-(const typename AutoDiffBlock<Scalar>::V& lhs,
+                                    AutoDiffBlock<Scalar>&& rhs)
+    {
+        rhs *= Scalar(-1.0);
+        rhs += lhs;
+        return std::move(rhs);
     }
 
 
@@ -568,7 +668,19 @@ namespace Opm
     AutoDiffBlock<Scalar> operator-(const AutoDiffBlock<Scalar>& lhs,
                                     const typename AutoDiffBlock<Scalar>::V& rhs)
     {
-        return lhs - AutoDiffBlock<Scalar>::constant(rhs, lhs.blockPattern());
+        AutoDiffBlock<Scalar> result(lhs);
+        result -= rhs;
+        return result;
+    }
+
+
+    /// Elementwise subtraction with constant on the right, reusing a temporary.
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator-(AutoDiffBlock<Scalar>&& lhs,
+                                    const typename AutoDiffBlock<Scalar>::V& rhs)
+    {
+        lhs -= rhs;
+        return std::move(lhs);
     }
 
 
@@ -577,7 +689,7 @@ namespace Opm
     AutoDiffBlock<Scalar> operator/(const typename AutoDiffBlock<Scalar>::V& lhs,
                                     const AutoDiffBlock<Scalar>& rhs)
     {
-        return AutoDiffBlock<Scalar>::constant(lhs, rhs.blockPattern()) / rhs;
+        return AutoDiffBlock<Scalar>::constant(lhs) / rhs;
     }
 
 
@@ -586,7 +698,19 @@ namespace Opm
     AutoDiffBlock<Scalar> operator/(const AutoDiffBlock<Scalar>& lhs,
                                     const typename AutoDiffBlock<Scalar>::V& rhs)
     {
-        return lhs / AutoDiffBlock<Scalar>::constant(rhs, lhs.blockPattern());
+        AutoDiffBlock<Scalar> result(lhs);
+        result /= rhs;
+        return result;
+    }
+
+
+    /// Elementwise division with constant on the right, reusing a temporary.
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator/(AutoDiffBlock<Scalar>&& lhs,
+                                    const typename AutoDiffBlock<Scalar>::V& rhs)
+    {
+        lhs /= rhs;
+        return std::move(lhs);
     }
 
 
@@ -610,6 +734,23 @@ namespace Opm
     }
 
 
+    /**
+     * @brief Operator for multiplication with a scalar on the right-hand side,
+     *        reusing the storage of a temporary
+     *
+     * @param lhs The left-hand side AD forward block
+     * @param rhs The scalar to multiply with
+     * @return The product
+     */
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator*(AutoDiffBlock<Scalar>&& lhs,
+                                    const Scalar& rhs)
+    {
+        lhs *= rhs;
+        return std::move(lhs);
+    }
+
+
     /**
      * @brief Operator for multiplication with a scalar on the left-hand side
      *
@@ -625,6 +766,22 @@ namespace Opm
     }
 
 
+    /**
+     * @brief Operator for multiplication with a scalar on the left-hand side,
+     *        reusing the storage of a temporary
+     *
+     * @param lhs The scalar to multiply with
+     * @param rhs The right-hand side AD forward block
+     * @return The product
+     */
+    template <typename Scalar>
+    AutoDiffBlock<Scalar> operator*(const Scalar& lhs,
+                                    AutoDiffBlock<Scalar>&& rhs)
+    {
+        return std::move(rhs) * lhs; // Commutative operation.
+    }
+
+
     /**
      * @brief Computes the value of base raised to the power of exponent
      *
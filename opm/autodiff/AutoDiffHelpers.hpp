@@ -22,6 +22,7 @@
 #define OPM_AUTODIFFHELPERS_HEADER_INCLUDED
 
 #include <opm/autodiff/AutoDiffBlock.hpp>
+#include <opm/autodiff/IndexSelection.hpp>
 #include <opm/autodiff/GridHelpers.hpp>
 #include <opm/autodiff/GeoProps.hpp>
 #include <opm/core/grid.h>
@@ -260,32 +261,6 @@ struct HelperOps
 
 
 
-namespace {
-
-
-    template <typename Scalar, class IntVec>
-    typename Eigen::SparseMatrix<Scalar>
-    constructSupersetSparseMatrix(const int full_size, const IntVec& indices)
-    {
-        const int subset_size = indices.size();
-
-        if (subset_size == 0) {
-            Eigen::SparseMatrix<Scalar> mat(full_size, 0);
-            return mat;
-        }
-
-        Eigen::SparseMatrix<Scalar> mat(full_size, subset_size);
-        mat.reserve(Eigen::VectorXi::Constant(subset_size, 1));
-        for (int i = 0; i < subset_size; ++i) {
-            mat.insert(indices[i], i) = 1;
-        }
-        return mat;
-    }
-
-} // anon namespace
-
-
-
 /// Returns x(indices).
 template <typename Scalar, class IntVec>
 Eigen::Array<Scalar, Eigen::Dynamic, 1>
@@ -301,42 +276,84 @@ subset(const Eigen::Array<Scalar, Eigen::Dynamic, 1>& x,
     return std::move(ret);
 }
 
+/// Returns x(selection), gathering the rows of the value and the jacobians.
+template <typename Scalar>
+AutoDiffBlock<Scalar>
+subset(const AutoDiffBlock<Scalar>& x,
+       const IndexSelection& selection)
+{
+    typedef AutoDiffBlock<Scalar> ADB;
+    typename ADB::V val = subset(x.value(), selection);
+    const int num_blocks = x.numBlocks();
+    std::vector<typename ADB::M> jacs(num_blocks);
+    for (int block = 0; block < num_blocks; ++block) {
+        jacs[block] = x.derivative()[block].subsetRows(selection);
+    }
+    return ADB::function(std::move(val), std::move(jacs));
+}
+
 /// Returns x(indices).
 template <typename Scalar, class IntVec>
 AutoDiffBlock<Scalar>
 subset(const AutoDiffBlock<Scalar>& x,
        const IntVec& indices)
 {
-    const Eigen::SparseMatrix<Scalar> sub
-        = constructSupersetSparseMatrix<Scalar>(x.value().size(), indices).transpose().eval();
-    return sub * x;
+    return subset(x, IndexSelection(indices));
 }
 
 
 /// Returns v where v(indices) == x, v(!indices) == 0 and v.size() == n.
+/// Entries selected several times are summed.
 template <typename Scalar, class IntVec>
-AutoDiffBlock<Scalar>
-superset(const AutoDiffBlock<Scalar>& x,
+Eigen::Array<Scalar, Eigen::Dynamic, 1>
+superset(const Eigen::Array<Scalar, Eigen::Dynamic, 1>& x,
          const IntVec& indices,
          const int n)
 {
-    return constructSupersetSparseMatrix<Scalar>(n, indices) * x;
+    typedef typename Eigen::Array<Scalar, Eigen::Dynamic, 1>::Index Index;
+    const Index size = indices.size();
+    assert(x.size() == size);
+    Eigen::Array<Scalar, Eigen::Dynamic, 1> ret = Eigen::Array<Scalar, Eigen::Dynamic, 1>::Zero(n);
+    for( Index i=0; i<size; ++i )
+        ret[ indices[ i ] ] += x[ i ];
+
+    return ret;
 }
 
 
+/// Returns v where v(selection) == x, v(!selection) == 0 and v.size() == n,
+/// scattering the rows of the value and the jacobians.
+template <typename Scalar>
+AutoDiffBlock<Scalar>
+superset(const AutoDiffBlock<Scalar>& x,
+         const IndexSelection& selection,
+         const int n)
+{
+    typedef AutoDiffBlock<Scalar> ADB;
+    typename ADB::V val = superset(x.value(), selection, n);
+    const int num_blocks = x.numBlocks();
+    std::vector<typename ADB::M> jacs(num_blocks);
+    for (int block = 0; block < num_blocks; ++block) {
+        jacs[block] = x.derivative()[block].supersetRows(selection, n);
+    }
+    return ADB::function(std::move(val), std::move(jacs));
+}
 
 /// Returns v where v(indices) == x, v(!indices) == 0 and v.size() == n.
 template <typename Scalar, class IntVec>
-Eigen::Array<Scalar, Eigen::Dynamic, 1>
-superset(const Eigen::Array<Scalar, Eigen::Dynamic, 1>& x,
+AutoDiffBlock<Scalar>
+superset(const AutoDiffBlock<Scalar>& x,
          const IntVec& indices,
          const int n)
 {
-    return constructSupersetSparseMatrix<Scalar>(n, indices) * x.matrix();
+    return superset(x, IndexSelection(indices), n);
 }
 
 
 
+
+
+
 /// Construct square sparse matrix with the
 /// elements of d on the diagonal.
 /// Need to mark this as inline since it is defined in a header and not a template.
@@ -409,6 +426,8 @@ spdiag(const AutoDiffBlock<double>::V& d)
                     right_elems_.push_back(i);
                 }
             }
+            left_selection_ = IndexSelection(left_elems_);
+            right_selection_ = IndexSelection(right_elems_);
         }
 
         /// Apply selector to ADB quantities.
@@ -419,8 +438,8 @@ spdiag(const AutoDiffBlock<double>::V& d)
             } else if (left_elems_.empty()) {
                 return x2;
             } else {
-                return superset(subset(x1, left_elems_), left_elems_, x1.size())
-                    + superset(subset(x2, right_elems_), right_elems_, x2.size());
+                return superset(subset(x1, left_selection_), left_selection_, x1.size())
+                    + superset(subset(x2, right_selection_), right_selection_, x2.size());
             }
         }
 
@@ -432,53 +451,119 @@ spdiag(const AutoDiffBlock<double>::V& d)
             } else if (left_elems_.empty()) {
                 return x2;
             } else {
-                return superset(subset(x1, left_elems_), left_elems_, x1.size())
-                    + superset(subset(x2, right_elems_), right_elems_, x2.size());
+                return superset(subset(x1, left_selection_), left_selection_, x1.size())
+                    + superset(subset(x2, right_selection_), right_selection_, x2.size());
             }
         }
 
     private:
         std::vector<int> left_elems_;
         std::vector<int> right_elems_;
+        // Cached gather/scatter maps of the index sets above.
+        IndexSelection left_selection_;
+        IndexSelection right_selection_;
     };
 
 
 
 
+namespace detail {
+
+    /// Assembles the column major matrix made of the blocks
+    /// blocks[elem][block], where the block rows are stacked in the order
+    /// of elem starting at the rows row_start[elem], and the block columns
+    /// are concatenated in the order of block. Null entries are zero
+    /// blocks. The number of nonzeros per column is counted first, then
+    /// the columns are filled in place, in parallel if OpenMP is enabled.
+    /// Since the columns of every block are sorted and the block rows are
+    /// visited in increasing order, no sorting is needed.
+    inline void
+    assembleBlockJacobian(const std::vector<std::vector<const Eigen::SparseMatrix<double>*> >& blocks,
+                          const std::vector<int>& row_start,
+                          const std::vector<int>& block_cols,
+                          const int num_rows,
+                          const bool drop_zeros,
+                          Eigen::SparseMatrix<double>& jacobian)
+    {
+        typedef Eigen::SparseMatrix<double> M;
+        const int num_elems = blocks.size();
+        const int num_blocks = block_cols.size();
+        std::vector<int> col_start(num_blocks + 1, 0);
+        for (int block = 0; block < num_blocks; ++block) {
+            col_start[block + 1] = col_start[block] + block_cols[block];
+        }
+        const int num_cols = col_start[num_blocks];
+
+        jacobian = M(num_rows, num_cols);
+        auto* outer = jacobian.outerIndexPtr();
+
+        // Count the nonzeros of every column.
+        for (int block = 0; block < num_blocks; ++block) {
+#pragma omp parallel for schedule(static)
+            for (int col = 0; col < block_cols[block]; ++col) {
+                int count = 0;
+                for (int elem = 0; elem < num_elems; ++elem) {
+                    const M* jac = blocks[elem][block];
+                    if (jac == nullptr) {
+                        continue;
+                    }
+                    for (M::InnerIterator it(*jac, col); it; ++it) {
+                        count += (!drop_zeros || it.value() != 0.0);
+                    }
+                }
+                outer[col_start[block] + col + 1] = count;
+            }
+        }
+        for (int col = 0; col < num_cols; ++col) {
+            outer[col + 1] += outer[col];
+        }
+
+        // Fill the columns in place.
+        jacobian.resizeNonZeros(outer[num_cols]);
+        auto* inner = jacobian.innerIndexPtr();
+        double* values = jacobian.valuePtr();
+        for (int block = 0; block < num_blocks; ++block) {
+#pragma omp parallel for schedule(static)
+            for (int col = 0; col < block_cols[block]; ++col) {
+                int pos = outer[col_start[block] + col];
+                for (int elem = 0; elem < num_elems; ++elem) {
+                    const M* jac = blocks[elem][block];
+                    if (jac == nullptr) {
+                        continue;
+                    }
+                    for (M::InnerIterator it(*jac, col); it; ++it) {
+                        if (!drop_zeros || it.value() != 0.0) {
+                            inner[pos] = it.row() + row_start[elem];
+                            values[pos] = it.value();
+                            ++pos;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace detail
+
+
+
 /// Returns the input expression, but with all Jacobians collapsed to one.
 template <class Matrix>
 inline
 void
 collapseJacs(const AutoDiffBlock<double>& x, Matrix& jacobian)
 {
-    typedef AutoDiffBlock<double> ADB;
     const int nb = x.numBlocks();
-    typedef Eigen::Triplet<double> Tri;
-    int nnz = 0;
+    std::vector<std::vector<const Eigen::SparseMatrix<double>*> > blocks(1);
+    std::vector<int> block_cols(nb);
     for (int block = 0; block < nb; ++block) {
-        nnz += x.derivative()[block].nonZeros();
+        // Returns the storage of sparse blocks without copying.
+        blocks[0].push_back(&x.derivative()[block].getSparse());
+        block_cols[block] = x.derivative()[block].cols();
     }
-    std::vector<Tri> t;
-    t.reserve(nnz);
-    int block_col_start = 0;
-    for (int block = 0; block < nb; ++block) {
-        const ADB::M& jac1 = x.derivative()[block];
-        Eigen::SparseMatrix<double> jac;
-        jac1.toSparse(jac);
-        for (Eigen::SparseMatrix<double>::Index k = 0; k < jac.outerSize(); ++k) {
-            for (Eigen::SparseMatrix<double>::InnerIterator i(jac, k); i ; ++i) {
-                if (i.value() != 0.0) {
-                    t.push_back(Tri(i.row(),
-                                    i.col() + block_col_start,
-                                    i.value()));
-                }
-            }
-        }
-        block_col_start += jac.cols();
-    }
-    // Build final jacobian.
-    jacobian = Matrix(x.size(), block_col_start);
-    jacobian.setFromTriplets(t.begin(), t.end());
+    Eigen::SparseMatrix<double> comb_jac;
+    detail::assembleBlockJacobian(blocks, std::vector<int>(1, 0), block_cols, x.size(), true, comb_jac);
+    jacobian = std::move(comb_jac);
 }
 
 
@@ -578,37 +663,30 @@ vertcatCollapseJacs(const std::vector<AutoDiffBlock<double> >& x)
         return ADB::constant(std::move(val));
     }
 
-    // Set up for batch insertion of all Jacobian elements.
+    // Assemble the jacobian directly from the blocks of all elements.
     typedef Eigen::SparseMatrix<double> M;
-    typedef Eigen::Triplet<double> Tri;
-    std::vector<Tri> t;
-    t.reserve(nnz);
+    std::vector<std::vector<const M*> > blocks(nx, std::vector<const M*>(num_blocks, nullptr));
+    std::vector<int> row_start(nx);
+    std::vector<int> block_cols(num_blocks);
     {
         int block_row_start = 0;
-        M jac;
         for (int elem = 0; elem < nx; ++elem) {
-            int block_col_start = 0;
+            row_start[elem] = block_row_start;
             if (!x[elem].derivative().empty()) {
                 for (int block = 0; block < num_blocks; ++block) {
-                    x[elem].derivative()[block].toSparse(jac);
-                    for (M::Index k = 0; k < jac.outerSize(); ++k) {
-                        for (M::InnerIterator i(jac, k); i ; ++i) {
-                            t.push_back(Tri(i.row() + block_row_start,
-                                            i.col() + block_col_start,
-                                            i.value()));
-                        }
-                    }
-                    block_col_start += jac.cols();
+                    // Returns the storage of sparse blocks without copying.
+                    blocks[elem][block] = &x[elem].derivative()[block].getSparse();
                 }
             }
             block_row_start += x[elem].size();
         }
+        for (int block = 0; block < num_blocks; ++block) {
+            block_cols[block] = x[elem_with_deriv].derivative()[block].cols();
+        }
     }
-
-    // Build final jacobian.
-    M comb_jac = M(size, num_cols);
-    comb_jac.reserve(nnz);
-    comb_jac.setFromTriplets(t.begin(), t.end());
+    M comb_jac;
+    detail::assembleBlockJacobian(blocks, row_start, block_cols, size, false, comb_jac);
+    assert(comb_jac.nonZeros() == nnz);
     std::vector<ADB::M> jac(1);
     jac[0] = ADB::M(std::move(comb_jac));
 
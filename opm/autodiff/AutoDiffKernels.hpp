@@ -0,0 +1,263 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_AUTODIFFKERNELS_HEADER_INCLUDED
+#define OPM_AUTODIFFKERNELS_HEADER_INCLUDED
+
+// The vectorised kernels are compiled for AVX2 and AVX-512 through
+// function target attributes, independently of the flags of the
+// translation unit, and selected at runtime from the CPU features.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define OPM_AUTODIFF_SIMD_DISPATCH 1
+#include <immintrin.h>
+#else
+#define OPM_AUTODIFF_SIMD_DISPATCH 0
+#endif
+
+namespace Opm
+{
+
+/// Elementwise kernels on the storage of diagonal and sparse
+/// AutoDiffMatrix objects.
+namespace AutoDiffKernels
+{
+
+    /// Instruction sets the kernels are available for.
+    enum InstructionSet { Scalar, AVX2, AVX512 };
+
+    /// The best instruction set supported by the CPU.
+    inline InstructionSet bestInstructionSet()
+    {
+#if OPM_AUTODIFF_SIMD_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return AVX2;
+        }
+#endif
+        return Scalar;
+    }
+
+    namespace detail
+    {
+        // --------- Scalar fallback ---------
+
+        // x[i] *= d[i]
+        inline void multiplyScalar(double* x, const double* d, const int n)
+        {
+            for (int i = 0; i < n; ++i) {
+                x[i] *= d[i];
+            }
+        }
+
+        // x[k] *= d[index[k]]
+        inline void multiplyGatheredScalar(double* x, const int* index, const double* d, const int n)
+        {
+            for (int k = 0; k < n; ++k) {
+                x[k] *= d[index[k]];
+            }
+        }
+
+        // x[i] += d[i]
+        inline void addScalar(double* x, const double* d, const int n)
+        {
+            for (int i = 0; i < n; ++i) {
+                x[i] += d[i];
+            }
+        }
+
+        // x[index[k]] += d[k], the indices must be distinct.
+        inline void addScatteredScalar(double* x, const int* index, const double* d, const int n)
+        {
+            for (int k = 0; k < n; ++k) {
+                x[index[k]] += d[k];
+            }
+        }
+
+#if OPM_AUTODIFF_SIMD_DISPATCH
+
+        // --------- AVX2 ---------
+
+        __attribute__((target("avx2")))
+        inline void multiplyAVX2(double* x, const double* d, const int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(d + i)));
+            }
+            multiplyScalar(x + i, d + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline void multiplyGatheredAVX2(double* x, const int* index, const double* d, const int n)
+        {
+            // The masked gather with a defined source avoids spurious
+            // -Wmaybe-uninitialized warnings for the unmasked intrinsic.
+            const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+            int k = 0;
+            for (; k + 4 <= n; k += 4) {
+                const __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(index + k));
+                const __m256d dk = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), d, idx, allLanes, 8);
+                _mm256_storeu_pd(x + k, _mm256_mul_pd(_mm256_loadu_pd(x + k), dk));
+            }
+            multiplyGatheredScalar(x + k, index + k, d, n - k);
+        }
+
+        __attribute__((target("avx2")))
+        inline void addAVX2(double* x, const double* d, const int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(x + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(d + i)));
+            }
+            addScalar(x + i, d + i, n - i);
+        }
+
+        // --------- AVX-512 ---------
+
+        __attribute__((target("avx512f")))
+        inline void multiplyAVX512(double* x, const double* d, const int n)
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(x + i, _mm512_mul_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(d + i)));
+            }
+            multiplyScalar(x + i, d + i, n - i);
+        }
+
+        __attribute__((target("avx512f")))
+        inline void multiplyGatheredAVX512(double* x, const int* index, const double* d, const int n)
+        {
+            int k = 0;
+            for (; k + 8 <= n; k += 8) {
+                const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + k));
+                const __m512d dk = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, idx, d, 8);
+                _mm512_storeu_pd(x + k, _mm512_mul_pd(_mm512_loadu_pd(x + k), dk));
+            }
+            multiplyGatheredScalar(x + k, index + k, d, n - k);
+        }
+
+        __attribute__((target("avx512f")))
+        inline void addAVX512(double* x, const double* d, const int n)
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(x + i, _mm512_add_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(d + i)));
+            }
+            addScalar(x + i, d + i, n - i);
+        }
+
+        __attribute__((target("avx512f")))
+        inline void addScatteredAVX512(double* x, const int* index, const double* d, const int n)
+        {
+            int k = 0;
+            for (; k + 8 <= n; k += 8) {
+                const __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + k));
+                const __m512d xk = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, idx, x, 8);
+                _mm512_i32scatter_pd(x, idx, _mm512_add_pd(xk, _mm512_loadu_pd(d + k)), 8);
+            }
+            addScatteredScalar(x, index + k, d + k, n - k);
+        }
+
+#endif // OPM_AUTODIFF_SIMD_DISPATCH
+
+        struct KernelTable
+        {
+            InstructionSet instructionSet;
+            void (*multiply)(double*, const double*, int);
+            void (*multiplyGathered)(double*, const int*, const double*, int);
+            void (*add)(double*, const double*, int);
+            void (*addScattered)(double*, const int*, const double*, int);
+        };
+
+        inline KernelTable kernelTable(const InstructionSet set)
+        {
+#if OPM_AUTODIFF_SIMD_DISPATCH
+            if (set == AVX512) {
+                KernelTable t = { AVX512, multiplyAVX512, multiplyGatheredAVX512, addAVX512, addScatteredAVX512 };
+                return t;
+            }
+            if (set == AVX2) {
+                // AVX2 has no scatter, the scattered add stays scalar.
+                KernelTable t = { AVX2, multiplyAVX2, multiplyGatheredAVX2, addAVX2, addScatteredScalar };
+                return t;
+            }
+#else
+            static_cast<void>(set);
+#endif
+            KernelTable t = { Scalar, multiplyScalar, multiplyGatheredScalar, addScalar, addScatteredScalar };
+            return t;
+        }
+
+        inline KernelTable& activeKernels()
+        {
+            static KernelTable table = kernelTable(bestInstructionSet());
+            return table;
+        }
+
+    } // namespace detail
+
+
+
+    /// The instruction set used by the kernels.
+    inline InstructionSet instructionSet()
+    {
+        return detail::activeKernels().instructionSet;
+    }
+
+    /// Selects the instruction set, which is limited to the best one
+    /// supported by the CPU. Mainly for testing and benchmarking.
+    inline void setInstructionSet(const InstructionSet set)
+    {
+        const InstructionSet best = bestInstructionSet();
+        detail::activeKernels() = detail::kernelTable(set < best ? set : best);
+    }
+
+    /// x[i] *= d[i] for i < n.
+    inline void multiply(double* x, const double* d, const int n)
+    {
+        detail::activeKernels().multiply(x, d, n);
+    }
+
+    /// x[k] *= d[index[k]] for k < n, e.g. the row scaling of the values
+    /// of a column major sparse matrix with inner indices index.
+    inline void multiplyGathered(double* x, const int* index, const double* d, const int n)
+    {
+        detail::activeKernels().multiplyGathered(x, index, d, n);
+    }
+
+    /// x[i] += d[i] for i < n.
+    inline void add(double* x, const double* d, const int n)
+    {
+        detail::activeKernels().add(x, d, n);
+    }
+
+    /// x[index[k]] += d[k] for k < n. The indices must be distinct.
+    inline void addScattered(double* x, const int* index, const double* d, const int n)
+    {
+        detail::activeKernels().addScattered(x, index, d, n);
+    }
+
+} // namespace AutoDiffKernels
+
+} // namespace Opm
+
+#endif // OPM_AUTODIFFKERNELS_HEADER_INCLUDED
@@ -29,6 +29,12 @@
 
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/autodiff/fastSparseOperations.hpp>
+#include <opm/autodiff/AutoDiffArena.hpp>
+#include <opm/autodiff/AutoDiffKernels.hpp>
+#include <opm/autodiff/IndexSelection.hpp>
+#include <opm/autodiff/SparseProductCache.hpp>
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 
@@ -43,7 +49,9 @@ namespace Opm
     class AutoDiffMatrix
     {
     public:
-        typedef std::vector<double> DiagRep;
+        // The diagonal storage of the many temporaries created during
+        // assembly is drawn from the AutoDiffArena of the calling thread.
+        typedef std::vector<double, AutoDiffArenaAllocator<double> > DiagRep;
         typedef Eigen::SparseMatrix<double> SparseRep;
 
 
@@ -114,6 +122,20 @@ namespace Opm
 
 
 
+        /**
+         * Creates a sparse matrix taking over the storage of s.
+         */
+        explicit AutoDiffMatrix(Eigen::SparseMatrix<double>&& s)
+            : type_(Sparse),
+              rows_(s.rows()),
+              cols_(s.cols()),
+              diag_(),
+              sparse_(std::move(s))
+        {
+        }
+
+
+
         AutoDiffMatrix(const AutoDiffMatrix& other) = default;
         AutoDiffMatrix& operator=(const AutoDiffMatrix& other) = default;
 
@@ -378,6 +400,201 @@ namespace Opm
 
 
 
+        /**
+         * Multiplies an AutoDiffMatrix with a scalar in place.
+         */
+        AutoDiffMatrix& operator*=(const double rhs)
+        {
+            switch (type_) {
+            case Zero:
+                return *this;
+            case Identity:
+                type_ = Diagonal;
+                diag_.assign(rows_, rhs);
+                return *this;
+            case Diagonal:
+                for (double& elem : diag_) {
+                    elem *= rhs;
+                }
+                return *this;
+            case Sparse:
+                sparse_ *= rhs;
+                return *this;
+            default:
+                OPM_THROW(std::logic_error, "Invalid AutoDiffMatrix type encountered: " << type_);
+            }
+        }
+
+
+
+
+
+
+        /**
+         * Multiplies an AutoDiffMatrix with the diagonal matrix with entries d
+         * from the left, in place, i.e., row r is scaled by d[r]. No memory
+         * is allocated unless the matrix is an identity, and the sparsity
+         * pattern is kept. V must provide contiguous storage through data().
+         */
+        template <class V>
+        AutoDiffMatrix& scaleRows(const V& d)
+        {
+            assert(d.size() == rows_);
+            switch (type_) {
+            case Zero:
+                return *this;
+            case Identity:
+                type_ = Diagonal;
+                diag_.assign(d.data(), d.data() + rows_);
+                return *this;
+            case Diagonal:
+                AutoDiffKernels::multiply(diag_.data(), d.data(), rows_);
+                return *this;
+            case Sparse:
+                sparse_.makeCompressed();
+                AutoDiffKernels::multiplyGathered(sparse_.valuePtr(), sparse_.innerIndexPtr(),
+                                                  d.data(), sparse_.nonZeros());
+                return *this;
+            default:
+                OPM_THROW(std::logic_error, "Invalid AutoDiffMatrix type encountered: " << type_);
+            }
+        }
+
+
+
+
+
+
+        /**
+         * Returns the rows selection[0], ..., selection[m-1] of this matrix,
+         * i.e. the product with the selection matrix, computed by a direct
+         * gather of the rows.
+         */
+        AutoDiffMatrix subsetRows(const IndexSelection& selection) const
+        {
+            const int m = selection.size();
+            switch (type_) {
+            case Zero:
+                return AutoDiffMatrix(m, cols_);
+            case Identity:
+            case Diagonal:
+                {
+                    // Column c holds the entries of the rows selecting c.
+                    AutoDiffMatrix retval(Sparse, m, cols_);
+                    retval.sparse_.resize(m, cols_);
+                    retval.sparse_.reserve(m);
+                    for (int c = 0; c < cols_; ++c) {
+                        retval.sparse_.startVec(c);
+                        const double value = (type_ == Identity) ? 1.0 : diag_[c];
+                        for (const int* p = selection.positionsBegin(c); p != selection.positionsEnd(c); ++p) {
+                            retval.sparse_.insertBackByOuterInner(c, *p) = value;
+                        }
+                    }
+                    retval.sparse_.finalize();
+                    return retval;
+                }
+            case Sparse:
+                {
+                    AutoDiffMatrix retval(Sparse, m, cols_);
+                    retval.sparse_.resize(m, cols_);
+                    std::vector<std::pair<int, double> > column;
+                    for (int c = 0; c < cols_; ++c) {
+                        column.clear();
+                        for (SparseRep::InnerIterator it(sparse_, c); it; ++it) {
+                            for (const int* p = selection.positionsBegin(it.row()); p != selection.positionsEnd(it.row()); ++p) {
+                                column.push_back(std::make_pair(*p, it.value()));
+                            }
+                        }
+                        // Ascending indices keep the order of the rows.
+                        if (!selection.ascending()) {
+                            std::sort(column.begin(), column.end());
+                        }
+                        retval.sparse_.startVec(c);
+                        for (const auto& entry : column) {
+                            retval.sparse_.insertBackByOuterInner(c, entry.first) = entry.second;
+                        }
+                    }
+                    retval.sparse_.finalize();
+                    return retval;
+                }
+            default:
+                OPM_THROW(std::logic_error, "Invalid AutoDiffMatrix type encountered: " << type_);
+            }
+        }
+
+
+
+
+
+
+        /**
+         * Returns the matrix with n rows where row selection[p] is row p of
+         * this matrix and all other rows are zero, i.e. the product with the
+         * transposed selection matrix, computed by a direct scatter of the
+         * rows. Rows selected several times are summed.
+         */
+        AutoDiffMatrix supersetRows(const IndexSelection& selection, const int n) const
+        {
+            assert(selection.size() == rows_);
+            switch (type_) {
+            case Zero:
+                return AutoDiffMatrix(n, cols_);
+            case Identity:
+            case Diagonal:
+                {
+                    // Column p has its only entry in row selection[p].
+                    AutoDiffMatrix retval(Sparse, n, cols_);
+                    retval.sparse_.resize(n, cols_);
+                    retval.sparse_.reserve(cols_);
+                    for (int c = 0; c < cols_; ++c) {
+                        retval.sparse_.startVec(c);
+                        retval.sparse_.insertBackByOuterInner(c, selection[c])
+                            = (type_ == Identity) ? 1.0 : diag_[c];
+                    }
+                    retval.sparse_.finalize();
+                    return retval;
+                }
+            case Sparse:
+                {
+                    AutoDiffMatrix retval(Sparse, n, cols_);
+                    retval.sparse_.resize(n, cols_);
+                    retval.sparse_.reserve(sparse_.nonZeros());
+                    std::vector<std::pair<int, double> > column;
+                    for (int c = 0; c < cols_; ++c) {
+                        column.clear();
+                        for (SparseRep::InnerIterator it(sparse_, c); it; ++it) {
+                            column.push_back(std::make_pair(selection[it.row()], it.value()));
+                        }
+                        retval.sparse_.startVec(c);
+                        if (selection.ascending()) {
+                            for (const auto& entry : column) {
+                                retval.sparse_.insertBackByOuterInner(c, entry.first) = entry.second;
+                            }
+                        } else {
+                            std::sort(column.begin(), column.end());
+                            for (std::size_t k = 0; k < column.size(); ) {
+                                const int row = column[k].first;
+                                double value = 0.0;
+                                for (; k < column.size() && column[k].first == row; ++k) {
+                                    value += column[k].second;
+                                }
+                                retval.sparse_.insertBackByOuterInner(c, row) = value;
+                            }
+                        }
+                    }
+                    retval.sparse_.finalize();
+                    return retval;
+                }
+            default:
+                OPM_THROW(std::logic_error, "Invalid AutoDiffMatrix type encountered: " << type_);
+            }
+        }
+
+
+
+
+
+
         /**
          * Multiplies an AutoDiffMatrix with a vector. Optimizes internally
          * by exploiting that e.g., an identity matrix multiplied by a vector
@@ -439,9 +656,7 @@ namespace Opm
             assert(lhs.type_ == Diagonal);
             assert(rhs.type_ == Diagonal);
             AutoDiffMatrix retval = lhs;
-            for (int r = 0; r < lhs.rows_; ++r) {
-                retval.diag_[r] += rhs.diag_[r];
-            }
+            AutoDiffKernels::add(retval.diag_.data(), rhs.diag_.data(), lhs.rows_);
             return retval;
         }
 
@@ -462,7 +677,16 @@ namespace Opm
             assert(lhs.type_ == Sparse);
             assert(rhs.type_ == Diagonal);
             AutoDiffMatrix retval = lhs;
-            retval.sparse_ += spdiag(rhs.diag_);
+            // Add in place if the pattern contains the diagonal, as is
+            // the case for most jacobians.
+            retval.sparse_.makeCompressed();
+            std::vector<int> diagonal_positions;
+            if (findDiagonal(retval.sparse_, diagonal_positions)) {
+                AutoDiffKernels::addScattered(retval.sparse_.valuePtr(), diagonal_positions.data(),
+                                              rhs.diag_.data(), lhs.rows_);
+            } else {
+                retval.sparse_ += spdiag(rhs.diag_);
+            }
             return retval;
         }
 
@@ -485,9 +709,7 @@ namespace Opm
             assert(lhs.type_ == Diagonal);
             assert(rhs.type_ == Diagonal);
             AutoDiffMatrix retval = lhs;
-            for (int r = 0; r < lhs.rows_; ++r) {
-                retval.diag_[r] *= rhs.diag_[r];
-            }
+            AutoDiffKernels::multiply(retval.diag_.data(), rhs.diag_.data(), lhs.rows_);
             return retval;
         }
 
@@ -500,7 +722,10 @@ namespace Opm
             retval.type_ = Sparse;
             retval.rows_ = lhs.rows_;
             retval.cols_ = rhs.cols_;
-            fastDiagSparseProduct(lhs.diag_, rhs.sparse_, retval.sparse_);
+            retval.sparse_ = rhs.sparse_;
+            retval.sparse_.makeCompressed();
+            AutoDiffKernels::multiplyGathered(retval.sparse_.valuePtr(), retval.sparse_.innerIndexPtr(),
+                                              lhs.diag_.data(), retval.sparse_.nonZeros());
             return retval;
         }
 
@@ -526,7 +751,7 @@ namespace Opm
             retval.type_ = Sparse;
             retval.rows_ = lhs.rows_;
             retval.cols_ = rhs.cols_;
-            fastSparseProduct(lhs.sparse_, rhs.sparse_, retval.sparse_);
+            SparseProductCache::instance().multiply(lhs.sparse_, rhs.sparse_, retval.sparse_);
             return retval;
         }
 
@@ -559,6 +784,45 @@ namespace Opm
 
 
 
+
+        /**
+         * Writes the main diagonal to d[0], ..., d[rows() - 1] and returns
+         * true if the matrix is square and has no entries off the diagonal,
+         * which is always the case for zero, identity and diagonal matrices.
+         * Otherwise false is returned and d is left undefined.
+         */
+        bool toDiagonal(double* d) const
+        {
+            if (rows_ != cols_) {
+                return false;
+            }
+            switch (type_) {
+            case Zero:
+                std::fill(d, d + rows_, 0.0);
+                return true;
+            case Identity:
+                std::fill(d, d + rows_, 1.0);
+                return true;
+            case Diagonal:
+                std::copy(diag_.begin(), diag_.end(), d);
+                return true;
+            case Sparse:
+                std::fill(d, d + rows_, 0.0);
+                for (int col = 0; col < cols_; ++col) {
+                    for (SparseRep::InnerIterator it(sparse_, col); it; ++it) {
+                        if (it.row() != col) {
+                            return false;
+                        }
+                        d[col] += it.value();
+                    }
+                }
+                return true;
+            }
+            return false;
+        }
+
+
+
         /**
          * Returns number of rows in the matrix
          */
@@ -676,6 +940,32 @@ namespace Opm
 
 
 
+        /**
+         * Finds the positions of the diagonal entries of the square,
+         * compressed matrix s in its value array. Returns false if some
+         * diagonal entry is not part of the sparsity pattern.
+         */
+        static bool findDiagonal(const SparseRep& s, std::vector<int>& positions)
+        {
+            const int n = s.outerSize();
+            positions.resize(n);
+            const auto* outer = s.outerIndexPtr();
+            const auto* inner = s.innerIndexPtr();
+            for (int j = 0; j < n; ++j) {
+                const auto* begin = inner + outer[j];
+                const auto* end = inner + outer[j + 1];
+                const auto* it = std::lower_bound(begin, end, j);
+                if (it == end || *it != j) {
+                    return false;
+                }
+                positions[j] = it - inner;
+            }
+            return true;
+        }
+
+
+
+
         /**
          * Creates a sparse diagonal matrix from d.
          * Typical use is to convert a standard vector to an
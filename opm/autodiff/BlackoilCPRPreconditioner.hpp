@@ -0,0 +1,350 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_BLACKOILCPRPRECONDITIONER_HEADER_INCLUDED
+#define OPM_BLACKOILCPRPRECONDITIONER_HEADER_INCLUDED
+
+#include <opm/autodiff/CPRPreconditioner.hpp>
+#include <opm/autodiff/ParallelOverlappingILU0.hpp>
+
+#include <opm/common/utility/platform_dependent/disable_warnings.h>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/paamg/pinfo.hh>
+
+#include <opm/common/utility/platform_dependent/reenable_warnings.h>
+
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Opm
+{
+
+    /*!
+      \brief Two-stage CPR preconditioner for block matrices.
+
+      In contrast to CPRPreconditioner, which expects the elliptic part
+      to be assembled separately, this preconditioner works directly on the
+      block-structured matrix with one block per cell, e.g. the Jacobian of
+      BlackoilModelEbos.
+
+      For each cell the equations are combined with quasi-IMPES weights w,
+      chosen such that w^T D = e_p^T holds for the diagonal block D. The
+      weighted pressure columns form a scalar pressure matrix.
+      The preconditioner then
+      1. restricts the residual to a pressure residual with the weights,
+      2. applies one AMG cycle to the pressure system,
+      3. prolongates the pressure correction,
+      4. applies ILU to the remaining residual of the whole system.
+
+      The matrix is used as is, i.e. contributions of eliminated well
+      equations that are only present in the linear operator (see
+      WellModelMatrixAdapter) are not part of either stage.
+
+      \tparam M The matrix type to operate on
+      \tparam X Type of the update
+      \tparam Y Type of the defect
+      \tparam P Type of the parallel information. If not provided
+                this will be Dune::Amg::SequentialInformation.
+                The preconditioner is parallel if this is
+                Dune::OwnerOverlapCopyCommunication<int,int>
+    */
+    template<class M, class X, class Y,
+             class P=Dune::Amg::SequentialInformation>
+    class BlackoilCPRPreconditioner : public Dune::Preconditioner<X,Y>
+    {
+        // prohibit copying for now
+        BlackoilCPRPreconditioner( const BlackoilCPRPreconditioner& );
+
+    public:
+        //! \brief The type describing the parallel information
+        typedef P ParallelInformation;
+        //! \brief The matrix type the preconditioner is for.
+        typedef typename Dune::remove_const<M>::type matrix_type;
+        //! \brief The domain type of the preconditioner.
+        typedef X domain_type;
+        //! \brief The range type of the preconditioner.
+        typedef Y range_type;
+        //! \brief The field type of the preconditioner.
+        typedef typename X::field_type field_type;
+
+        // define the category
+        enum {
+            //! \brief The category the preconditioner is part of.
+            category = std::is_same<P,Dune::Amg::SequentialInformation>::value?
+            Dune::SolverCategory::sequential:Dune::SolverCategory::overlapping
+        };
+
+        //! \brief The number of equations per cell.
+        static const int numEq = matrix_type::block_type::rows;
+
+        //! \brief The scalar matrix of the pressure system.
+        typedef Dune::BCRSMatrix< Dune::FieldMatrix< field_type, 1, 1 > > PressureMatrix;
+        //! \brief The vector type of the pressure system.
+        typedef Dune::BlockVector< Dune::FieldVector< field_type, 1 > > PressureVector;
+
+        typedef ISTLUtility::CPRSelector< PressureMatrix, PressureVector, PressureVector, P > PressureSelectorType;
+        //! \brief The operator of the pressure system.
+        typedef typename PressureSelectorType::Operator PressureOperator;
+        //! \brief AMG preconditioner for the pressure system.
+        typedef typename PressureSelectorType::AMG AMG;
+        //! \brief ILU preconditioner for the whole system.
+        typedef ParallelOverlappingILU0< matrix_type, X, Y, P > WholeSystemPreconditioner;
+
+        /*! \brief Constructor.
+
+          \param param          The CPR parameters. cpr_relax is used for both stages
+                                and cpr_ilu_n selects the fill-in of the ILU stage.
+          \param A              The matrix to operate on.
+          \param pressureIndex  The index of the pressure unknown within a block.
+          \param comm           The information about the parallelization.
+        */
+        BlackoilCPRPreconditioner (const CPRParameter& param, const M& A,
+                                   const int pressureIndex,
+                                   const ParallelInformation& comm)
+            : param_( param ),
+              A_( A ),
+              pressureIndex_( pressureIndex ),
+              weights_( A_.N() ),
+              Ap_(),
+              rp_( A_.N() ),
+              xp_( A_.N() ),
+              dmodified_( A_.N() ),
+              vilu_( A_.N() ),
+              comm_( &comm )
+        {
+            createPressureMatrix();
+            computeWeights();
+            assemblePressureMatrix();
+
+            createPressureAMG();
+
+            pre_.reset( new WholeSystemPreconditioner( A_, *comm_, param_.cpr_relax_, param_.cpr_ilu_n_ ) );
+        }
+
+        /*!
+          \brief Recompute both stages after the values of the matrix changed.
+
+          The matrix passed to the constructor must still be alive and have the
+          same sparsity pattern. The weights and the values of the pressure
+          matrix are recomputed in place and the ILU stage is refactorized in
+          its existing pattern. The pressure AMG is set up again, since
+          refreshing only its Galerkin products would leave the smoothers and
+          the coarse solver factorized for the previous pressure matrix.
+          \param comm The parallel information to use from now on.
+        */
+        void update (const ParallelInformation& comm)
+        {
+            comm_ = &comm;
+            computeWeights();
+            assemblePressureMatrix();
+            createPressureAMG();
+            pre_->update( *comm_ );
+        }
+
+        /*!
+          \brief Prepare the preconditioner.
+
+          \copydoc Preconditioner::pre(X&,Y&)
+        */
+        virtual void pre (X& /*x*/, Y& /*b*/)
+        {
+            xp_ = 0.0;
+            rp_ = 0.0;
+            amg_->pre( xp_, rp_ );
+        }
+
+        /*!
+          \brief Apply the preconditoner.
+
+          \copydoc Preconditioner::apply(X&,const Y&)
+        */
+        virtual void apply (X& v, const Y& d)
+        {
+            // Restrict the residual to the pressure equation.
+            const int size = A_.N();
+#pragma omp parallel for schedule(static)
+            for( int cell = 0; cell < size; ++cell )
+            {
+                rp_[ cell ] = weights_[ cell ] * d[ cell ];
+            }
+            comm_->copyOwnerToAll( rp_, rp_ );
+
+            // One AMG cycle for the pressure system.
+            xp_ = 0.0;
+            amg_->apply( xp_, rp_ );
+
+            // Prolongate the pressure correction.
+            v = 0.0;
+#pragma omp parallel for schedule(static)
+            for( int cell = 0; cell < size; ++cell )
+            {
+                v[ cell ][ pressureIndex_ ] = xp_[ cell ];
+            }
+
+            // dmodified = d - A * v
+            dmodified_ = d;
+            A_.mmv( v, dmodified_ );
+            // A is not parallel, do communication manually.
+            comm_->copyOwnerToAll( dmodified_, dmodified_ );
+
+            // Apply preconditioner for whole system (relax will be applied already)
+            pre_->apply( vilu_, dmodified_ );
+
+            v += vilu_;
+        }
+
+        /*!
+          \brief Clean up.
+
+          \copydoc Preconditioner::post(X&)
+        */
+        virtual void post (X& /*x*/)
+        {
+            amg_->post( xp_ );
+        }
+
+    protected:
+        typedef Dune::FieldVector< field_type, numEq > BlockVectorType;
+        typedef Dune::FieldMatrix< field_type, numEq, numEq > BlockMatrixType;
+
+        //! \brief Set up the pattern of the pressure matrix, which is the one of A.
+        void createPressureMatrix()
+        {
+            Ap_.setSize( A_.N(), A_.M(), A_.nonzeroes() );
+            Ap_.setBuildMode( PressureMatrix::row_wise );
+            auto arow = A_.begin();
+            const auto endrow = Ap_.createend();
+            for( auto row = Ap_.createbegin(); row != endrow; ++row, ++arow )
+            {
+                const auto endcol = arow->end();
+                for( auto col = arow->begin(); col != endcol; ++col )
+                {
+                    row.insert( col.index() );
+                }
+            }
+        }
+
+        //! \brief Set up the AMG for the current values of the pressure matrix.
+        void createPressureAMG()
+        {
+            // the AMG refers to the operator, release it first
+            amg_.reset();
+            opAp_.reset( PressureSelectorType::makeOperator( Ap_, *comm_ ) );
+            ISTLUtility::createAMGPreconditionerPointer( *opAp_, param_.cpr_relax_, *comm_, amg_ );
+        }
+
+        //! \brief Compute the quasi-IMPES weights from the diagonal blocks.
+        //!
+        //! The weights solve D^T w = e_p and are scaled to unit maximum norm.
+        //! If D is singular the pressure equation is the unweighted sum.
+        void computeWeights()
+        {
+            const int size = A_.N();
+#pragma omp parallel for schedule(static)
+            for( int cell = 0; cell < size; ++cell )
+            {
+                const auto& diag = A_[ cell ][ cell ];
+                BlockMatrixType diagT;
+                for( int i = 0; i < numEq; ++i ) {
+                    for( int j = 0; j < numEq; ++j ) {
+                        diagT[ i ][ j ] = diag[ j ][ i ];
+                    }
+                }
+                BlockVectorType ep( 0.0 );
+                ep[ pressureIndex_ ] = 1.0;
+
+                BlockVectorType& w = weights_[ cell ];
+                try {
+                    diagT.solve( w, ep );
+                    const field_type scale = w.infinity_norm();
+                    if( scale > 0.0 && std::isfinite( scale ) ) {
+                        w /= scale;
+                    }
+                    else {
+                        w = 1.0;
+                    }
+                }
+                catch ( const Dune::FMatrixError& ) {
+                    w = 1.0;
+                }
+            }
+        }
+
+        //! \brief Compute the values of the pressure matrix.
+        void assemblePressureMatrix()
+        {
+            const int size = A_.N();
+#pragma omp parallel for schedule(static)
+            for( int cell = 0; cell < size; ++cell )
+            {
+                const BlockVectorType& w = weights_[ cell ];
+                const auto& arow = A_[ cell ];
+                auto prow = Ap_[ cell ].begin();
+                const auto endcol = arow.end();
+                for( auto col = arow.begin(); col != endcol; ++col, ++prow )
+                {
+                    field_type value = 0.0;
+                    for( int eq = 0; eq < numEq; ++eq ) {
+                        value += w[ eq ] * (*col)[ eq ][ pressureIndex_ ];
+                    }
+                    *prow = value;
+                }
+            }
+        }
+
+        //! \brief Parameter collection for CPR
+        const CPRParameter& param_;
+
+        //! \brief The matrix for the full linear problem.
+        const matrix_type& A_;
+        //! \brief The index of the pressure unknown.
+        const int pressureIndex_;
+
+        //! \brief The quasi-IMPES weights per cell.
+        std::vector< BlockVectorType > weights_;
+
+        //! \brief The pressure matrix.
+        PressureMatrix Ap_;
+        //! \brief Pressure residual and correction.
+        PressureVector rp_, xp_;
+        //! \brief The pressure operator.
+        std::unique_ptr< PressureOperator > opAp_;
+        //! \brief AMG preconditioner of the pressure system
+        std::unique_ptr< AMG > amg_;
+
+        //! \brief temporary variables for the whole system stage
+        Y dmodified_;
+        Y vilu_;
+        //! \brief The preconditioner for the whole system
+        std::unique_ptr< WholeSystemPreconditioner > pre_;
+
+        //! \brief The information about the parallelization.
+        const P* comm_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_BLACKOILCPRPRECONDITIONER_HEADER_INCLUDED
@@ -25,6 +25,7 @@
 
 #include <cassert>
 
+#include <opm/autodiff/AutoDiffArena.hpp>
 #include <opm/autodiff/AutoDiffBlock.hpp>
 #include <opm/autodiff/AutoDiffHelpers.hpp>
 #include <opm/autodiff/BlackoilPropsAdInterface.hpp>
@@ -264,6 +265,10 @@ namespace Opm {
             return sd_;
         }
 
+        /// Return the arena backing the AD temporaries, e.g. for its
+        /// allocation counters.
+        const AutoDiffArena& autoDiffArena() const { return ad_arena_; }
+
         /// Compute fluid in place.
         /// \param[in]    ReservoirState
         /// \param[in]    FIPNUM for active cells not global cells.
@@ -338,6 +343,9 @@ namespace Opm {
         double current_relaxation_;
         V dx_old_;
 
+        // Storage of the AD temporaries, reset in each nonlinear iteration.
+        AutoDiffArena ad_arena_;
+
         // rate converter between the surface volume rates and reservoir voidage rates
         RateConverterType rate_converter_;
 
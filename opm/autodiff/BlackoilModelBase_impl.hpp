@@ -33,6 +33,7 @@
 #include <opm/autodiff/WellHelpers.hpp>
 #include <opm/autodiff/BlackoilPropsAdInterface.hpp>
 #include <opm/autodiff/GeoProps.hpp>
+#include <opm/autodiff/LocalAutoDiff.hpp>
 #include <opm/autodiff/WellDensitySegmented.hpp>
 #include <opm/autodiff/VFPProperties.hpp>
 #include <opm/autodiff/VFPProdProperties.hpp>
@@ -246,6 +247,10 @@ typedef Eigen::Array<double,
         SimulatorReport report;
         Dune::Timer perfTimer;
 
+        // The AD temporaries of this iteration are drawn from the arena.
+        ad_arena_.reset();
+        AutoDiffArena::Scope arena_scope(ad_arena_);
+
         perfTimer.start();
         const double dt = timer.currentStepLength();
 
@@ -266,6 +271,17 @@ typedef Eigen::Array<double,
         }
 
         report.total_linearizations = 1;
+        if (terminalOutputEnabled()) {
+            const auto& arena_stats = ad_arena_.iterationStatistics();
+            OpmLog::debug("AD arena in assembly: "
+                          + std::to_string(arena_stats.allocations) + " allocations, "
+                          + std::to_string(arena_stats.bytes) + " bytes, "
+                          + std::to_string(arena_stats.chunkAllocations) + " chunk allocations");
+            const auto& product_cache = SparseProductCache::instance();
+            OpmLog::debug("Sparse product pattern cache: "
+                          + std::to_string(product_cache.hits()) + " hits, "
+                          + std::to_string(product_cache.misses()) + " misses");
+        }
         perfTimer.reset();
         perfTimer.start();
         report.converged = asImpl().getConvergence(timer, iteration);
@@ -954,7 +970,7 @@ typedef Eigen::Array<double,
         const V& efficiency_factors = wellModel().wellPerfEfficiencyFactors();
         for (int phase = 0; phase < np; ++phase) {
             residual_.material_balance_eq[phase] -= superset(efficiency_factors * cq_s[phase],
-                                                             wellModel().wellOps().well_cells, nc);
+                                                             wellModel().wellOps().well_cell_selection, nc);
         }
     }
 
@@ -1399,6 +1415,19 @@ typedef Eigen::Array<double,
                          ? state.saturation[ pu.phase_pos[ Gas ] ]
                          : zero);
 
+        if (param_.use_local_ad_properties_) {
+            const LocalAutoDiff local({ &sw, &so, &sg });
+            if (local.valid()) {
+                const std::vector<LocalAutoDiff::Vector> kr = fluid_.relperm(local[0], local[1], local[2], cells_);
+                std::vector<ADB> relperms;
+                relperms.reserve(kr.size());
+                for (const auto& kr_phase : kr) {
+                    relperms.push_back(kr_phase.empty() ? ADB::null() : local.toAutoDiffBlock(kr_phase));
+                }
+                return relperms;
+            }
+        }
+
         return fluid_.relperm(sw, so, sg, cells_);
     }
 
@@ -1948,6 +1977,22 @@ typedef Eigen::Array<double,
                    const ADB&              rv   ,
                    const std::vector<PhasePresence>& cond) const
     {
+        if (param_.use_local_ad_properties_) {
+            const LocalAutoDiff local({ &p, &temp, &rs, &rv });
+            if (local.valid()) {
+                switch (phase) {
+                case Water:
+                    return local.toAutoDiffBlock(fluid_.muWat(local[0], local[1], cells_));
+                case Oil:
+                    return local.toAutoDiffBlock(fluid_.muOil(local[0], local[1], local[2], cond, cells_));
+                case Gas:
+                    return local.toAutoDiffBlock(fluid_.muGas(local[0], local[1], local[3], cond, cells_));
+                default:
+                    OPM_THROW(std::runtime_error, "Unknown phase index " << phase);
+                }
+            }
+        }
+
         switch (phase) {
         case Water:
             return fluid_.muWat(p, temp, cells_);
@@ -1974,6 +2019,22 @@ typedef Eigen::Array<double,
                      const ADB&              rv   ,
                      const std::vector<PhasePresence>& cond) const
     {
+        if (param_.use_local_ad_properties_) {
+            const LocalAutoDiff local({ &p, &temp, &rs, &rv });
+            if (local.valid()) {
+                switch (phase) {
+                case Water:
+                    return local.toAutoDiffBlock(fluid_.bWat(local[0], local[1], cells_));
+                case Oil:
+                    return local.toAutoDiffBlock(fluid_.bOil(local[0], local[1], local[2], cond, cells_));
+                case Gas:
+                    return local.toAutoDiffBlock(fluid_.bGas(local[0], local[1], local[3], cond, cells_));
+                default:
+                    OPM_THROW(std::runtime_error, "Unknown phase index " << phase);
+                }
+            }
+        }
+
         switch (phase) {
         case Water:
             return fluid_.bWat(p, temp, cells_);
@@ -42,6 +42,7 @@
 #include <opm/autodiff/DefaultBlackoilSolutionState.hpp>
 #include <opm/autodiff/BlackoilDetails.hpp>
 #include <opm/autodiff/BlackoilModelEnums.hpp>
+#include <opm/autodiff/FusedWellMatrixProduct.hpp>
 #include <opm/autodiff/NewtonIterationBlackoilInterface.hpp>
 
 #include <opm/core/grid.h>
@@ -73,6 +74,7 @@
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <array>
 #include <vector>
 #include <algorithm>
 //#include <fstream>
@@ -136,6 +138,8 @@ namespace Opm {
         typedef Dune::BlockVector<VectorBlockType>      BVector;
 
         typedef ISTLSolver< MatrixBlockType, VectorBlockType >  ISTLSolverType;
+        // one value per phase, used by the convergence check
+        typedef std::array< Scalar, Opm::BlackoilPhases::MaxNumPhases > PhaseValues;
         //typedef typename SolutionVector :: value_type            PrimaryVariables ;
 
         struct FIPData {
@@ -459,6 +463,18 @@ namespace Opm {
             return istlSolver().iterations();
         }
 
+        /// Number of linear solves that reused the preconditioner of a previous solve.
+        int linearPreconditionerReuses() const
+        {
+            return istlSolver().preconditionerReuses();
+        }
+
+        /// Number of linear solves that set up the preconditioner from scratch.
+        int linearPreconditionerRebuilds() const
+        {
+            return istlSolver().preconditionerRebuilds();
+        }
+
         template <class X, class Y>
         void applyWellModelAdd(const X& x, Y& y )
         {
@@ -471,6 +487,20 @@ namespace Opm {
             wellModel().applyScaleAdd(alpha, x, y);
         }
 
+        /// Whether the linear operator applies the matrix and the wells in one pass.
+        bool useFusedWellOperator() const { return param_.use_fused_well_operator_; }
+
+        /// y = A x - B^T inv(D) C x if overwrite is true,
+        /// y += alpha * (A x - B^T inv(D) C x) otherwise,
+        /// computed in a single traversal of A.
+        template <class X, class Y>
+        void applyFusedWellModel(const Mat& A, const Scalar alpha, const X& x, Y& y, const bool overwrite )
+        {
+            const auto& wells = wellModel();
+            wells.computeWellContributions(x);
+            fusedWellMatrixProduct(A, x, y, wells.perforatedCellIndex(), wells.wellContributions(), alpha, overwrite);
+        }
+
         /// Solve the Jacobian system Jx = r where J is the Jacobian and
         /// r is the residual.
         void solveJacobianSystem(BVector& x, BVector& xw) const
@@ -559,9 +589,16 @@ namespace Opm {
 
           virtual void apply( const X& x, Y& y ) const
           {
-            A_.mv( x, y );
-            // add well model modification to y
-            wellMod_.applyWellModelAdd(x, y );
+            if( wellMod_.useFusedWellOperator() )
+            {
+              wellMod_.applyFusedWellModel( A_, 1.0, x, y, true );
+            }
+            else
+            {
+              A_.mv( x, y );
+              // add well model modification to y
+              wellMod_.applyWellModelAdd(x, y );
+            }
 
 #if HAVE_MPI
             if( comm_ )
@@ -572,9 +609,17 @@ namespace Opm {
           // y += \alpha * A * x
           virtual void applyscaleadd (field_type alpha, const X& x, Y& y) const
           {
-            A_.usmv(alpha,x,y);
-            // add scaled well model modification to y
-            wellMod_.applyWellModelScaleAdd( alpha, x, y );
+            if( wellMod_.useFusedWellOperator() )
+            {
+              wellMod_.applyFusedWellModel( A_, alpha, x, y, false );
+            }
+            else
+            {
+              A_.usmv(alpha,x,y);
+              // add scaled well model modification to y, in place and
+              // restricted to the perforated cells
+              wellMod_.applyWellModelScaleAdd( alpha, x, y );
+            }
 
 #if HAVE_MPI
             if( comm_ )
@@ -771,89 +816,132 @@ namespace Opm {
             return terminal_output_;
         }
 
+        /// Compute the quantities needed for the convergence check in a single
+        /// pass over the cells, and reduce them over all processes with
+        /// one sum and one max reduction:
+        /// B_avg is the average of 1/b, R_sum the sum of the residuals and
+        /// maxCoeff the maximum of |R|/pv for each phase, maxNormWell the
+        /// maximum of the well residuals. Returns the total pore volume.
+        /// No memory is allocated once the buffers have reached their size.
         template <class CollectiveCommunication>
         double convergenceReduction(const CollectiveCommunication& comm,
                                     const long int ncGlobal,
                                     const int np,
-                                    const std::vector< std::vector< Scalar > >& B,
-                                    const std::vector< std::vector< Scalar > >& tempV,
-                                    const std::vector< std::vector< Scalar > >& R,
-                                    const std::vector< Scalar >& pv,
                                     const std::vector< Scalar >& residual_well,
-                                    std::vector< Scalar >& R_sum,
-                                    std::vector< Scalar >& maxCoeff,
-                                    std::vector< Scalar >& B_avg,
-                                    std::vector< Scalar >& maxNormWell )
+                                    PhaseValues& R_sum,
+                                    PhaseValues& maxCoeff,
+                                    PhaseValues& B_avg,
+                                    PhaseValues& maxNormWell )
         {
+            const int maxnp = Opm::BlackoilPhases::MaxNumPhases;
+            assert( np <= maxnp );
+
             const int nw = residual_well.size() / np;
             assert(nw * np == int(residual_well.size()));
 
-            // Do the global reductions
-            B_avg.resize(np);
-            maxCoeff.resize(np);
-            R_sum.resize(np);
-            maxNormWell.resize(np);
+            const int nc = Opm::AutoDiffGrid::numCells(grid_);
+            const auto& pv = geo_.poreVolume();
+            const auto& ebosResid = ebosSimulator_.model().linearizer().residual();
 
-            // computation
+            int ebosPhaseIdx[ maxnp ];
+            int ebosCompIdx[ maxnp ];
             for ( int idx = 0; idx < np; ++idx )
             {
-                B_avg[idx] = std::accumulate( B[ idx ].begin(), B[ idx ].end(), 0.0 ) / double(ncGlobal);
-                R_sum[idx] = std::accumulate( R[ idx ].begin(), R[ idx ].end(), 0.0 );
-                maxCoeff[idx] = *(std::max_element( tempV[ idx ].begin(), tempV[ idx ].end() ));
-
-                assert(np >= np);
-                if (idx < np) {
-                    maxNormWell[idx] = 0.0;
-                    for ( int w = 0; w < nw; ++w ) {
-                        maxNormWell[idx] = std::max(maxNormWell[idx], std::abs(residual_well[nw*idx + w]));
-                    }
-                }
+                ebosPhaseIdx[ idx ] = flowPhaseToEbosPhaseIdx( idx );
+                ebosCompIdx[ idx ] = flowPhaseToEbosCompIdx( idx );
             }
 
-            // Compute total pore volume
-            double pvSum = std::accumulate(pv.begin(), pv.end(), 0.0);
+            // values reduced by sum: B (np), R (np) and pore volume (1),
+            // followed by the values reduced by max: |R|/pv (np) and well residuals (np)
+            const int numSum = 2*np + 1;
+            const int numValues = numSum + 2*np;
+            Scalar values[ 4*maxnp + 1 ];
+            std::fill( values, values + numValues, 0.0 );
+            Scalar* B_sum     = values;
+            Scalar* R_sumLoc  = values + np;
+            Scalar* pvSum     = values + 2*np;
+            Scalar* maxCoeffLoc = values + numSum;
+            Scalar* maxWell   = values + numSum + np;
+
+            // The cells are split into chunks of a fixed size, independent
+            // of the number of threads, and the partial results of the
+            // chunks are combined in chunk order afterwards, such that the
+            // sums are reproducible.
+            const int chunkSize = 1024;
+            const int numChunks = (nc + chunkSize - 1) / chunkSize;
+            const int numPartial = 3*np + 1;
+            const std::size_t numPartialValues = numChunks * numPartial;
+            if( convergencePartial_.size() < numPartialValues ) {
+                convergencePartial_.resize( numPartialValues );
+            }
+            std::fill( convergencePartial_.begin(), convergencePartial_.begin() + numPartialValues, 0.0 );
+            Scalar* const partial = convergencePartial_.data();
 
-            if( comm.size() > 1 )
+#pragma omp parallel for schedule(static)
+            for ( int chunk = 0; chunk < numChunks; ++chunk )
             {
-                // global reduction
-                std::vector< Scalar > sumBuffer;
-                std::vector< Scalar > maxBuffer;
-                sumBuffer.reserve( B_avg.size() + R_sum.size() + 1 );
-                maxBuffer.reserve( maxCoeff.size() + maxNormWell.size() );
-                for( int idx = 0; idx < np; ++idx )
-                {
-                    sumBuffer.push_back( B_avg[ idx ] );
-                    sumBuffer.push_back( R_sum[ idx ] );
-                    maxBuffer.push_back( maxCoeff[ idx ] );
-                    maxBuffer.push_back( maxNormWell[ idx ] );
-                }
+                Scalar* B_chunk   = partial + chunk * numPartial;
+                Scalar* R_chunk   = B_chunk + np;
+                Scalar* max_chunk = B_chunk + 2*np;
+                Scalar& pv_chunk  = B_chunk[ 3*np ];
 
-                // Compute total pore volume
-                sumBuffer.push_back( pvSum );
-
-                // compute global sum
-                comm.sum( sumBuffer.data(), sumBuffer.size() );
+                const int end = std::min( nc, (chunk + 1) * chunkSize );
+                for ( int cell_idx = chunk * chunkSize; cell_idx < end; ++cell_idx )
+                {
+                    const auto& intQuants = *(ebosSimulator_.model().cachedIntensiveQuantities(cell_idx, /*timeIdx=*/0));
+                    const auto& fs = intQuants.fluidState();
+                    const auto& cellResid = ebosResid[ cell_idx ];
+                    const Scalar pvCell = pv[ cell_idx ];
+                    pv_chunk += pvCell;
 
-                // compute global max
-                comm.max( maxBuffer.data(), maxBuffer.size() );
+                    for ( int idx = 0; idx < np; ++idx )
+                    {
+                        const Scalar R = cellResid[ ebosCompIdx[ idx ] ];
+                        B_chunk[ idx ] += 1 / fs.invB( ebosPhaseIdx[ idx ] ).value();
+                        R_chunk[ idx ] += R;
+                        max_chunk[ idx ] = std::max( max_chunk[ idx ], std::abs( R ) / pvCell );
+                    }
+                }
+            }
 
-                // restore values to local variables
-                for( int idx = 0, buffIdx = 0; idx < np; ++idx, ++buffIdx )
+            for ( int chunk = 0; chunk < numChunks; ++chunk )
+            {
+                const Scalar* B_chunk   = partial + chunk * numPartial;
+                const Scalar* R_chunk   = B_chunk + np;
+                const Scalar* max_chunk = B_chunk + 2*np;
+                for ( int idx = 0; idx < np; ++idx )
                 {
-                    B_avg[ idx ]    = sumBuffer[ buffIdx ];
-                    maxCoeff[ idx ] = maxBuffer[ buffIdx ];
-                    ++buffIdx;
+                    B_sum[ idx ] += B_chunk[ idx ];
+                    R_sumLoc[ idx ] += R_chunk[ idx ];
+                    maxCoeffLoc[ idx ] = std::max( maxCoeffLoc[ idx ], max_chunk[ idx ] );
+                }
+                *pvSum += B_chunk[ 3*np ];
+            }
 
-                    R_sum[ idx ]       = sumBuffer[ buffIdx ];
-                    maxNormWell[ idx ] = maxBuffer[ buffIdx ];
+            for ( int idx = 0; idx < np; ++idx )
+            {
+                for ( int w = 0; w < nw; ++w ) {
+                    maxWell[ idx ] = std::max( maxWell[ idx ], std::abs( residual_well[ nw*idx + w ] ) );
                 }
+            }
+
+            if( comm.size() > 1 )
+            {
+                // global reduction
+                comm.sum( values, numSum );
+                comm.max( values + numSum, numValues - numSum );
+            }
 
-                // restore global pore volume
-                pvSum = sumBuffer.back();
+            for ( int idx = 0; idx < np; ++idx )
+            {
+                B_avg[ idx ] = B_sum[ idx ] / double(ncGlobal);
+                R_sum[ idx ] = R_sumLoc[ idx ];
+                maxCoeff[ idx ] = maxCoeffLoc[ idx ];
+                maxNormWell[ idx ] = maxWell[ idx ];
             }
 
             // return global pore volume
-            return pvSum;
+            return *pvSum;
         }
 
         /// Compute convergence based on total mass balance (tol_mb) and maximum
@@ -863,67 +951,27 @@ namespace Opm {
         /// \param[in]   iteration   current iteration number
         bool getConvergence(const SimulatorTimerInterface& timer, const int iteration, std::vector<double>& residual_norms)
         {
-            typedef std::vector< double > Vector;
-
             const double dt = timer.currentStepLength();
             const double tol_mb    = param_.tolerance_mb_;
             const double tol_cnv   = param_.tolerance_cnv_;
             const double tol_wells = param_.tolerance_wells_;
 
-            const int nc = Opm::AutoDiffGrid::numCells(grid_);
             const int np = numPhases();
 
-            const auto& pv = geo_.poreVolume();
-
-            Vector R_sum(np);
-            Vector B_avg(np);
-            Vector maxCoeff(np);
-            Vector maxNormWell(np);
-
-            std::vector< Vector > B( np, Vector( nc ) );
-            std::vector< Vector > R( np, Vector( nc ) );
-            std::vector< Vector > R2( np, Vector( nc ) );
-            std::vector< Vector > tempV( np, Vector( nc ) );
-
-            const auto& ebosResid = ebosSimulator_.model().linearizer().residual();
-
-            for ( int idx = 0; idx < np; ++idx )
-            {
-                Vector& R2_idx = R2[ idx ];
-                Vector& B_idx  = B[ idx ];
-                const int ebosPhaseIdx = flowPhaseToEbosPhaseIdx(idx);
-                const int ebosCompIdx = flowPhaseToEbosCompIdx(idx);
+            PhaseValues R_sum;
+            PhaseValues B_avg;
+            PhaseValues maxCoeff;
+            PhaseValues maxNormWell;
 
-                for (int cell_idx = 0; cell_idx < nc; ++cell_idx) {
-                    const auto& intQuants = *(ebosSimulator_.model().cachedIntensiveQuantities(cell_idx, /*timeIdx=*/0));
-                    const auto& fs = intQuants.fluidState();
-
-                    B_idx [cell_idx] = 1 / fs.invB(ebosPhaseIdx).value();
-                    R2_idx[cell_idx] = ebosResid[cell_idx][ebosCompIdx];
-                }
-            }
-
-            for ( int idx = 0; idx < np; ++idx )
-            {
-                //tempV.col(idx)   = R2.col(idx).abs()/pv;
-                Vector& tempV_idx = tempV[ idx ];
-                Vector& R2_idx    = R2[ idx ];
-                for( int cell_idx = 0; cell_idx < nc; ++cell_idx )
-                {
-                    tempV_idx[ cell_idx ] = std::abs( R2_idx[ cell_idx ] ) / pv[ cell_idx ];
-                }
-            }
-
-            Vector pv_vector (geo_.poreVolume().data(), geo_.poreVolume().data() + geo_.poreVolume().size());
-            Vector wellResidual =  wellModel().residual();
+            wellModel().residual( wellResidual_ );
 
             const double pvSum = convergenceReduction(grid_.comm(), global_nc_, np,
-                                                      B, tempV, R2, pv_vector, wellResidual,
+                                                      wellResidual_,
                                                       R_sum, maxCoeff, B_avg, maxNormWell );
 
-            Vector CNV(np);
-            Vector mass_balance_residual(np);
-            Vector well_flux_residual(np);
+            PhaseValues CNV;
+            PhaseValues mass_balance_residual;
+            PhaseValues well_flux_residual;
 
             bool converged_MB = true;
             bool converged_CNV = true;
@@ -1241,6 +1289,13 @@ namespace Opm {
         BVector dx_old_;
         mutable FIPData fip_;
 
+        // cell volume over reference density, see cellScaleFactors()
+        mutable std::vector<VectorBlockType> cellScaleFactors_;
+
+        // buffers of getConvergence(), which only grow
+        std::vector<Scalar> convergencePartial_;
+        std::vector<Scalar> wellResidual_;
+
 
 
         // ---------  Protected methods  ---------
@@ -1382,51 +1437,75 @@ namespace Opm {
             const int numCells = ebosJac.N();
             assert( numCells == static_cast<int>(ebosJac.M()) );
 
-            // write the right-hand-side values from the ebosJac into the objects
-            // allocated above.
-            const auto endrow = ebosJac.end();
-            for( int cellIdx = 0; cellIdx < numCells; ++cellIdx )
+            const std::vector<VectorBlockType>& scaleFactors = cellScaleFactors(numCells);
+
+            // component indices of the residual entries and the Jacobian rows
+            // which are scaled by scaleFactors[cellIdx][flowPhaseIdx]
+            int resCompIdx[ 3 ];
+            int jacCompIdx[ 3 ];
+            int jacPvIdx[ 3 ];
+            for( int flowPhaseIdx = 0; flowPhaseIdx < numFlowPhases; ++flowPhaseIdx )
             {
-                const double cellVolume = ebosSimulator_.model().dofTotalVolume(cellIdx);
-                auto& cellRes = ebosResid[ cellIdx ];
+                resCompIdx[ flowPhaseIdx ] = flowPhaseToEbosCompIdx( flowPhaseIdx );
+                jacCompIdx[ flowPhaseIdx ] = flowPhaseToEbosCompIdx( pu.phase_pos[ flowPhaseIdx ] );
+                jacPvIdx[ flowPhaseIdx ] = flowToEbosPvIdx( flowPhaseIdx );
+            }
 
-                unsigned pvtRegionIdx = ebosSimulator_.problem().pvtRegionIndex(cellIdx);
+            // translate the residual and the Jacobian from the format used by ebos
+            // to the one expected by flow, one row at a time
+#pragma omp parallel for schedule(static)
+            for( int cellIdx = 0; cellIdx < numCells; ++cellIdx )
+            {
+                const VectorBlockType& scale = scaleFactors[ cellIdx ];
 
+                auto& cellRes = ebosResid[ cellIdx ];
                 for( int flowPhaseIdx = 0; flowPhaseIdx < numFlowPhases; ++flowPhaseIdx )
                 {
-                    const int canonicalFlowPhaseIdx = pu.phase_pos[flowPhaseIdx];
-                    const int ebosPhaseIdx = flowPhaseToEbosPhaseIdx(canonicalFlowPhaseIdx);
-                    const double refDens = FluidSystem::referenceDensity(ebosPhaseIdx, pvtRegionIdx);
-                    cellRes[ flowPhaseToEbosCompIdx( flowPhaseIdx ) ] /= refDens;
-                    cellRes[ flowPhaseToEbosCompIdx( flowPhaseIdx ) ] *= cellVolume;
+                    cellRes[ resCompIdx[ flowPhaseIdx ] ] *= scale[ flowPhaseIdx ];
+                }
+
+                auto& row = ebosJac[ cellIdx ];
+                const auto endcol = row.end();
+                for( auto col = row.begin(); col != endcol; ++col )
+                {
+                    for( int flowPhaseIdx = 0; flowPhaseIdx < numFlowPhases; ++flowPhaseIdx )
+                    {
+                        auto& jacRow = (*col)[ jacCompIdx[ flowPhaseIdx ] ];
+                        for( int pvIdx=0; pvIdx<numFlowPhases; ++pvIdx )
+                        {
+                            jacRow[ jacPvIdx[ pvIdx ] ] *= scale[ flowPhaseIdx ];
+                        }
+                    }
                 }
             }
+        }
 
-            for( auto row = ebosJac.begin(); row != endrow; ++row )
+        /// Cell volume divided by the reference density of every flow phase
+        /// for each cell. Both only depend on the grid and the PVT region,
+        /// hence they are computed once.
+        const std::vector<VectorBlockType>& cellScaleFactors(const int numCells) const
+        {
+            if( static_cast<int>(cellScaleFactors_.size()) != numCells )
             {
-                const int rowIdx = row.index();
-                const double cellVolume = ebosSimulator_.model().dofTotalVolume(rowIdx);
-                unsigned pvtRegionIdx = ebosSimulator_.problem().pvtRegionIndex(rowIdx);
-
-                // translate the Jacobian of the residual from the format used by ebos to
-                // the one expected by flow
-                const auto endcol = row->end();
-                for( auto col = row->begin(); col != endcol; ++col )
+                const Opm::PhaseUsage pu = fluid_.phaseUsage();
+                const int numFlowPhases = pu.num_phases;
+                cellScaleFactors_.resize( numCells );
+                for( int cellIdx = 0; cellIdx < numCells; ++cellIdx )
                 {
+                    const double cellVolume = ebosSimulator_.model().dofTotalVolume(cellIdx);
+                    const unsigned pvtRegionIdx = ebosSimulator_.problem().pvtRegionIndex(cellIdx);
+                    auto& scale = cellScaleFactors_[ cellIdx ];
+                    scale = 0.0;
                     for( int flowPhaseIdx = 0; flowPhaseIdx < numFlowPhases; ++flowPhaseIdx )
                     {
                         const int canonicalFlowPhaseIdx = pu.phase_pos[flowPhaseIdx];
                         const int ebosPhaseIdx = flowPhaseToEbosPhaseIdx(canonicalFlowPhaseIdx);
-                        const int ebosCompIdx = flowPhaseToEbosCompIdx(canonicalFlowPhaseIdx);
                         const double refDens = FluidSystem::referenceDensity(ebosPhaseIdx, pvtRegionIdx);
-                        for( int pvIdx=0; pvIdx<numFlowPhases; ++pvIdx )
-                        {
-                            (*col)[ebosCompIdx][flowToEbosPvIdx(pvIdx)] /= refDens;
-                            (*col)[ebosCompIdx][flowToEbosPvIdx(pvIdx)] *= cellVolume;
-                        }
+                        scale[ flowPhaseIdx ] = cellVolume / refDens;
                     }
                 }
             }
+            return cellScaleFactors_;
         }
 
         int flowPhaseToEbosPhaseIdx( const int phaseIdx ) const
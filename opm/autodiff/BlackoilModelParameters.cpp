@@ -56,6 +56,8 @@ namespace Opm
         update_equations_scaling_ = param.getDefault("update_equations_scaling", update_equations_scaling_);
         compute_well_potentials_ = param.getDefault("compute_well_potentials", compute_well_potentials_);
         use_update_stabilization_ = param.getDefault("use_update_stabilization", use_update_stabilization_);
+        use_fused_well_operator_ = param.getDefault("use_fused_well_operator", use_fused_well_operator_);
+        use_local_ad_properties_ = param.getDefault("use_local_ad_properties", use_local_ad_properties_);
         deck_file_name_ = param.template get<std::string>("deck_filename");
     }
 
@@ -80,6 +82,8 @@ namespace Opm
         update_equations_scaling_ = false;
         compute_well_potentials_ = false;
         use_update_stabilization_ = true;
+        use_fused_well_operator_ = false;
+        use_local_ad_properties_ = false;
     }
 
 
@@ -69,6 +69,15 @@ namespace Opm
         /// Try to detect oscillation or stagnation.
         bool use_update_stabilization_;
 
+        /// Apply the reservoir matrix and the well contributions in a
+        /// single pass in the linear operator of the linear solver.
+        bool use_fused_well_operator_;
+
+        /// Evaluate viscosities, formation volume factors and relative
+        /// permeabilities with cell-local dense derivatives instead of
+        /// global sparse jacobians, see LocalAutoDiff.
+        bool use_local_ad_properties_;
+
         // The file name of the deck
         std::string deck_file_name_;
 
@@ -35,6 +35,14 @@
 #include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
 
 #include <opm/common/ErrorMacros.hpp>
+#include <opm/common/OpmLog/OpmLog.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <vector>
 
 namespace Opm
 {
@@ -134,6 +142,11 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
     vap1_             = props.vap1_;
     vap2_             = props.vap2_;
     vap_satmax_guard_ = props.vap_satmax_guard_;
+    pvtTablePoints_   = props.pvtTablePoints_;
+    pvtTablePmin_     = props.pvtTablePmin_;
+    pvtTablePmax_     = props.pvtTablePmax_;
+    pvtTableTemperature_ = props.pvtTableTemperature_;
+    pvtTables_        = props.pvtTables_;
     // For data that is dependant on the subgrid we simply allocate space
     // and initialize with obviously bogus numbers.
     cellPvtRegionIdx_.resize(number_of_cells, std::numeric_limits<int>::min());
@@ -211,6 +224,143 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
                       << ") and saturation-dependent function data (" << satprops_->numPhases() << ").");
         }
         vap_satmax_guard_ = 0.01;
+
+        pvtTablePoints_ = 0;
+        pvtTablePmin_ = 0.0;
+        pvtTablePmax_ = 0.0;
+        pvtTableTemperature_ = 0.0;
+        pvtTables_ = PvtTables();
+    }
+
+    void BlackoilPropsAdFromDeck::tabulatePvt(const int num_points,
+                                              const double pmin,
+                                              const double pmax,
+                                              const double temperature)
+    {
+        if (num_points >= 2 && !(pmax > pmin)) {
+            OPM_THROW(std::runtime_error, "The pressure range of the PVT tables is empty: ["
+                      << pmin << ", " << pmax << "]");
+        }
+        pvtTablePoints_ = num_points;
+        pvtTablePmin_ = pmin;
+        pvtTablePmax_ = pmax;
+        pvtTableTemperature_ = temperature;
+        pvtTables_ = PvtTables();
+        if (num_points < 2) {
+            return;
+        }
+
+        const int numRegions = surfaceDensity_.size();
+        const int numPoints = pvtTablePoints_;
+        const double h = (pvtTablePmax_ - pvtTablePmin_) / (numPoints - 1);
+        std::vector<double> p(numPoints);
+        for (int k = 0; k < numPoints; ++k) {
+            p[k] = k + 1 < numPoints ? pvtTablePmin_ + k * h : pvtTablePmax_;
+        }
+
+        // The exact functions are only known through evaluations, so the
+        // interpolation error is estimated at three points inside every
+        // interval of the grid.
+        std::ostringstream ss;
+        ss << "PVT functions at temperature " << temperature << " K tabulated at "
+           << numPoints << " pressures in [" << pvtTablePmin_ << ", " << pvtTablePmax_
+           << "] Pa, largest estimated errors:";
+        const auto tabulate = [&](const char* name,
+                                  std::vector<ResampledTableLinear>& tables,
+                                  const std::function<double(int, double)>& f) {
+            double error = 0.0;
+            double relative_error = 0.0;
+            tables.resize(numRegions);
+            for (int region = 0; region < numRegions; ++region) {
+                std::vector<double> values(numPoints);
+                for (int k = 0; k < numPoints; ++k) {
+                    values[k] = f(region, p[k]);
+                }
+                tables[region] = ResampledTableLinear(p, values);
+                tables[region].resample(numPoints);
+
+                for (int k = 0; k + 1 < numPoints; ++k) {
+                    for (int j = 1; j < 4; ++j) {
+                        const double pj = p[k] + 0.25 * j * (p[k + 1] - p[k]);
+                        const double exact = f(region, pj);
+                        const double e = std::fabs(tables[region](pj) - exact);
+                        error = std::max(error, e);
+                        if (exact != 0.0) {
+                            relative_error = std::max(relative_error, e / std::fabs(exact));
+                        }
+                    }
+                }
+            }
+            ss << "\n    " << std::setw(14) << std::left << name << std::setw(12) << error
+               << " (relative " << relative_error << ")";
+        };
+
+        PvtTables& tables = pvtTables_;
+        const double T = temperature;
+        if (phase_usage_.phase_used[Water]) {
+            tabulate("bWat", tables.bWat, [&](const int r, const double pw) {
+                    return waterPvt_->inverseFormationVolumeFactor(r, T, pw);
+                });
+            tabulate("muWat", tables.muWat, [&](const int r, const double pw) {
+                    return waterPvt_->viscosity(r, T, pw);
+                });
+        }
+        if (phase_usage_.phase_used[Oil]) {
+            if (phase_usage_.phase_used[Gas]) {
+                tabulate("bOil (sat)", tables.bOil, [&](const int r, const double po) {
+                        return oilPvt_->saturatedInverseFormationVolumeFactor(r, T, po);
+                    });
+                tabulate("muOil (sat)", tables.muOil, [&](const int r, const double po) {
+                        return oilPvt_->saturatedViscosity(r, T, po);
+                    });
+            } else {
+                tabulate("bOil", tables.bOil, [&](const int r, const double po) {
+                        return oilPvt_->inverseFormationVolumeFactor(r, T, po, 0.0);
+                    });
+                tabulate("muOil", tables.muOil, [&](const int r, const double po) {
+                        return oilPvt_->viscosity(r, T, po, 0.0);
+                    });
+            }
+            tabulate("rsSat", tables.rsSat, [&](const int r, const double po) {
+                    return oilPvt_->saturatedGasDissolutionFactor(r, T, po);
+                });
+        }
+        if (phase_usage_.phase_used[Gas]) {
+            tabulate("bGas (sat)", tables.bGas, [&](const int r, const double pg) {
+                    return gasPvt_->saturatedInverseFormationVolumeFactor(r, T, pg);
+                });
+            tabulate("muGas (sat)", tables.muGas, [&](const int r, const double pg) {
+                    return gasPvt_->saturatedViscosity(r, T, pg);
+                });
+            tabulate("rvSat", tables.rvSat, [&](const int r, const double pg) {
+                    return gasPvt_->saturatedOilVaporizationFactor(r, T, pg);
+                });
+        }
+        OpmLog::info(ss.str());
+    }
+
+    const BlackoilPropsAdFromDeck::PvtTables*
+    BlackoilPropsAdFromDeck::pvtTables(const ADB& T) const
+    {
+        const V& t = T.value();
+        if (pvtTablePoints_ < 2) {
+            return nullptr;
+        }
+        for (int i = 0; i < t.size(); ++i) {
+            if (t[i] != pvtTableTemperature_) {
+                return nullptr;
+            }
+        }
+        return &pvtTables_;
+    }
+
+    const BlackoilPropsAdFromDeck::PvtTables*
+    BlackoilPropsAdFromDeck::pvtTables(const double temperature) const
+    {
+        if (pvtTablePoints_ < 2 || temperature != pvtTableTemperature_) {
+            return nullptr;
+        }
+        return &pvtTables_;
     }
 
     ////////////////////////////
@@ -280,6 +430,120 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
     }
 
 
+    namespace {
+        // Positions 0, ..., n-1 of the cells ordered by PVT region, so the
+        // cells sharing a table are evaluated together and, with a static
+        // schedule, mostly by the same thread. Empty if all the cells are
+        // in the same region.
+        std::vector<int> pvtRegionOrder(const std::vector<int>& cellPvtRegionIdx,
+                                        const std::vector<int>& cells)
+        {
+            const int n = cells.size();
+            int maxRegion = 0;
+            bool singleRegion = true;
+            for (int i = 0; i < n; ++i) {
+                const int region = cellPvtRegionIdx[cells[i]];
+                maxRegion = std::max(maxRegion, region);
+                singleRegion = singleRegion && region == cellPvtRegionIdx[cells[0]];
+            }
+            std::vector<int> order;
+            if (singleRegion) {
+                return order;
+            }
+            std::vector<int> start(maxRegion + 2, 0);
+            for (int i = 0; i < n; ++i) {
+                ++start[cellPvtRegionIdx[cells[i]] + 1];
+            }
+            for (int region = 0; region <= maxRegion; ++region) {
+                start[region + 1] += start[region];
+            }
+            order.resize(n);
+            for (int i = 0; i < n; ++i) {
+                order[start[cellPvtRegionIdx[cells[i]]]++] = i;
+            }
+            return order;
+        }
+
+        // Evaluates the PVT tables at x for the cells i with tabulated(i),
+        // with one call to evaluate() per PVT region: the cells of a
+        // region are gathered in the order of pvtRegionOrder() into
+        // contiguous buffers, and the results scattered to y and dy.
+        // Returns which cells were evaluated.
+        template <class Tabulated>
+        std::vector<char> evaluatePvtTables(const std::vector<ResampledTableLinear>& tables,
+                                            const std::vector<int>& cellPvtRegionIdx,
+                                            const std::vector<int>& cells,
+                                            const std::vector<int>& order,
+                                            const V& x,
+                                            const Tabulated& tabulated,
+                                            V& y,
+                                            V& dy)
+        {
+            const int n = cells.size();
+            std::vector<char> done(n, 0);
+            std::vector<int> idx;
+            std::vector<double> xs, ys, dys;
+            int k = 0;
+            while (k < n) {
+                const int region = cellPvtRegionIdx[cells[order.empty() ? k : order[k]]];
+                idx.clear();
+                xs.clear();
+                for (; k < n; ++k) {
+                    const int i = order.empty() ? k : order[k];
+                    if (cellPvtRegionIdx[cells[i]] != region) {
+                        break;
+                    }
+                    if (tabulated(i)) {
+                        idx.push_back(i);
+                        xs.push_back(x[i]);
+                    }
+                }
+                const int m = idx.size();
+                if (m == 0) {
+                    continue;
+                }
+                ys.resize(m);
+                dys.resize(m);
+                tables[region].evaluate(xs.data(), ys.data(), dys.data(), m);
+                for (int j = 0; j < m; ++j) {
+                    y[idx[j]] = ys[j];
+                    dy[idx[j]] = dys[j];
+                    done[idx[j]] = 1;
+                }
+            }
+            return done;
+        }
+
+        // Jacobians df/dx * x.derivative() of a cell-wise function f(x),
+        // obtained by scaling the rows of the blocks of x: diagonal blocks
+        // stay diagonal and sparse blocks keep their pattern.
+        std::vector<ADB::M> chainRule(const V& dfdx, const ADB& x)
+        {
+            std::vector<ADB::M> jacs(x.derivative());
+            for (ADB::M& jac : jacs) {
+                jac.scaleRows(dfdx);
+            }
+            return jacs;
+        }
+
+        // Jacobians df/dx * x.derivative() + df/dy * y.derivative() of a
+        // cell-wise function f(x, y).
+        std::vector<ADB::M> chainRule(const V& dfdx, const ADB& x,
+                                      const V& dfdy, const ADB& y)
+        {
+            std::vector<ADB::M> jacs = chainRule(dfdx, x);
+            if (!y.derivative().empty()) {
+                for (std::size_t block = 0; block < jacs.size(); ++block) {
+                    ADB::M temp = y.derivative()[block];
+                    jacs[block] += temp.scaleRows(dfdy);
+                }
+            }
+            return jacs;
+        }
+    }
+
+
+
     // ------ Viscosity ------
 
 
@@ -303,15 +567,23 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/1> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 0.0;
-
-        pEval.setDerivative(0, 1.0);
-
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(pw.value()[i]);
-            TEval.setValue(T.value()[i]);
+        const PvtTables* tables = pvtTables(T);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->muWat, cellPvtRegionIdx_, cells, order, pw.value(),
+                                [&](const int i) { return inPvtTableRange(pw.value()[i]); },
+                                mu, dmudp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                continue;
+            }
+            Eval pEval = pw.value()[i];
+            pEval.setDerivative(0, 1.0);
+            const Eval TEval = T.value()[i];
 
             const Eval& muEval = waterPvt_->viscosity(pvtRegionIdx, TEval, pEval);
 
@@ -322,13 +594,7 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
         if (pw.derivative().empty()) {
             return ADB::constant(std::move(mu));
         } else {
-            ADB::M dmudp_diag(dmudp.matrix().asDiagonal());
-            const int num_blocks = pw.numBlocks();
-            std::vector<ADB::M> jacs(num_blocks);
-            for (int block = 0; block < num_blocks; ++block) {
-                fastSparseProduct(dmudp_diag, pw.derivative()[block], jacs[block]);
-            }
-            return ADB::function(std::move(mu), std::move(jacs));
+            return ADB::function(std::move(mu), chainRule(dmudp, pw));
         }
     }
 
@@ -356,23 +622,35 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/2> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 0.0;
-        Eval RsEval = 0.0;
-
-        pEval.setDerivative(0, 1.0);
-        RsEval.setDerivative(1, 1.0);
-
-        Eval muEval;
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(po.value()[i]);
-            TEval.setValue(T.value()[i]);
+        const PvtTables* tables = pvtTables(T);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->muOil, cellPvtRegionIdx_, cells, order, po.value(),
+                                [&](const int i) {
+                                    return inPvtTableRange(po.value()[i])
+                                        && (cond[i].hasFreeGas() || !phase_usage_.phase_used[Gas]);
+                                },
+                                mu, dmudp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                dmudr[i] = 0.0;
+                continue;
+            }
+            Eval pEval = po.value()[i];
+            pEval.setDerivative(0, 1.0);
+            const Eval TEval = T.value()[i];
 
+            Eval muEval;
             if (cond[i].hasFreeGas()) {
                 muEval = oilPvt_->saturatedViscosity(pvtRegionIdx, TEval, pEval);
             }
             else {
+                Eval RsEval = 0.0;
+                RsEval.setDerivative(1, 1.0);
                 if (phase_usage_.phase_used[Gas]) {
                     RsEval.setValue(rs.value()[i]);
                 }
@@ -384,19 +662,11 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
             dmudr[i] = muEval.derivative(1);
         }
 
-        ADB::M dmudp_diag(dmudp.matrix().asDiagonal());
-        ADB::M dmudr_diag(dmudr.matrix().asDiagonal());
-        const int num_blocks = po.numBlocks();
-        std::vector<ADB::M> jacs(num_blocks);
-        for (int block = 0; block < num_blocks; ++block) {
-            fastSparseProduct(dmudp_diag, po.derivative()[block], jacs[block]);
-            if (phase_usage_.phase_used[Gas]) {
-                ADB::M temp;
-                fastSparseProduct(dmudr_diag, rs.derivative()[block], temp);
-                jacs[block] += temp;
-            }
+        if (phase_usage_.phase_used[Gas]) {
+            return ADB::function(std::move(mu), chainRule(dmudp, po, dmudr, rs));
+        } else {
+            return ADB::function(std::move(mu), chainRule(dmudp, po));
         }
-        return ADB::function(std::move(mu), std::move(jacs));
     }
 
     /// Gas viscosity.
@@ -423,24 +693,32 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/2> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 0.0;
-        Eval RvEval = 0.0;
-        Eval muEval;
-
-        pEval.setDerivative(0, 1.0);
-        RvEval.setDerivative(1, 1.0);
-
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(pg.value()[i]);
-            TEval.setValue(T.value()[i]);
+        const PvtTables* tables = pvtTables(T);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->muGas, cellPvtRegionIdx_, cells, order, pg.value(),
+                                [&](const int i) { return inPvtTableRange(pg.value()[i]) && cond[i].hasFreeOil(); },
+                                mu, dmudp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                dmudr[i] = 0.0;
+                continue;
+            }
+            Eval pEval = pg.value()[i];
+            pEval.setDerivative(0, 1.0);
+            const Eval TEval = T.value()[i];
 
+            Eval muEval;
             if (cond[i].hasFreeOil()) {
                 muEval = gasPvt_->saturatedViscosity(pvtRegionIdx, TEval, pEval);
             }
             else {
-                RvEval.setValue(rv.value()[i]);
+                Eval RvEval = rv.value()[i];
+                RvEval.setDerivative(1, 1.0);
                 muEval = gasPvt_->viscosity(pvtRegionIdx, TEval, pEval, RvEval);
             }
 
@@ -449,17 +727,7 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
             dmudr[i] = muEval.derivative(1);
         }
 
-        ADB::M dmudp_diag(dmudp.matrix().asDiagonal());
-        ADB::M dmudr_diag(dmudr.matrix().asDiagonal());
-        const int num_blocks = pg.numBlocks();
-        std::vector<ADB::M> jacs(num_blocks);
-        for (int block = 0; block < num_blocks; ++block) {
-            fastSparseProduct(dmudp_diag, pg.derivative()[block], jacs[block]);
-            ADB::M temp;
-            fastSparseProduct(dmudr_diag, rv.derivative()[block], temp);
-            jacs[block] += temp;
-        }
-        return ADB::function(std::move(mu), std::move(jacs));
+        return ADB::function(std::move(mu), chainRule(dmudp, pg, dmudr, rv));
     }
 
 
@@ -483,18 +751,26 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         V b(n);
         V dbdp(n);
-        V dbdr(n);
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/1> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 0.0;
-
-        pEval.setDerivative(0, 1.0);
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(pw.value()[i]);
-            TEval.setValue(T.value()[i]);
+        const PvtTables* tables = pvtTables(T);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->bWat, cellPvtRegionIdx_, cells, order, pw.value(),
+                                [&](const int i) { return inPvtTableRange(pw.value()[i]); },
+                                b, dbdp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                continue;
+            }
+            Eval pEval = pw.value()[i];
+            pEval.setDerivative(0, 1.0);
+            const Eval TEval = T.value()[i];
 
             const Eval& bEval = waterPvt_->inverseFormationVolumeFactor(pvtRegionIdx, TEval, pEval);
 
@@ -502,13 +778,7 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
             dbdp[i] = bEval.derivative(0);
         }
 
-        ADB::M dbdp_diag(dbdp.matrix().asDiagonal());
-        const int num_blocks = pw.numBlocks();
-        std::vector<ADB::M> jacs(num_blocks);
-        for (int block = 0; block < num_blocks; ++block) {
-            fastSparseProduct(dbdp_diag, pw.derivative()[block], jacs[block]);
-        }
-        return ADB::function(std::move(b), std::move(jacs));
+        return ADB::function(std::move(b), chainRule(dbdp, pw));
     }
 
     /// Oil formation volume factor.
@@ -536,28 +806,37 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/2> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 0.0;
-        Eval RsEval = 0.0;
-        Eval bEval;
-
-        pEval.setDerivative(0, 1.0);
-        RsEval.setDerivative(1, 1.0);
-
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(po.value()[i]);
-            TEval.setValue(T.value()[i]);
+        const PvtTables* tables = pvtTables(T);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->bOil, cellPvtRegionIdx_, cells, order, po.value(),
+                                [&](const int i) {
+                                    return inPvtTableRange(po.value()[i])
+                                        && (cond[i].hasFreeGas() || !phase_usage_.phase_used[Gas]);
+                                },
+                                b, dbdp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                dbdr[i] = 0.0;
+                continue;
+            }
+            Eval pEval = po.value()[i];
+            pEval.setDerivative(0, 1.0);
+            const Eval TEval = T.value()[i];
 
             //RS/RV only makes sense when gas phase is active
+            Eval bEval;
             if (cond[i].hasFreeGas()) {
                 bEval = oilPvt_->saturatedInverseFormationVolumeFactor(pvtRegionIdx, TEval, pEval);
             }
             else {
-                if (rs.size() == 0) {
-                    RsEval.setValue(0.0);
-                }
-                else {
+                Eval RsEval = 0.0;
+                RsEval.setDerivative(1, 1.0);
+                if (rs.size() != 0) {
                     RsEval.setValue(rs.value()[i]);
                 }
                 bEval = oilPvt_->inverseFormationVolumeFactor(pvtRegionIdx, TEval, pEval, RsEval);
@@ -568,20 +847,11 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
             dbdr[i] = bEval.derivative(1);
         }
 
-        ADB::M dbdp_diag(dbdp.matrix().asDiagonal());
-        ADB::M dbdr_diag(dbdr.matrix().asDiagonal());
-        const int num_blocks = po.numBlocks();
-        std::vector<ADB::M> jacs(num_blocks);
-
-        for (int block = 0; block < num_blocks; ++block) {
-            fastSparseProduct(dbdp_diag, po.derivative()[block], jacs[block]);
-            if (phase_usage_.phase_used[Gas]) {
-                ADB::M temp;
-                fastSparseProduct(dbdr_diag, rs.derivative()[block], temp);
-                jacs[block] += temp;
-            }
+        if (phase_usage_.phase_used[Gas]) {
+            return ADB::function(std::move(b), chainRule(dbdp, po, dbdr, rs));
+        } else {
+            return ADB::function(std::move(b), chainRule(dbdp, po));
         }
-        return ADB::function(std::move(b), std::move(jacs));
     }
 
     /// Gas formation volume factor.
@@ -609,24 +879,32 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/2> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 0.0;
-        Eval RvEval = 0.0;
-        Eval bEval;
-
-        pEval.setDerivative(0, 1.0);
-        RvEval.setDerivative(1, 1.0);
-
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(pg.value()[i]);
-            TEval.setValue(T.value()[i]);
+        const PvtTables* tables = pvtTables(T);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->bGas, cellPvtRegionIdx_, cells, order, pg.value(),
+                                [&](const int i) { return inPvtTableRange(pg.value()[i]) && cond[i].hasFreeOil(); },
+                                b, dbdp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                dbdr[i] = 0.0;
+                continue;
+            }
+            Eval pEval = pg.value()[i];
+            pEval.setDerivative(0, 1.0);
+            const Eval TEval = T.value()[i];
 
+            Eval bEval;
             if (cond[i].hasFreeOil()) {
                 bEval = gasPvt_->saturatedInverseFormationVolumeFactor(pvtRegionIdx, TEval, pEval);
             }
             else {
-                RvEval.setValue(rv.value()[i]);
+                Eval RvEval = rv.value()[i];
+                RvEval.setDerivative(1, 1.0);
                 bEval = gasPvt_->inverseFormationVolumeFactor(pvtRegionIdx, TEval, pEval, RvEval);
             }
 
@@ -635,17 +913,7 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
             dbdr[i] = bEval.derivative(1);
         }
 
-        ADB::M dbdp_diag(dbdp.matrix().asDiagonal());
-        ADB::M dbdr_diag(dbdr.matrix().asDiagonal());
-        const int num_blocks = pg.numBlocks();
-        std::vector<ADB::M> jacs(num_blocks);
-        for (int block = 0; block < num_blocks; ++block) {
-            fastSparseProduct(dbdp_diag, pg.derivative()[block], jacs[block]);
-            ADB::M temp;
-            fastSparseProduct(dbdr_diag, rv.derivative()[block], temp);
-            jacs[block] += temp;
-        }
-        return ADB::function(std::move(b), std::move(jacs));
+        return ADB::function(std::move(b), chainRule(dbdp, pg, dbdr, rv));
     }
 
 
@@ -669,14 +937,24 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/1> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 293.15; // temperature is not supported by this API!
-
-        pEval.setDerivative(0, 1.0);
-
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(po.value()[i]);
+        const Eval TEval = 293.15; // temperature is not supported by this API!
+
+        const PvtTables* tables = pvtTables(TEval.value());
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->rsSat, cellPvtRegionIdx_, cells, order, po.value(),
+                                [&](const int i) { return inPvtTableRange(po.value()[i]); },
+                                rbub, drbubdp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                continue;
+            }
+            Eval pEval = po.value()[i];
+            pEval.setDerivative(0, 1.0);
 
             const Eval& RsEval = oilPvt_->saturatedGasDissolutionFactor(pvtRegionIdx, TEval, pEval);
 
@@ -684,13 +962,7 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
             drbubdp[i] = RsEval.derivative(0);
         }
 
-        ADB::M drbubdp_diag(drbubdp.matrix().asDiagonal());
-        const int num_blocks = po.numBlocks();
-        std::vector<ADB::M> jacs(num_blocks);
-        for (int block = 0; block < num_blocks; ++block) {
-            fastSparseProduct(drbubdp_diag, po.derivative()[block], jacs[block]);
-        }
-        return ADB::function(std::move(rbub), std::move(jacs));
+        return ADB::function(std::move(rbub), chainRule(drbubdp, po));
     }
 
     /// Bubble point curve for Rs as function of oil pressure.
@@ -726,14 +998,24 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
 
         typedef Opm::DenseAd::Evaluation<double, /*size=*/1> Eval;
 
-        Eval pEval = 0.0;
-        Eval TEval = 293.15; // temperature is not supported by this API!
-
-        pEval.setDerivative(0, 1.0);
-
-        for (int i = 0; i < n; ++i) {
-            unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
-            pEval.setValue(pg.value()[i]);
+        const Eval TEval = 293.15; // temperature is not supported by this API!
+
+        const PvtTables* tables = pvtTables(TEval.value());
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+        const std::vector<char> tabulated = tables
+            ? evaluatePvtTables(tables->rvSat, cellPvtRegionIdx_, cells, order, pg.value(),
+                                [&](const int i) { return inPvtTableRange(pg.value()[i]); },
+                                rv, drvdp)
+            : std::vector<char>(n, 0);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            if (tabulated[i]) {
+                continue;
+            }
+            Eval pEval = pg.value()[i];
+            pEval.setDerivative(0, 1.0);
 
             const Eval& RvEval = gasPvt_->saturatedOilVaporizationFactor(pvtRegionIdx, TEval, pEval);
 
@@ -741,13 +1023,7 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
             drvdp[i] = RvEval.derivative(0);
         }
 
-        ADB::M drvdp_diag(drvdp.matrix().asDiagonal());
-        const int num_blocks = pg.numBlocks();
-        std::vector<ADB::M> jacs(num_blocks);
-        for (int block = 0; block < num_blocks; ++block) {
-            fastSparseProduct(drvdp_diag, pg.derivative()[block], jacs[block]);
-        }
-        return ADB::function(std::move(rv), std::move(jacs));
+        return ADB::function(std::move(rv), chainRule(drvdp, pg));
     }
 
     /// Condensation curve for Rv as function of oil pressure.
@@ -984,13 +1260,7 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
                     dfactor_dso[i] = vap*std::pow(so_i/satOilMax_[cells[i]], vap-1.0)/satOilMax_[cells[i]];
                 }
             }
-            ADB::M dfactor_dso_diag(dfactor_dso.matrix().asDiagonal());
-            const int num_blocks = so.numBlocks();
-            std::vector<ADB::M> jacs(num_blocks);
-            for (int block = 0; block < num_blocks; ++block) {
-                jacs[block] = dfactor_dso_diag * so.derivative()[block];
-            }
-            r = ADB::function(std::move(factor), std::move(jacs))*r;
+            r = ADB::function(std::move(factor), chainRule(dfactor_dso, so))*r;
         }
     }
 
@@ -1033,5 +1303,237 @@ BlackoilPropsAdFromDeck::BlackoilPropsAdFromDeck(const BlackoilPropsAdFromDeck&
     }
 
 
+
+    // ------ Cell-local evaluation ------
+
+    typedef BlackoilPropsAdFromDeck::LocalVector LocalVector;
+    typedef LocalAutoDiff::Evaluation LocalEval;
+
+    namespace {
+        // The i'th entry of x, or zero if x is empty.
+        inline LocalEval localOrZero(const LocalVector& x, const int i)
+        {
+            return x.empty() ? LocalEval(0.0) : x[i];
+        }
+    }
+
+    /// Water viscosity, cell-local version.
+    LocalVector BlackoilPropsAdFromDeck::muWat(const LocalVector& pw,
+                                               const LocalVector& T,
+                                               const Cells& cells) const
+    {
+        if (!phase_usage_.phase_used[Water]) {
+            OPM_THROW(std::runtime_error, "Cannot call muWat(): water phase not active.");
+        }
+        const int n = cells.size();
+        assert(int(pw.size()) == n);
+        LocalVector mu(n);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            // Like in the AD versions, the temperature is constant.
+            const LocalEval temperature(T[i].value());
+            mu[i] = waterPvt_->viscosity(pvtRegionIdx, temperature, pw[i]);
+        }
+        return mu;
+    }
+
+    /// Oil viscosity, cell-local version.
+    LocalVector BlackoilPropsAdFromDeck::muOil(const LocalVector& po,
+                                               const LocalVector& T,
+                                               const LocalVector& rs,
+                                               const std::vector<PhasePresence>& cond,
+                                               const Cells& cells) const
+    {
+        if (!phase_usage_.phase_used[Oil]) {
+            OPM_THROW(std::runtime_error, "Cannot call muOil(): oil phase not active.");
+        }
+        const int n = cells.size();
+        assert(int(po.size()) == n);
+        const bool use_rs = phase_usage_.phase_used[Gas];
+        LocalVector mu(n);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            const LocalEval temperature(T[i].value());
+            if (cond[i].hasFreeGas()) {
+                mu[i] = oilPvt_->saturatedViscosity(pvtRegionIdx, temperature, po[i]);
+            } else {
+                const LocalEval rsEval = use_rs ? localOrZero(rs, i) : LocalEval(0.0);
+                mu[i] = oilPvt_->viscosity(pvtRegionIdx, temperature, po[i], rsEval);
+            }
+        }
+        return mu;
+    }
+
+    /// Gas viscosity, cell-local version.
+    LocalVector BlackoilPropsAdFromDeck::muGas(const LocalVector& pg,
+                                               const LocalVector& T,
+                                               const LocalVector& rv,
+                                               const std::vector<PhasePresence>& cond,
+                                               const Cells& cells) const
+    {
+        if (!phase_usage_.phase_used[Gas]) {
+            OPM_THROW(std::runtime_error, "Cannot call muGas(): gas phase not active.");
+        }
+        const int n = cells.size();
+        assert(int(pg.size()) == n);
+        LocalVector mu(n);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            const LocalEval temperature(T[i].value());
+            if (cond[i].hasFreeOil()) {
+                mu[i] = gasPvt_->saturatedViscosity(pvtRegionIdx, temperature, pg[i]);
+            } else {
+                mu[i] = gasPvt_->viscosity(pvtRegionIdx, temperature, pg[i], localOrZero(rv, i));
+            }
+        }
+        return mu;
+    }
+
+    /// Water formation volume factor, cell-local version.
+    LocalVector BlackoilPropsAdFromDeck::bWat(const LocalVector& pw,
+                                              const LocalVector& T,
+                                              const Cells& cells) const
+    {
+        if (!phase_usage_.phase_used[Water]) {
+            OPM_THROW(std::runtime_error, "Cannot call bWat(): water phase not active.");
+        }
+        const int n = cells.size();
+        assert(int(pw.size()) == n);
+        LocalVector b(n);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            const LocalEval temperature(T[i].value());
+            b[i] = waterPvt_->inverseFormationVolumeFactor(pvtRegionIdx, temperature, pw[i]);
+        }
+        return b;
+    }
+
+    /// Oil formation volume factor, cell-local version.
+    LocalVector BlackoilPropsAdFromDeck::bOil(const LocalVector& po,
+                                              const LocalVector& T,
+                                              const LocalVector& rs,
+                                              const std::vector<PhasePresence>& cond,
+                                              const Cells& cells) const
+    {
+        if (!phase_usage_.phase_used[Oil]) {
+            OPM_THROW(std::runtime_error, "Cannot call bOil(): oil phase not active.");
+        }
+        const int n = cells.size();
+        assert(int(po.size()) == n);
+        const bool use_rs = phase_usage_.phase_used[Gas];
+        LocalVector b(n);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            const LocalEval temperature(T[i].value());
+            //RS/RV only makes sense when gas phase is active
+            if (cond[i].hasFreeGas()) {
+                b[i] = oilPvt_->saturatedInverseFormationVolumeFactor(pvtRegionIdx, temperature, po[i]);
+            } else {
+                const LocalEval rsEval = use_rs ? localOrZero(rs, i) : LocalEval(0.0);
+                b[i] = oilPvt_->inverseFormationVolumeFactor(pvtRegionIdx, temperature, po[i], rsEval);
+            }
+        }
+        return b;
+    }
+
+    /// Gas formation volume factor, cell-local version.
+    LocalVector BlackoilPropsAdFromDeck::bGas(const LocalVector& pg,
+                                              const LocalVector& T,
+                                              const LocalVector& rv,
+                                              const std::vector<PhasePresence>& cond,
+                                              const Cells& cells) const
+    {
+        if (!phase_usage_.phase_used[Gas]) {
+            OPM_THROW(std::runtime_error, "Cannot call bGas(): gas phase not active.");
+        }
+        const int n = cells.size();
+        assert(int(pg.size()) == n);
+        LocalVector b(n);
+        const std::vector<int> order = pvtRegionOrder(cellPvtRegionIdx_, cells);
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; ++k) {
+            const int i = order.empty() ? k : order[k];
+            const unsigned pvtRegionIdx = cellPvtRegionIdx_[cells[i]];
+            const LocalEval temperature(T[i].value());
+            if (cond[i].hasFreeOil()) {
+                b[i] = gasPvt_->saturatedInverseFormationVolumeFactor(pvtRegionIdx, temperature, pg[i]);
+            } else {
+                b[i] = gasPvt_->inverseFormationVolumeFactor(pvtRegionIdx, temperature, pg[i], localOrZero(rv, i));
+            }
+        }
+        return b;
+    }
+
+    /// Relative permeabilities for all phases, cell-local version.
+    std::vector<LocalVector> BlackoilPropsAdFromDeck::relperm(const LocalVector& sw,
+                                                              const LocalVector& so,
+                                                              const LocalVector& sg,
+                                                              const Cells& cells) const
+    {
+        const int n = cells.size();
+        const int np = numPhases();
+        if (!phase_usage_.phase_used[Oil]) {
+            OPM_THROW(std::runtime_error, "BlackoilPropsAdFromDeck::relperm() assumes oil phase is active.");
+        }
+        const LocalVector* s[3] = { &sw, &so, &sg };
+        Block s_all(n, np);
+        for (int phase = 0; phase < 3; ++phase) {
+            if (phase_usage_.phase_used[phase]) {
+                assert(int(s[phase]->size()) == n);
+                const int pos = phase_usage_.phase_pos[phase];
+                for (int i = 0; i < n; ++i) {
+                    s_all(i, pos) = (*s[phase])[i].value();
+                }
+            }
+        }
+        Block kr(n, np);
+        Block dkr(n, np*np);
+        satprops_->relperm(n, s_all.data(), cells.data(), kr.data(), dkr.data());
+
+        // Chain rule through the saturations, within each cell.
+        std::vector<LocalVector> relperms(3);
+        for (int phase1 = 0; phase1 < 3; ++phase1) {
+            if (!phase_usage_.phase_used[phase1]) {
+                continue;
+            }
+            const int phase1_pos = phase_usage_.phase_pos[phase1];
+            LocalVector& kr1 = relperms[phase1];
+            kr1.assign(n, LocalEval(0.0));
+            for (int i = 0; i < n; ++i) {
+                kr1[i].setValue(kr(i, phase1_pos));
+            }
+            for (int phase2 = 0; phase2 < 3; ++phase2) {
+                if (!phase_usage_.phase_used[phase2]) {
+                    continue;
+                }
+                const int phase2_pos = phase_usage_.phase_pos[phase2];
+                const int column = phase1_pos + np*phase2_pos; // Recall: Fortran ordering from props_.relperm()
+                for (int i = 0; i < n; ++i) {
+                    const LocalEval& s2 = (*s[phase2])[i];
+                    for (int k = 0; k < LocalAutoDiff::maxVariables; ++k) {
+                        kr1[i].setDerivative(k, kr1[i].derivative(k) + dkr(i, column) * s2.derivative(k));
+                    }
+                }
+            }
+        }
+        return relperms;
+    }
+
+
 } // namespace Opm
 
@@ -24,6 +24,7 @@
 
 #include <opm/autodiff/BlackoilPropsAdInterface.hpp>
 #include <opm/autodiff/AutoDiffBlock.hpp>
+#include <opm/autodiff/ResampledTableLinear.hpp>
 
 #include <opm/core/props/BlackoilPhases.hpp>
 #include <opm/core/props/satfunc/SaturationPropsFromDeck.hpp>
@@ -155,6 +156,25 @@ namespace Opm
                                 std::shared_ptr<MaterialLawManager> materialLawManager,
                                 const int number_of_cells);
 
+        /// Turns on the tabulation of the PVT functions which only depend
+        /// on pressure: the formation volume factors and viscosities of
+        /// water, of saturated oil (of dead oil without a gas phase) and
+        /// of saturated gas, and the Rs and Rv saturation curves. For
+        /// every PVT region they are sampled once at num_points uniformly
+        /// spaced pressures between pmin and pmax, and then evaluated by
+        /// linear interpolation. The tables are built here, for the
+        /// given reservoir temperature, and their largest interpolation
+        /// errors logged. Pressures outside this range, undersaturated
+        /// phases and cells at other temperatures are evaluated exactly.
+        /// The relative permeabilities are not tabulated, since
+        /// SaturationPropsFromDeck combines the two-phase curves of a
+        /// SATNUM region with end-point scaling of every cell. Values of
+        /// num_points below two turn the tabulation off.
+        void tabulatePvt(const int num_points,
+                         const double pmin,
+                         const double pmax,
+                         const double temperature = 273.15 + 20);
+
 
         ////////////////////////////
         //      Rock interface    //
@@ -380,6 +400,52 @@ namespace Opm
         /// \return Array of scaled critical gas saturaion values.
         V scaledCriticalGasSaturations(const Cells& cells) const;
 
+        // ------ Cell-local evaluation ------
+
+        /// Water viscosity, cell-local version.
+        LocalVector muWat(const LocalVector& pw,
+                          const LocalVector& T,
+                          const Cells& cells) const;
+
+        /// Oil viscosity, cell-local version. rs may be empty.
+        LocalVector muOil(const LocalVector& po,
+                          const LocalVector& T,
+                          const LocalVector& rs,
+                          const std::vector<PhasePresence>& cond,
+                          const Cells& cells) const;
+
+        /// Gas viscosity, cell-local version. rv may be empty.
+        LocalVector muGas(const LocalVector& pg,
+                          const LocalVector& T,
+                          const LocalVector& rv,
+                          const std::vector<PhasePresence>& cond,
+                          const Cells& cells) const;
+
+        /// Water formation volume factor, cell-local version.
+        LocalVector bWat(const LocalVector& pw,
+                         const LocalVector& T,
+                         const Cells& cells) const;
+
+        /// Oil formation volume factor, cell-local version. rs may be empty.
+        LocalVector bOil(const LocalVector& po,
+                         const LocalVector& T,
+                         const LocalVector& rs,
+                         const std::vector<PhasePresence>& cond,
+                         const Cells& cells) const;
+
+        /// Gas formation volume factor, cell-local version. rv may be empty.
+        LocalVector bGas(const LocalVector& pg,
+                         const LocalVector& T,
+                         const LocalVector& rv,
+                         const std::vector<PhasePresence>& cond,
+                         const Cells& cells) const;
+
+        /// Relative permeabilities for all phases, cell-local version.
+        std::vector<LocalVector> relperm(const LocalVector& sw,
+                                         const LocalVector& so,
+                                         const LocalVector& sg,
+                                         const Cells& cells) const;
+
 
     private:
         /// Initializes the properties.
@@ -402,6 +468,35 @@ namespace Opm
                       const std::vector<int>& cells,
                       const double vap) const;
 
+        // The pressure dependent PVT functions at one temperature on a
+        // uniform pressure grid, one table per PVT region. Tables of
+        // inactive phases are empty.
+        struct PvtTables
+        {
+            std::vector<ResampledTableLinear> bWat;
+            std::vector<ResampledTableLinear> muWat;
+            std::vector<ResampledTableLinear> bOil;
+            std::vector<ResampledTableLinear> muOil;
+            std::vector<ResampledTableLinear> bGas;
+            std::vector<ResampledTableLinear> muGas;
+            std::vector<ResampledTableLinear> rsSat;
+            std::vector<ResampledTableLinear> rvSat;
+        };
+
+        /// The PVT tables, or null if the tabulation is off or some
+        /// cell is not at the temperature of the tables.
+        const PvtTables* pvtTables(const ADB& T) const;
+
+        /// The PVT tables, or null if the tabulation is off or the
+        /// temperature is not the one of the tables.
+        const PvtTables* pvtTables(const double temperature) const;
+
+        /// True if p is inside the pressure range of the PVT tables.
+        bool inPvtTableRange(const double p) const
+        {
+            return p >= pvtTablePmin_ && p <= pvtTablePmax_;
+        }
+
         RockFromDeck rock_;
 
         // This has to be a shared pointer as we must
@@ -428,6 +523,13 @@ namespace Opm
         std::shared_ptr<GasPvt> gasPvt_;
         std::shared_ptr<OilPvt> oilPvt_;
         std::shared_ptr<WaterPvt> waterPvt_;
+
+        // PVT tabulation, see tabulatePvt().
+        int pvtTablePoints_;
+        double pvtTablePmin_;
+        double pvtTablePmax_;
+        double pvtTableTemperature_;
+        PvtTables pvtTables_;
     };
 } // namespace Opm
 
@@ -21,6 +21,7 @@
 #define OPM_BLACKOILPROPSADINTERFACE_HEADER_INCLUDED
 
 #include <opm/autodiff/AutoDiffBlock.hpp>
+#include <opm/autodiff/LocalAutoDiff.hpp>
 #include <opm/core/props/BlackoilPhases.hpp>
 
 namespace Opm
@@ -266,6 +267,67 @@ namespace Opm
         virtual
         V scaledCriticalGasSaturations(const Cells& cells) const = 0;
 
+        // ------ Cell-local evaluation ------
+
+        // The following overloads take and return one dense evaluation
+        // per cell, see LocalAutoDiff, and are otherwise equivalent to
+        // the AD versions above.
+
+        typedef LocalAutoDiff::Vector LocalVector;
+
+        /// Water viscosity, cell-local version.
+        virtual
+        LocalVector muWat(const LocalVector& pw,
+                          const LocalVector& T,
+                          const Cells& cells) const = 0;
+
+        /// Oil viscosity, cell-local version. rs may be empty.
+        virtual
+        LocalVector muOil(const LocalVector& po,
+                          const LocalVector& T,
+                          const LocalVector& rs,
+                          const std::vector<PhasePresence>& cond,
+                          const Cells& cells) const = 0;
+
+        /// Gas viscosity, cell-local version. rv may be empty.
+        virtual
+        LocalVector muGas(const LocalVector& pg,
+                          const LocalVector& T,
+                          const LocalVector& rv,
+                          const std::vector<PhasePresence>& cond,
+                          const Cells& cells) const = 0;
+
+        /// Water formation volume factor, cell-local version.
+        virtual
+        LocalVector bWat(const LocalVector& pw,
+                         const LocalVector& T,
+                         const Cells& cells) const = 0;
+
+        /// Oil formation volume factor, cell-local version. rs may be empty.
+        virtual
+        LocalVector bOil(const LocalVector& po,
+                         const LocalVector& T,
+                         const LocalVector& rs,
+                         const std::vector<PhasePresence>& cond,
+                         const Cells& cells) const = 0;
+
+        /// Gas formation volume factor, cell-local version. rv may be empty.
+        virtual
+        LocalVector bGas(const LocalVector& pg,
+                         const LocalVector& T,
+                         const LocalVector& rv,
+                         const std::vector<PhasePresence>& cond,
+                         const Cells& cells) const = 0;
+
+        /// Relative permeabilities for all phases, cell-local version.
+        /// The saturations of inactive phases may be empty, and so are the
+        /// relative permeabilities returned for them.
+        virtual
+        std::vector<LocalVector> relperm(const LocalVector& sw,
+                                         const LocalVector& so,
+                                         const LocalVector& sg,
+                                         const Cells& cells) const = 0;
+
     };
 
 } // namespace Opm
@@ -138,23 +138,30 @@ createParallelDeleter(ILU& ilu, const Dune::OwnerOverlapCopyCommunication<I1,I2>
 #endif
 
 //! \brief Creates and initializes a unique pointer to an sequential ILU0 preconditioner.
+//!
+//! The level scheduled ParallelOverlappingILU0 is used such that the
+//! triangular solves are multithreaded.
 //! \param A     The matrix of the linear system to solve.
 //! \param relax The relaxation factor to use.
+//! \param info  The (sequential) parallel information.
 template<class M, class X>
-std::shared_ptr<Dune::SeqILU0<M,X,X> >
-createILU0Ptr(const M& A, double relax, const Dune::Amg::SequentialInformation&)
+std::shared_ptr<ParallelOverlappingILU0<M,X,X,Dune::Amg::SequentialInformation> >
+createILU0Ptr(const M& A, double relax, const Dune::Amg::SequentialInformation& info)
 {
-    return std::shared_ptr<Dune::SeqILU0<M,X,X> >(new Dune::SeqILU0<M,X,X>( A, relax) );
+    typedef ParallelOverlappingILU0<M,X,X,Dune::Amg::SequentialInformation> ILU;
+    return std::shared_ptr<ILU>(new ILU( A, info, relax) );
 }
 //! \brief Creates and initializes a shared pointer to an ILUn preconditioner.
 //! \param A     The matrix of the linear system to solve.
 //! \param ilu_n The n parameter for the extension of the nonzero pattern.
 //! \param relax The relaxation factor to use.
+//! \param info  The (sequential) parallel information.
 template<class M, class X>
-std::shared_ptr<Dune::SeqILUn<M,X,X> >
-createILUnPtr(const M& A, int ilu_n, double relax, const Dune::Amg::SequentialInformation&)
+std::shared_ptr<ParallelOverlappingILU0<M,X,X,Dune::Amg::SequentialInformation> >
+createILUnPtr(const M& A, int ilu_n, double relax, const Dune::Amg::SequentialInformation& info)
 {
-    return std::shared_ptr<Dune::SeqILUn<M,X,X> >(new Dune::SeqILUn<M,X,X>( A, ilu_n, relax) );
+    typedef ParallelOverlappingILU0<M,X,X,Dune::Amg::SequentialInformation> ILU;
+    return std::shared_ptr<ILU>(new ILU( A, info, relax, ilu_n) );
 }
 
 #if HAVE_MPI
@@ -216,25 +223,20 @@ createILU0Ptr(const M& A, double relax,
 }
 
 //! \brief Creates and initializes a shared pointer to an ILUn preconditioner.
+//!
+//! The factorization is the overlapping ParallelOverlappingILU0 with
+//! fill-in level ilu_n.
 //! \param A     The matrix of the linear system to solve.
 //! \param ilu_n The n parameter for the extension of the nonzero pattern.
 //! \param relax The relaxation factor to use.
 /// \param comm  The object describing the parallelization information and communication.
 template<class M, class X, class I1, class I2>
-typename SelectParallelILUSharedPtr<Dune::SeqILUn<M,X,X>, I1, I2>::type
+std::shared_ptr<ParallelOverlappingILU0<M,X,X,Dune::OwnerOverlapCopyCommunication<I1,I2> > >
 createILUnPtr(const M& A, int ilu_n, double relax,
               const Dune::OwnerOverlapCopyCommunication<I1,I2>& comm)
 {
-    typedef Dune::BlockPreconditioner<
-        X,
-        X,
-        Dune::OwnerOverlapCopyCommunication<I1,I2>,
-        Dune::SeqILUn<M,X,X>
-        > PointerType;
-    Dune::SeqILUn<M,X,X>* ilu = new Dune::SeqILUn<M,X,X>( A, ilu_n, relax);
-
-    return typename SelectParallelILUSharedPtr<Dune::SeqILUn<M,X,X>, I1, I2>::type
-        (new PointerType(*ilu, comm),createParallelDeleter(*ilu, comm));
+    typedef ParallelOverlappingILU0<M,X,X,Dune::OwnerOverlapCopyCommunication<I1,I2> > ILU;
+    return std::shared_ptr<ILU>(new ILU( A, comm, relax, ilu_n) );
 }
 #endif
 
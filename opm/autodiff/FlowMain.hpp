@@ -560,6 +560,10 @@ namespace Opm
 
             // Rock and fluid properties.
             fluidprops_.reset(new BlackoilPropsAdFromDeck(*deck_, *eclipse_state_, material_law_manager_, grid));
+            fluidprops_->tabulatePvt(param_.getDefault("pvt_table_points", 0),
+                                     param_.getDefault("pvt_table_pmin", 1.0*unit::barsa),
+                                     param_.getDefault("pvt_table_pmax", 1000.0*unit::barsa),
+                                     param_.getDefault("pvt_table_temperature", 273.15 + 20));
 
             // Rock compressibility.
             rock_comp_.reset(new RockCompressibility(*deck_, *eclipse_state_, output_cout_));
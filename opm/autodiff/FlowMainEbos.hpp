@@ -632,9 +632,12 @@ namespace Opm
         void setupLinearSolver()
         {
             typedef typename BlackoilModelEbos :: ISTLSolverType ISTLSolverType;
+            typedef typename BlackoilModelEbos :: BlackoilIndices BlackoilIndices;
 
             extractParallelGridInformationToISTL(grid(), parallel_information_);
-            fis_solver_.reset( new ISTLSolverType( param_, parallel_information_ ) );
+            // the Ebos primary variables are not ordered with the pressure first
+            fis_solver_.reset( new ISTLSolverType( param_, parallel_information_,
+                                                   BlackoilIndices::pressureSwitchIdx ) );
         }
 
         /// This is the main function of Flow.
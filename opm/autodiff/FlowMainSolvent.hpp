@@ -77,7 +77,8 @@ namespace Opm
             solvent_props_.reset(new SolventPropsAdFromDeck(*Base::deck_,
                                                             *Base::eclipse_state_,
                                                             UgGridHelpers::numCells(grid),
-                                                            UgGridHelpers::globalCell(grid)));
+                                                            UgGridHelpers::globalCell(grid),
+                                                            Base::param_.getDefault("solvent_table_points", 0)));
         }
 
 
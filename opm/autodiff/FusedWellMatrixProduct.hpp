@@ -0,0 +1,77 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_FUSEDWELLMATRIXPRODUCT_HEADER_INCLUDED
+#define OPM_FUSEDWELLMATRIXPRODUCT_HEADER_INCLUDED
+
+#include <cassert>
+#include <vector>
+
+namespace Opm
+{
+
+    /// Multiply with the reservoir matrix and the Schur complement of the
+    /// wells in a single traversal of A, i.e. compute
+    ///
+    ///     y = A x - W x              if overwrite is true, or
+    ///     y += alpha * (A x - W x)   otherwise,
+    ///
+    /// where W = B^T inv(D) C. The well part W x has to be computed before
+    /// for the perforated cells only: the block wellContributions[k]
+    /// belongs to the cell i with perforatedCellIndex[i] == k, cells
+    /// without perforations are marked by -1. An empty perforatedCellIndex
+    /// means that there are no wells.
+    /// The rows are processed in parallel if OpenMP is enabled.
+    template <class Matrix, class X, class Y>
+    void fusedWellMatrixProduct(const Matrix& A, const X& x, Y& y,
+                                const std::vector<int>& perforatedCellIndex,
+                                const Y& wellContributions,
+                                const typename Y::field_type alpha,
+                                const bool overwrite)
+    {
+        typedef typename Y::block_type Block;
+
+        const bool hasWells = ! perforatedCellIndex.empty();
+        assert( ! hasWells || perforatedCellIndex.size() == A.N() );
+        const int size = A.N();
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < size; ++i) {
+            Block sum(0.0);
+            const auto& row = A[i];
+            const auto endcol = row.end();
+            for (auto col = row.begin(); col != endcol; ++col) {
+                col->umv(x[col.index()], sum);
+            }
+            if (hasWells) {
+                const int perfCell = perforatedCellIndex[i];
+                if (perfCell >= 0) {
+                    sum -= wellContributions[perfCell];
+                }
+            }
+            if (overwrite) {
+                y[i] = sum;
+            } else {
+                y[i].axpy(alpha, sum);
+            }
+        }
+    }
+
+} // namespace Opm
+
+#endif // OPM_FUSEDWELLMATRIXPRODUCT_HEADER_INCLUDED
@@ -21,7 +21,9 @@
 #define OPM_ISTLSOLVER_HEADER_INCLUDED
 
 #include <opm/autodiff/AdditionalObjectDeleter.hpp>
+#include <opm/autodiff/BlackoilCPRPreconditioner.hpp>
 #include <opm/autodiff/CPRPreconditioner.hpp>
+#include <opm/autodiff/MixedPrecisionPreconditioner.hpp>
 #include <opm/autodiff/NewtonIterationBlackoilInterleaved.hpp>
 #include <opm/autodiff/NewtonIterationUtilities.hpp>
 #include <opm/autodiff/ParallelRestrictedAdditiveSchwarz.hpp>
@@ -41,6 +43,9 @@
 
 #include <opm/common/utility/platform_dependent/reenable_warnings.h>
 
+#include <memory>
+#include <vector>
+
 namespace Dune
 {
 
@@ -138,6 +143,12 @@ namespace Opm
         typedef Dune::BCRSMatrix <MatrixBlockType>      Matrix;
         typedef Dune::BlockVector<VectorBlockType>      Vector;
 
+        // types for preconditioners stored in single precision
+        typedef Dune::MatrixBlock< float, MatrixBlockType::rows, MatrixBlockType::cols > FloatMatrixBlockType;
+        typedef Dune::FieldVector< float, VectorBlockType::dimension > FloatVectorBlockType;
+        typedef Dune::BCRSMatrix <FloatMatrixBlockType> FloatMatrix;
+        typedef Dune::BlockVector<FloatVectorBlockType> FloatVector;
+
     public:
         typedef Dune::AssembledLinearOperator< Matrix, Vector, Vector > AssembledLinearOperatorType;
 
@@ -146,26 +157,44 @@ namespace Opm
         /// \param[in] param   parameters controlling the behaviour of the linear solvers
         /// \param[in] parallelInformation In the case of a parallel run
         ///                                with dune-istl the information about the parallelization.
+        /// \param[in] pressureIndex       index of the pressure in the blocks of the
+        ///                                primary variables, used by the CPR preconditioner.
         ISTLSolver(const NewtonIterationBlackoilInterleavedParameters& param,
-                   const boost::any& parallelInformation_arg=boost::any())
+                   const boost::any& parallelInformation_arg=boost::any(),
+                   const int pressureIndex=0)
         : iterations_( 0 ),
           parallelInformation_(parallelInformation_arg),
           isIORank_(isIORank(parallelInformation_arg)),
-          parameters_( param )
+          parameters_( param ),
+          cprParameters_(),
+          pressureIndex_( pressureIndex ),
+          cachedMatrix_( nullptr ),
+          preconditionerReuses_( 0 ),
+          preconditionerRebuilds_( 0 )
         {
+            checkReuseParameters();
         }
 
         /// Construct a system solver.
         /// \param[in] param   ParameterGroup controlling the behaviour of the linear solvers
         /// \param[in] parallelInformation In the case of a parallel run
         ///                                with dune-istl the information about the parallelization.
+        /// \param[in] pressureIndex       index of the pressure in the blocks of the
+        ///                                primary variables, used by the CPR preconditioner.
         ISTLSolver(const parameter::ParameterGroup& param,
-                   const boost::any& parallelInformation_arg=boost::any())
+                   const boost::any& parallelInformation_arg=boost::any(),
+                   const int pressureIndex=0)
         : iterations_( 0 ),
           parallelInformation_(parallelInformation_arg),
           isIORank_(isIORank(parallelInformation_arg)),
-          parameters_( param )
+          parameters_( param ),
+          cprParameters_( param ),
+          pressureIndex_( pressureIndex ),
+          cachedMatrix_( nullptr ),
+          preconditionerReuses_( 0 ),
+          preconditionerRebuilds_( 0 )
         {
+            checkReuseParameters();
         }
 
         // dummy method that is not implemented for this class
@@ -187,6 +216,14 @@ namespace Opm
         /// \copydoc NewtonIterationBlackoilInterface::parallelInformation
         const boost::any& parallelInformation() const { return parallelInformation_; }
 
+        /// Number of linear solves that reused the preconditioner of a previous
+        /// solve, refreshing only its numerical values.
+        int preconditionerReuses() const { return preconditionerReuses_; }
+
+        /// Number of linear solves for which the preconditioner was set up
+        /// from scratch.
+        int preconditionerRebuilds() const { return preconditionerRebuilds_; }
+
     public:
         /// \brief construct the CPR preconditioner and the solver.
         /// \tparam P The type of the parallel information.
@@ -205,6 +242,51 @@ namespace Opm
             // Communicate if parallel.
             parallelInformation_arg.copyOwnerToAll(istlb, istlb);
 
+            // Check whether the preconditioner of the previous solve may be kept.
+            const bool reuse = canReusePreconditioner( linearOperator.getmat() );
+
+            if( parameters_.linear_solver_use_cpr_ )
+            {
+                // Two-stage CPR on the matrix of the operator.
+                typedef BlackoilCPRPreconditioner< Matrix, Vector, Vector, POrComm > Preconditioner;
+
+                if( parameters_.linear_solver_reuse_preconditioner_ )
+                {
+                    Preconditioner* precond = reuse ? dynamic_cast< Preconditioner* >( cachedPreconditioner_.get() ) : nullptr;
+                    if( precond )
+                    {
+                        // Same sparsity pattern, recompute the pressure system
+                        // and refactorize the ILU stage in place.
+                        precond->update( parallelInformation_arg );
+                        ++preconditionerReuses_;
+                    }
+                    else
+                    {
+                        std::unique_ptr< Preconditioner > newPrecond( new Preconditioner( cprParameters_, linearOperator.getmat(),
+                                                                                          pressureIndex_, parallelInformation_arg ) );
+                        precond = newPrecond.get();
+                        storePreconditioner( linearOperator.getmat(), std::move( newPrecond ) );
+                    }
+
+                    // Solve.
+                    solve(linearOperator, x, istlb, *sp, *precond, result);
+                    return;
+                }
+
+                Preconditioner precond( cprParameters_, linearOperator.getmat(), pressureIndex_, parallelInformation_arg );
+                ++preconditionerRebuilds_;
+
+                // Solve.
+                solve(linearOperator, x, istlb, *sp, precond, result);
+                return;
+            }
+
+            if( parameters_.linear_solver_single_precision_preconditioner_ )
+            {
+                constructSinglePrecisionPreconditionerAndSolve( linearOperator, x, istlb, *sp, parallelInformation_arg, result );
+                return;
+            }
+
 #if ! HAVE_UMFPACK
             if( parameters_.linear_solver_use_amg_ )
             {
@@ -212,6 +294,8 @@ namespace Opm
                 typedef typename CPRSelectorType::AMG AMG;
                 typedef typename CPRSelectorType::Operator MatrixOperator;
 
+                // The AMG preconditioner is always set up from scratch, see
+                // checkReuseParameters().
                 std::unique_ptr< AMG > amg;
                 std::unique_ptr< MatrixOperator > opA;
 
@@ -225,6 +309,7 @@ namespace Opm
 
                 // Construct preconditioner.
                 constructAMGPrecond( linearOperator, parallelInformation_arg, amg, opA, relax );
+                ++preconditionerRebuilds_;
 
                 // Solve.
                 solve(linearOperator, x, istlb, *sp, *amg, result);
@@ -232,21 +317,224 @@ namespace Opm
             else
 #endif
             {
-                // Construct preconditioner.
-                auto precond = constructPrecond(linearOperator, parallelInformation_arg);
+                typedef ParallelOverlappingILU0< Matrix, Vector, Vector, POrComm > Preconditioner;
+
+                if( parameters_.linear_solver_reuse_preconditioner_ )
+                {
+                    Preconditioner* precond = reuse ? dynamic_cast< Preconditioner* >( cachedPreconditioner_.get() ) : nullptr;
+                    if( precond )
+                    {
+                        // Same sparsity pattern, keep the symbolic part and
+                        // only refactorize.
+                        precond->update( parallelInformation_arg );
+                        ++preconditionerReuses_;
+                    }
+                    else
+                    {
+                        std::unique_ptr< Preconditioner > newPrecond = constructPrecond(linearOperator, parallelInformation_arg);
+                        precond = newPrecond.get();
+                        storePreconditioner( linearOperator.getmat(), std::move( newPrecond ) );
+                    }
+
+                    // Solve.
+                    solve(linearOperator, x, istlb, *sp, *precond, result);
+                }
+                else
+                {
+                    // Construct preconditioner.
+                    auto precond = constructPrecond(linearOperator, parallelInformation_arg);
+                    ++preconditionerRebuilds_;
+
+                    // Solve.
+                    solve(linearOperator, x, istlb, *sp, *precond, result);
+                }
+            }
+        }
+
+        /// \brief Construct a preconditioner stored in single precision and solve.
+        ///
+        /// The AMG hierarchy or the ILU factors are set up for a float copy of
+        /// the matrix while the Krylov solver runs in double precision.
+        template<class LinearOperator, class ScalarProd, class POrComm>
+        void constructSinglePrecisionPreconditionerAndSolve(LinearOperator& linearOperator,
+                                                            Vector& x, Vector& istlb,
+                                                            ScalarProd& sp,
+                                                            const POrComm& parallelInformation_arg,
+                                                            Dune::InverseOperatorResult& result) const
+        {
+            ++preconditionerRebuilds_;
+#if ! HAVE_UMFPACK
+            if( parameters_.linear_solver_use_amg_ )
+            {
+                typedef ISTLUtility::CPRSelector< FloatMatrix, FloatVector, FloatVector, POrComm>  CPRSelectorType;
+                typedef typename CPRSelectorType::AMG AMG;
+                typedef typename CPRSelectorType::Operator MatrixOperator;
+                typedef MixedPrecisionPreconditioner< FloatMatrix, Vector, Vector, AMG > Preconditioner;
+
+                Preconditioner precond( linearOperator.getmat() );
+                std::shared_ptr< MatrixOperator > opA( CPRSelectorType::makeOperator( precond.matrix(), parallelInformation_arg ) );
+                std::unique_ptr< AMG > amg;
+                const double relax = 1.0;
+                ISTLUtility::createAMGPreconditionerPointer( *opA, relax, parallelInformation_arg, amg );
+                precond.setPreconditioner( std::move( amg ), opA );
 
                 // Solve.
-                solve(linearOperator, x, istlb, *sp, *precond, result);
+                solveWithRefinement(linearOperator, x, istlb, sp, precond, result);
+            }
+            else
+#endif
+            {
+                typedef ParallelOverlappingILU0< FloatMatrix, FloatVector, FloatVector, POrComm > ILU;
+                typedef MixedPrecisionPreconditioner< FloatMatrix, Vector, Vector, ILU > Preconditioner;
+
+                Preconditioner precond( linearOperator.getmat() );
+                const double relax = 0.9;
+                std::unique_ptr< ILU > ilu( new ILU( precond.matrix(), parallelInformation_arg, relax,
+                                                     parameters_.ilu_fillin_level_,
+                                                     parameters_.ilu_milu_,
+                                                     parameters_.ilu_multicolor_ ) );
+                precond.setPreconditioner( std::move( ilu ) );
+
+                // Solve.
+                solveWithRefinement(linearOperator, x, istlb, sp, precond, result);
             }
         }
 
-        typedef Dune::SeqILU0<Matrix, Vector, Vector> SeqPreconditioner;
+        /// \brief Solve with iterative refinement in double precision.
+        ///
+        /// After the Krylov solve the true residual b - Ax is recomputed with
+        /// the operator. While it misses the requested reduction, the
+        /// correction is solved for and added to x, at most
+        /// linear_solver_refinement_steps times. This guards the solution
+        /// against a loss of accuracy caused by a low precision preconditioner.
+        template <class Operator, class ScalarProd, class Precond>
+        void solveWithRefinement(Operator& opA, Vector& x, Vector& istlb, ScalarProd& sp, Precond& precond, Dune::InverseOperatorResult& result) const
+        {
+            // the Krylov solvers overwrite the right hand side with the defect
+            const Vector b( istlb );
+            Vector defect( b );
+            opA.applyscaleadd( -1.0, x, defect );
+            const double defect0 = sp.norm( defect );
+
+            solve(opA, x, istlb, sp, precond, result);
+
+            int iterations = result.iterations;
+            bool converged = false;
+            double defectNorm = defect0;
+            Vector dx( x.size() );
+            for( int step = 0; ; ++step )
+            {
+                defect = b;
+                opA.applyscaleadd( -1.0, x, defect );
+                defectNorm = sp.norm( defect );
+                converged = defectNorm <= parameters_.linear_solver_reduction_ * defect0;
+                if( converged || step >= parameters_.linear_solver_refinement_steps_ ) {
+                    break;
+                }
+
+                dx = 0.0;
+                Dune::InverseOperatorResult correction;
+                solve(opA, dx, defect, sp, precond, correction);
+                x += dx;
+                iterations += correction.iterations;
+            }
+
+            result.iterations = iterations;
+            result.converged = converged;
+            result.reduction = defect0 > 0.0 ? defectNorm / defect0 : 0.0;
+        }
+
+        /// \brief Warn about preconditioners that linear_solver_reuse_preconditioner does not apply to.
+        ///
+        /// Only the ILU0 and CPR preconditioners are kept across solves. The
+        /// ILU0 update() keeps the fill-in pattern, colouring and level
+        /// schedules and refactorizes the new matrix values. The CPR update()
+        /// also keeps the pattern of the pressure matrix. The AMG hierarchy
+        /// cannot be refreshed in the same way: recalculateHierarchy()
+        /// recomputes the Galerkin products only, and leaves the smoothers
+        /// and the coarse solver factorized for the previous matrix.
+        void checkReuseParameters() const
+        {
+            if( ! parameters_.linear_solver_reuse_preconditioner_ || ! isIORank_ ||
+                parameters_.linear_solver_use_cpr_ ) {
+                return;
+            }
+            if( parameters_.linear_solver_single_precision_preconditioner_ ) {
+                OpmLog::warning("linear_solver_reuse_preconditioner has no effect with a single precision preconditioner, "
+                                "which is set up for every linear solve.");
+            }
+#if ! HAVE_UMFPACK
+            else if( parameters_.linear_solver_use_amg_ ) {
+                OpmLog::warning("linear_solver_reuse_preconditioner has no effect with linear_solver_use_amg, "
+                                "the AMG preconditioner is set up for every linear solve.");
+            }
+#endif
+        }
+
+        /// \brief Whether the preconditioner stored by a previous solve can be reused for matrix A.
+        ///
+        /// The preconditioner is rebuilt from scratch if it was set up for a
+        /// different matrix object, if the sparsity pattern of the matrix
+        /// changed, or if the previous solve failed.
+        bool canReusePreconditioner( const Matrix& A ) const
+        {
+            if( ! parameters_.linear_solver_reuse_preconditioner_ || ! cachedPreconditioner_ ) {
+                return false;
+            }
+            if( cachedMatrix_ != &A || A.N() + 1 != cachedRowStart_.size() ||
+                A.nonzeroes() != cachedColumns_.size() ) {
+                return false;
+            }
+            // The same object may have been rebuilt with a different pattern
+            // of the same size, so compare the pattern itself.
+            typename Matrix::size_type k = 0;
+            const auto endrow = A.end();
+            for( auto row = A.begin(); row != endrow; ++row ) {
+                if( cachedRowStart_[ row.index() ] != k ) {
+                    return false;
+                }
+                const auto endcol = row->end();
+                for( auto col = row->begin(); col != endcol; ++col, ++k ) {
+                    if( cachedColumns_[ k ] != col.index() ) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        /// \brief Keep a freshly constructed preconditioner for the following solves.
+        template <class Precond>
+        void storePreconditioner( const Matrix& A, std::unique_ptr< Precond >&& precond ) const
+        {
+            cachedPreconditioner_.reset( precond.release() );
+            cachedMatrix_ = &A;
+            cachedRowStart_.clear();
+            cachedRowStart_.reserve( A.N() + 1 );
+            cachedColumns_.clear();
+            cachedColumns_.reserve( A.nonzeroes() );
+            const auto endrow = A.end();
+            for( auto row = A.begin(); row != endrow; ++row ) {
+                cachedRowStart_.push_back( cachedColumns_.size() );
+                const auto endcol = row->end();
+                for( auto col = row->begin(); col != endcol; ++col ) {
+                    cachedColumns_.push_back( col.index() );
+                }
+            }
+            cachedRowStart_.push_back( cachedColumns_.size() );
+            ++preconditionerRebuilds_;
+        }
+
+        typedef ParallelOverlappingILU0<Matrix, Vector, Vector, Dune::Amg::SequentialInformation> SeqPreconditioner;
 
         template <class Operator>
-        std::unique_ptr<SeqPreconditioner> constructPrecond(Operator& opA, const Dune::Amg::SequentialInformation&) const
+        std::unique_ptr<SeqPreconditioner> constructPrecond(Operator& opA, const Dune::Amg::SequentialInformation& info) const
         {
             const double relax = 0.9;
-            std::unique_ptr<SeqPreconditioner> precond(new SeqPreconditioner(opA.getmat(), relax));
+            std::unique_ptr<SeqPreconditioner> precond(new SeqPreconditioner(opA.getmat(), info, relax,
+                                                                              parameters_.ilu_fillin_level_,
+                                                                              parameters_.ilu_milu_,
+                                                                              parameters_.ilu_multicolor_));
             return precond;
         }
 
@@ -259,7 +547,10 @@ namespace Opm
         {
             typedef std::unique_ptr<ParPreconditioner> Pointer;
             const double relax = 0.9;
-            return Pointer(new ParPreconditioner(opA.getmat(), comm, relax));
+            return Pointer(new ParPreconditioner(opA.getmat(), comm, relax,
+                                                 parameters_.ilu_fillin_level_,
+                                                 parameters_.ilu_milu_,
+                                                 parameters_.ilu_multicolor_));
         }
 #endif
 
@@ -391,6 +682,11 @@ namespace Opm
             // store number of iterations
             iterations_ = result.iterations;
 
+            // never keep a preconditioner that did not lead to convergence
+            if( !result.converged ) {
+                cachedPreconditioner_.reset();
+            }
+
             // Check for failure of linear solver.
             if (!parameters_.ignoreConvergenceFailure_ && !result.converged) {
                 const std::string msg("Convergence failure for linear solver.");
@@ -406,6 +702,19 @@ namespace Opm
         bool isIORank_;
 
         NewtonIterationBlackoilInterleavedParameters parameters_;
+        CPRParameter cprParameters_;
+        // index of the pressure in the blocks of the primary variables
+        int pressureIndex_;
+
+        // ILU0 or CPR preconditioner kept across solves if
+        // linear_solver_reuse_preconditioner is set, together with the
+        // matrix and the sparsity pattern it was set up for.
+        mutable std::shared_ptr< Dune::Preconditioner< Vector, Vector > > cachedPreconditioner_;
+        mutable const Matrix* cachedMatrix_;
+        mutable std::vector< typename Matrix::size_type > cachedRowStart_;
+        mutable std::vector< typename Matrix::size_type > cachedColumns_;
+        mutable int  preconditionerReuses_;
+        mutable int  preconditionerRebuilds_;
     }; // end ISTLSolver
 
 } // namespace Opm
@@ -0,0 +1,121 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_INDEXSELECTION_HEADER_INCLUDED
+#define OPM_INDEXSELECTION_HEADER_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace Opm
+{
+
+    /**
+     * A list of indices into a larger vector together with its inverse,
+     * used to gather (subset) and scatter (superset) the rows of values
+     * and jacobians without building selection matrices.
+     *
+     * The inverse maps every index r to the positions p with
+     * indices[p] == r, so repeated indices are allowed. Index sets used
+     * many times, like the perforated cells of the wells, should be kept
+     * in an IndexSelection instead of being converted on every call.
+     */
+    class IndexSelection
+    {
+    public:
+        /// Creates an empty selection.
+        IndexSelection()
+            : inverse_start_(1, 0),
+              ascending_(true)
+        {
+        }
+
+        /// Creates the selection of the given indices, IntVec must
+        /// provide size() and operator[].
+        template <class IntVec>
+        explicit IndexSelection(const IntVec& indices)
+            : ascending_(true)
+        {
+            const int m = indices.size();
+            indices_.resize(m);
+            int max_index = -1;
+            for (int p = 0; p < m; ++p) {
+                const int r = indices[p];
+                assert(r >= 0);
+                indices_[p] = r;
+                if (p > 0 && r <= indices_[p - 1]) {
+                    ascending_ = false;
+                }
+                max_index = std::max(max_index, r);
+            }
+
+            // Counting sort of the positions by index, which keeps the
+            // positions of each index in increasing order.
+            inverse_start_.assign(max_index + 2, 0);
+            for (int p = 0; p < m; ++p) {
+                ++inverse_start_[indices_[p] + 1];
+            }
+            for (int r = 0; r <= max_index; ++r) {
+                inverse_start_[r + 1] += inverse_start_[r];
+            }
+            inverse_positions_.resize(m);
+            std::vector<int> next(inverse_start_.begin(), inverse_start_.end() - 1);
+            for (int p = 0; p < m; ++p) {
+                inverse_positions_[next[indices_[p]]++] = p;
+            }
+        }
+
+        /// Number of selected indices.
+        int size() const { return indices_.size(); }
+
+        /// The p'th selected index.
+        int operator[](const int p) const { return indices_[p]; }
+
+        /// All selected indices.
+        const std::vector<int>& indices() const { return indices_; }
+
+        /// True if the indices are strictly increasing, then gathering or
+        /// scattering keeps the order of rows.
+        bool ascending() const { return ascending_; }
+
+        /// Begin of the positions p with indices[p] == r, in increasing order.
+        const int* positionsBegin(const int r) const
+        {
+            return inverse_positions_.data() + inverse_start_[std::min(r, maxIndex() + 1)];
+        }
+
+        /// End of the positions p with indices[p] == r.
+        const int* positionsEnd(const int r) const
+        {
+            return inverse_positions_.data() + inverse_start_[std::min(r + 1, maxIndex() + 1)];
+        }
+
+    private:
+        int maxIndex() const { return int(inverse_start_.size()) - 2; }
+
+        std::vector<int> indices_;
+        std::vector<int> inverse_start_;
+        std::vector<int> inverse_positions_;
+        bool ascending_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_INDEXSELECTION_HEADER_INCLUDED
@@ -0,0 +1,190 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_LOCALAUTODIFF_HEADER_INCLUDED
+#define OPM_LOCALAUTODIFF_HEADER_INCLUDED
+
+#include <opm/autodiff/AutoDiffBlock.hpp>
+#include <opm/material/densead/Evaluation.hpp>
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace Opm
+{
+
+    /**
+     * Cell-local dense forward automatic differentiation for AutoDiffBlock.
+     *
+     * Fluid properties like viscosities, formation volume factors and
+     * relative permeabilities of a cell only depend on the primary
+     * variables of the same cell, so all their jacobian blocks are
+     * diagonal. Instead of carrying global sparse jacobians through every
+     * intermediate step, the inputs are converted once to one dense
+     * evaluation per cell, holding the derivatives with respect to the
+     * cell variables, and the result is converted back to an AutoDiffBlock
+     * with diagonal jacobians at the end, like the Ebos models do.
+     *
+     * The conversion is only possible if every nonzero jacobian block of
+     * the inputs is square and diagonal, and if there are at most
+     * maxVariables such blocks. Use valid() to check.
+     */
+    class LocalAutoDiff
+    {
+    public:
+        typedef AutoDiffBlock<double> ADB;
+
+        /// Maximal number of cell variables: pressure, water saturation,
+        /// the gas variable and one more for the solvent or polymer models.
+        static const int maxVariables = 4;
+
+        typedef DenseAd::Evaluation<double, maxVariables> Evaluation;
+        typedef std::vector<Evaluation> Vector;
+
+        /// Converts the inputs, which must all have the same size and
+        /// block pattern unless they are constant. Null pointers and
+        /// empty inputs are converted to empty vectors.
+        explicit LocalAutoDiff(const std::vector<const ADB*>& inputs)
+            : num_cells_(0),
+              num_local_(0),
+              valid_(true),
+              local_(inputs.size())
+        {
+            // Find the blocks with nonzero derivatives.
+            for (const ADB* x : inputs) {
+                if (x == nullptr || x->size() == 0) {
+                    continue;
+                }
+                if (num_cells_ == 0) {
+                    num_cells_ = x->size();
+                }
+                if (x->size() != num_cells_) {
+                    valid_ = false;
+                    return;
+                }
+                if (x->derivative().empty()) {
+                    continue;
+                }
+                if (block_pattern_.empty()) {
+                    block_pattern_ = x->blockPattern();
+                    local_index_.assign(block_pattern_.size(), -1);
+                }
+                assert(x->blockPattern() == block_pattern_);
+                const int num_blocks = block_pattern_.size();
+                for (int block = 0; block < num_blocks; ++block) {
+                    if (local_index_[block] >= 0 || x->derivative()[block].nonZeros() == 0) {
+                        continue;
+                    }
+                    if (block_pattern_[block] != num_cells_ || num_local_ == maxVariables) {
+                        valid_ = false;
+                        return;
+                    }
+                    local_index_[block] = num_local_++;
+                }
+            }
+
+            // Gather the values and the diagonals of the local blocks.
+            std::vector<double> diagonal(num_cells_);
+            for (std::size_t input = 0; input < inputs.size(); ++input) {
+                const ADB* x = inputs[input];
+                if (x == nullptr || x->size() == 0) {
+                    continue;
+                }
+                Vector& y = local_[input];
+                y.assign(num_cells_, Evaluation(0.0));
+                for (int cell = 0; cell < num_cells_; ++cell) {
+                    y[cell].setValue(x->value()[cell]);
+                }
+                const int num_blocks = x->numBlocks();
+                for (int block = 0; block < num_blocks; ++block) {
+                    const int k = local_index_[block];
+                    if (k < 0) {
+                        continue;
+                    }
+                    if (!x->derivative()[block].toDiagonal(diagonal.data())) {
+                        valid_ = false;
+                        return;
+                    }
+                    for (int cell = 0; cell < num_cells_; ++cell) {
+                        y[cell].setDerivative(k, diagonal[cell]);
+                    }
+                }
+            }
+        }
+
+        /// True if all inputs could be converted.
+        bool valid() const { return valid_; }
+
+        /// Number of cells of the inputs.
+        int numCells() const { return num_cells_; }
+
+        /// The converted input with the given index.
+        const Vector& operator[](const int input) const
+        {
+            assert(valid_);
+            return local_[input];
+        }
+
+        /// Converts a result computed from the inputs to an AutoDiffBlock
+        /// with the block pattern of the inputs. The jacobian blocks of the
+        /// cell variables are diagonal, all others are zero.
+        ADB toAutoDiffBlock(const Vector& y) const
+        {
+            assert(valid_);
+            assert(int(y.size()) == num_cells_);
+            ADB::V value(num_cells_);
+            for (int cell = 0; cell < num_cells_; ++cell) {
+                value[cell] = y[cell].value();
+            }
+            if (block_pattern_.empty()) {
+                return ADB::constant(std::move(value));
+            }
+
+            const int num_blocks = block_pattern_.size();
+            std::vector<ADB::M> jacs(num_blocks);
+            ADB::V diagonal(num_cells_);
+            for (int block = 0; block < num_blocks; ++block) {
+                const int k = local_index_[block];
+                if (k < 0) {
+                    jacs[block] = ADB::M(num_cells_, block_pattern_[block]);
+                    continue;
+                }
+                for (int cell = 0; cell < num_cells_; ++cell) {
+                    diagonal[cell] = y[cell].derivative(k);
+                }
+                jacs[block] = ADB::M(diagonal.matrix().asDiagonal());
+            }
+            return ADB::function(std::move(value), std::move(jacs));
+        }
+
+    private:
+        int num_cells_;
+        int num_local_;
+        bool valid_;
+        std::vector<int> block_pattern_;
+        // Index of the derivative in Evaluation for every block, or -1
+        // if all inputs have zero derivatives for it.
+        std::vector<int> local_index_;
+        std::vector<Vector> local_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_LOCALAUTODIFF_HEADER_INCLUDED
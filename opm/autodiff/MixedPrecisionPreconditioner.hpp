@@ -0,0 +1,209 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_MIXEDPRECISIONPRECONDITIONER_HEADER_INCLUDED
+#define OPM_MIXEDPRECISIONPRECONDITIONER_HEADER_INCLUDED
+
+#include <opm/common/utility/platform_dependent/disable_warnings.h>
+
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioner.hh>
+
+#include <opm/common/utility/platform_dependent/reenable_warnings.h>
+
+#include <memory>
+#include <utility>
+
+namespace Opm
+{
+
+    /*!
+      \brief Preconditioner working in a lower precision than the Krylov solver.
+
+      The matrix is copied to the field type of the inner preconditioner,
+      usually float, and the inner preconditioner (ILU factors, AMG hierarchy)
+      is set up on that copy. Each application converts the defect to the
+      lower precision, applies the inner preconditioner and converts the
+      update back. This halves the memory traffic of the preconditioner
+      while the Krylov iteration itself, and hence the residual it monitors,
+      stays in the precision of X and Y.
+
+      \tparam FloatMatrix          The matrix type of the inner preconditioner.
+      \tparam X                    Type of the update
+      \tparam Y                    Type of the defect
+      \tparam FloatPreconditioner  Type of the inner preconditioner.
+    */
+    template<class FloatMatrix, class X, class Y, class FloatPreconditioner>
+    class MixedPrecisionPreconditioner : public Dune::Preconditioner<X,Y>
+    {
+        // prohibit copying for now
+        MixedPrecisionPreconditioner( const MixedPrecisionPreconditioner& );
+
+    public:
+        //! \brief The domain type of the preconditioner.
+        typedef X domain_type;
+        //! \brief The range type of the preconditioner.
+        typedef Y range_type;
+        //! \brief The field type of the preconditioner.
+        typedef typename X::field_type field_type;
+
+        //! \brief The domain type of the inner preconditioner.
+        typedef typename FloatPreconditioner::domain_type FloatDomain;
+        //! \brief The range type of the inner preconditioner.
+        typedef typename FloatPreconditioner::range_type FloatRange;
+        //! \brief Operator kept alive for the inner preconditioner, e.g. for AMG.
+        typedef Dune::LinearOperator< FloatDomain, FloatRange > FloatOperator;
+
+        // define the category
+        enum {
+            //! \brief The category the preconditioner is part of.
+            category = FloatPreconditioner::category
+        };
+
+        /*! \brief Constructor.
+
+          Copies the pattern and the values of A. The inner preconditioner
+          has to be set with setPreconditioner() before use.
+
+          \param A The matrix in the precision of the Krylov solver.
+        */
+        template <class Matrix>
+        explicit MixedPrecisionPreconditioner (const Matrix& A)
+            : A_( A.N(), A.M(), A.nonzeroes(), FloatMatrix::row_wise ),
+              vf_( A.N() ),
+              df_( A.N() )
+        {
+            auto row = A.begin();
+            const auto endrow = A_.createend();
+            for( auto frow = A_.createbegin(); frow != endrow; ++frow, ++row )
+            {
+                const auto endcol = row->end();
+                for( auto col = row->begin(); col != endcol; ++col )
+                {
+                    frow.insert( col.index() );
+                }
+            }
+            updateMatrix( A );
+        }
+
+        //! \brief The matrix in the precision of the inner preconditioner.
+        const FloatMatrix& matrix() const { return A_; }
+
+        //! \brief Copy the values of A, which must have the same sparsity pattern.
+        template <class Matrix>
+        void updateMatrix (const Matrix& A)
+        {
+            const int size = A.N();
+#pragma omp parallel for schedule(static)
+            for( int i = 0; i < size; ++i )
+            {
+                auto frow = A_[ i ].begin();
+                const auto endcol = A[ i ].end();
+                for( auto col = A[ i ].begin(); col != endcol; ++col, ++frow )
+                {
+                    auto& fblock = *frow;
+                    const auto& block = *col;
+                    for( int r = 0; r < FloatMatrix::block_type::rows; ++r ) {
+                        for( int c = 0; c < FloatMatrix::block_type::cols; ++c ) {
+                            fblock[ r ][ c ] = block[ r ][ c ];
+                        }
+                    }
+                }
+            }
+        }
+
+        /*! \brief Set the inner preconditioner.
+
+          \param precond  The preconditioner constructed from matrix().
+          \param op       An operator the preconditioner refers to. It is
+                          released after the preconditioner.
+        */
+        void setPreconditioner (std::unique_ptr< FloatPreconditioner >&& precond,
+                                std::shared_ptr< FloatOperator > op = std::shared_ptr< FloatOperator >())
+        {
+            precond_.reset();
+            op_ = op;
+            precond_ = std::move( precond );
+        }
+
+        /*!
+          \brief Prepare the preconditioner.
+
+          \copydoc Preconditioner::pre(X&,Y&)
+        */
+        virtual void pre (X& x, Y& b)
+        {
+            convert( x, vf_ );
+            convert( b, df_ );
+            precond_->pre( vf_, df_ );
+        }
+
+        /*!
+          \brief Apply the preconditoner.
+
+          \copydoc Preconditioner::apply(X&,const Y&)
+        */
+        virtual void apply (X& v, const Y& d)
+        {
+            convert( d, df_ );
+            vf_ = 0.0;
+            precond_->apply( vf_, df_ );
+            convert( vf_, v );
+        }
+
+        /*!
+          \brief Clean up.
+
+          \copydoc Preconditioner::post(X&)
+        */
+        virtual void post (X& x)
+        {
+            convert( x, vf_ );
+            precond_->post( vf_ );
+        }
+
+    protected:
+        //! \brief Componentwise copy between block vectors of different field types.
+        template <class Source, class Dest>
+        static void convert (const Source& source, Dest& dest)
+        {
+            const int size = source.size();
+#pragma omp parallel for schedule(static)
+            for( int i = 0; i < size; ++i )
+            {
+                for( int k = 0; k < Dest::block_type::dimension; ++k ) {
+                    dest[ i ][ k ] = source[ i ][ k ];
+                }
+            }
+        }
+
+        //! \brief The matrix in low precision.
+        FloatMatrix A_;
+        //! \brief Update and defect in low precision.
+        FloatDomain vf_;
+        FloatRange df_;
+        //! \brief The operator the inner preconditioner may refer to.
+        std::shared_ptr< FloatOperator > op_;
+        //! \brief The inner preconditioner.
+        std::unique_ptr< FloatPreconditioner > precond_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_MIXEDPRECISIONPRECONDITIONER_HEADER_INCLUDED
@@ -60,6 +60,7 @@ namespace Opm {
         }
         assert(well_perf_start == total_nperf);
         assert(int(well_cells.size()) == total_nperf);
+        well_cell_selection = IndexSelection(well_cells);
 
         // Create all the operator matrices,
         // using the setFromTriplets() method.
@@ -36,6 +36,7 @@
 
 #include <opm/autodiff/AutoDiffBlock.hpp>
 #include <opm/autodiff/AutoDiffHelpers.hpp>
+#include <opm/autodiff/IndexSelection.hpp>
 #include <opm/autodiff/BlackoilModelEnums.hpp>
 #include <opm/autodiff/BlackoilPropsAdInterface.hpp>
 #include <opm/autodiff/LinearisedBlackoilResidual.hpp>
@@ -72,6 +73,7 @@ namespace Opm {
                 Eigen::SparseMatrix<double> topseg2w;         // top segment -> well
                 AutoDiffMatrix eliminate_topseg;              // change the top segment related to be zero
                 std::vector<int> well_cells;                  // the set of perforated cells
+                IndexSelection well_cell_selection;           // gather/scatter map of well_cells
                 Vector conn_trans_factors;                         // connection transmissibility factors
                 bool has_multisegment_wells;                  // flag indicating whether there is any muli-segment well
             };
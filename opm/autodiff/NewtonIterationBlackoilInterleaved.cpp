@@ -36,6 +36,10 @@
 
 #include <opm/autodiff/ISTLSolver.hpp>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include <opm/common/utility/platform_dependent/disable_warnings.h>
 
 #if HAVE_UMFPACK
@@ -105,10 +109,28 @@ namespace Opm
         const boost::any& parallelInformation() const { return istlSolver_.parallelInformation(); }
 
     public:
-        void formInterleavedSystem(const std::vector<LinearisedBlackoilResidual::ADB>& eqs,
-                                   Mat& istlA) const
+        /// Forms the interleaved system matrix of the equations in istlA_.
+        /// The connectivity does not change within a report step, so the
+        /// block structure is built once and kept as long as all entries
+        /// of the jacobians fit into it. Later calls only refill the
+        /// block values in place, and the same matrix is handed to the
+        /// linear solver in every iteration.
+        Mat& formInterleavedSystem(const std::vector<LinearisedBlackoilResidual::ADB>& eqs) const
         {
             assert( np == int(eqs.size()) );
+            if (!fillInterleavedSystem(eqs)) {
+                createInterleavedPattern(eqs);
+                const bool filled = fillInterleavedSystem(eqs);
+                assert(filled);
+                static_cast<void>(filled);
+            }
+            return *istlA_;
+        }
+
+    protected:
+        /// Builds the block structure of istlA_.
+        void createInterleavedPattern(const std::vector<LinearisedBlackoilResidual::ADB>& eqs) const
+        {
             // Find sparsity structure as union of basic block sparsity structures,
             // corresponding to the jacobians with respect to pressure.
             // Use our custom PointOneOp to get to the union structure.
@@ -133,34 +155,60 @@ namespace Opm
 
             // Automatically convert the column major structure to a row-major structure
             Eigen::SparseMatrix<double, Eigen::RowMajor> row_major = col_major;
+            row_major.makeCompressed();
 
             const int size = row_major.rows();
             assert(size == row_major.cols());
 
-            {
-                // Create ISTL matrix with interleaved rows and columns (block structured).
-                istlA.setSize(row_major.rows(), row_major.cols(), row_major.nonZeros());
-                istlA.setBuildMode(Mat::row_wise);
-                const int* ia = row_major.outerIndexPtr();
-                const int* ja = row_major.innerIndexPtr();
-                const typename Mat::CreateIterator endrow = istlA.createend();
-                for (typename Mat::CreateIterator row = istlA.createbegin(); row != endrow; ++row) {
-                    const int ri = row.index();
-                    for (int i = ia[ri]; i < ia[ri + 1]; ++i) {
-                        row.insert(ja[i]);
-                    }
+            // Create ISTL matrix with interleaved rows and columns (block structured).
+            // A new matrix is created, which is allocated before the old one
+            // is released, so the linear solver does not mistake it for the
+            // matrix it may have kept a preconditioner for.
+            istlA_.reset(new Mat());
+            Mat& istlA = *istlA_;
+            istlA.setSize(size, size, row_major.nonZeros());
+            istlA.setBuildMode(Mat::row_wise);
+            const int* ia = row_major.outerIndexPtr();
+            const int* ja = row_major.innerIndexPtr();
+            const typename Mat::CreateIterator endrow = istlA.createend();
+            for (typename Mat::CreateIterator row = istlA.createbegin(); row != endrow; ++row) {
+                const int ri = row.index();
+                for (int i = ia[ri]; i < ia[ri + 1]; ++i) {
+                    row.insert(ja[i]);
                 }
             }
 
-            /*
-            // not neeeded since MatrixBlock initially zeros all elements during construction
-            // Set all blocks to zero.
-            for (auto row = istlA.begin(), rowend = istlA.end(); row != rowend; ++row ) {
-                for (auto col = row->begin(), colend = row->end(); col != colend; ++col ) {
-                    *col = 0.0;
+            // Keep the structure in CSR form, with the address of every
+            // block, for locating the entries when refilling.
+            rowStart_.assign(ia, ia + size + 1);
+            colIndex_.assign(ja, ja + row_major.nonZeros());
+            blocks_.clear();
+            blocks_.reserve(colIndex_.size());
+            for (auto row = istlA.begin(), rowend = istlA.end(); row != rowend; ++row) {
+                for (auto col = row->begin(), colend = row->end(); col != colend; ++col) {
+                    blocks_.push_back(&(*col));
                 }
             }
-            */
+            assert(blocks_.size() == colIndex_.size());
+        }
+
+        /// Refills the values of istlA_ from the jacobians. Returns false,
+        /// leaving the values undefined, if there is no structure yet or
+        /// an entry of the jacobians defining the structure has no block.
+        bool fillInterleavedSystem(const std::vector<LinearisedBlackoilResidual::ADB>& eqs) const
+        {
+            const int size = eqs[0].size();
+            if (!istlA_ || int(rowStart_.size()) != size + 1) {
+                return false;
+            }
+
+            // Zero all blocks, as not every block gets a value for
+            // every pair of equation and variable.
+            const int num_blocks = blocks_.size();
+#pragma omp parallel for schedule(static)
+            for (int k = 0; k < num_blocks; ++k) {
+                *blocks_[k] = 0.0;
+            }
 
             /**
              * Go through all jacobians, and insert in correct spot
@@ -172,26 +220,45 @@ namespace Opm
              * A faster alternative is to instead run through each "input matrix" and
              * insert its elements in the correct spot in the output matrix.
              *
+             * Every entry of an input matrix goes to its own block entry,
+             * so the columns can be handled in parallel.
              */
+            int missing = 0;
             for (int p1 = 0; p1 < np; ++p1) {
                 for (int p2 = 0; p2 < np; ++p2) {
+                    // Only these derivatives define the structure, see
+                    // createInterleavedPattern().
+                    const bool defines_pattern = (p2 == 0 || parameters_.require_full_sparsity_pattern_);
                     // Note that that since these are CSC and not CSR matrices,
                     // ja contains row numbers instead of column numbers.
                     const AutoDiffMatrix::SparseRep& s = eqs[p1].derivative()[p2].getSparse();
                     const int* ia = s.outerIndexPtr();
                     const int* ja = s.innerIndexPtr();
+                    const int* nnz = s.innerNonZeroPtr();
                     const double* sa = s.valuePtr();
+#pragma omp parallel for schedule(static) reduction(+:missing)
                     for (int col = 0; col < size; ++col) {
-                        for (int elem_ix = ia[col]; elem_ix < ia[col + 1]; ++elem_ix) {
+                        const int end = nnz ? ia[col] + nnz[col] : ia[col + 1];
+                        for (int elem_ix = ia[col]; elem_ix < end; ++elem_ix) {
                             const int row = ja[elem_ix];
-                            istlA[row][col][p1][p2] = sa[elem_ix];
+                            const int* begin = colIndex_.data() + rowStart_[row];
+                            const int* rowend = colIndex_.data() + rowStart_[row + 1];
+                            const int* pos = std::lower_bound(begin, rowend, col);
+                            if (pos != rowend && *pos == col) {
+                                (*blocks_[pos - colIndex_.data()])[p1][p2] = sa[elem_ix];
+                            } else {
+                                // Entries outside the pressure pattern are
+                                // dropped unless the full pattern is required.
+                                missing += defines_pattern;
+                            }
                         }
                     }
                 }
             }
+            return missing == 0;
         }
 
-
+    public:
         /// Solve the linear system Ax = b, with A being the
         /// combined derivative matrix of the residual and b
         /// being the residual itself.
@@ -250,9 +317,8 @@ namespace Opm
             }
             assert(pos == size_b);
 
-            // Create ISTL matrix with interleaved rows and columns (block structured).
-            Mat istlA;
-            formInterleavedSystem(eqs, istlA);
+            // Form ISTL matrix with interleaved rows and columns (block structured).
+            Mat& istlA = formInterleavedSystem(eqs);
 
             // Solve reduced system.
             SolutionVector dx(SolutionVector::Zero(b.size()));
@@ -292,6 +358,13 @@ namespace Opm
     protected:
         ISTLSolverType istlSolver_;
         NewtonIterationBlackoilInterleavedParameters parameters_;
+
+        // System matrix reused across iterations, see formInterleavedSystem().
+        mutable std::unique_ptr<Mat> istlA_;
+        // Structure of istlA_ in CSR form and the address of every block.
+        mutable std::vector<int> rowStart_;
+        mutable std::vector<int> colIndex_;
+        mutable std::vector<MatrixBlockType*> blocks_;
     }; // end NewtonIterationBlackoilInterleavedImpl
 
 
@@ -44,6 +44,13 @@ namespace Opm
         bool   require_full_sparsity_pattern_;
         bool   ignoreConvergenceFailure_;
         bool   linear_solver_use_amg_;
+        bool   linear_solver_use_cpr_;
+        bool   linear_solver_reuse_preconditioner_;
+        int    ilu_fillin_level_;
+        bool   ilu_milu_;
+        bool   ilu_multicolor_;
+        bool   linear_solver_single_precision_preconditioner_;
+        int    linear_solver_refinement_steps_;
 
         NewtonIterationBlackoilInterleavedParameters() { reset(); }
         // read values from parameter class
@@ -61,6 +68,13 @@ namespace Opm
             require_full_sparsity_pattern_ = param.getDefault("require_full_sparsity_pattern", require_full_sparsity_pattern_);
             ignoreConvergenceFailure_ = param.getDefault("linear_solver_ignoreconvergencefailure", ignoreConvergenceFailure_);
             linear_solver_use_amg_    = param.getDefault("linear_solver_use_amg", linear_solver_use_amg_ );
+            linear_solver_use_cpr_    = param.getDefault("linear_solver_use_cpr", linear_solver_use_cpr_ );
+            linear_solver_reuse_preconditioner_ = param.getDefault("linear_solver_reuse_preconditioner", linear_solver_reuse_preconditioner_ );
+            ilu_fillin_level_ = param.getDefault("ilu_fillin_level", ilu_fillin_level_ );
+            ilu_milu_ = param.getDefault("ilu_milu", ilu_milu_ );
+            ilu_multicolor_ = param.getDefault("ilu_multicolor", ilu_multicolor_ );
+            linear_solver_single_precision_preconditioner_ = param.getDefault("linear_solver_single_precision_preconditioner", linear_solver_single_precision_preconditioner_ );
+            linear_solver_refinement_steps_ = param.getDefault("linear_solver_refinement_steps", linear_solver_refinement_steps_ );
         }
 
         // set default values
@@ -74,6 +88,13 @@ namespace Opm
             require_full_sparsity_pattern_ = false;
             ignoreConvergenceFailure_ = false;
             linear_solver_use_amg_    = false;
+            linear_solver_use_cpr_    = false;
+            linear_solver_reuse_preconditioner_ = false;
+            ilu_fillin_level_ = 0;
+            ilu_milu_ = false;
+            ilu_multicolor_ = false;
+            linear_solver_single_precision_preconditioner_ = false;
+            linear_solver_refinement_steps_ = 3;
         }
     };
 
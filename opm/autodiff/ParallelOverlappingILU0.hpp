@@ -22,6 +22,15 @@
 
 #include <dune/istl/preconditioner.hh>
 #include <dune/istl/paamg/smoother.hh>
+#include <dune/istl/paamg/pinfo.hh>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace Opm
 {
@@ -80,6 +89,25 @@ namespace Opm
 /// make sure that x is consistent.
 /// In contrast for ParallelRestrictedOverlappingSchwarz we solve (LU)x = d for x
 /// without forcing consistency between the two steps.
+/// If ParallelInfo is Dune::Amg::SequentialInformation the preconditioner is a
+/// plain sequential ILU0.
+///
+/// Besides ILU0 the factorization can use the sparsity pattern of ILU(k),
+/// i.e. fill-in up to level k is kept, and the modified ILU (MILU) which
+/// adds the dropped fill-in to the diagonal block such that the row sums
+/// of the factorization equal those of the matrix.
+///
+/// Both triangular solves and the factorization are level scheduled: when
+/// the preconditioner is set up the rows are grouped into levels such that
+/// the rows of one level only depend on rows of earlier levels. The rows
+/// within a level are then processed by all OpenMP threads.
+///
+/// Optionally the rows are reordered by a greedy multicolouring of the
+/// matrix graph before the factorization (red-black for a Cartesian
+/// 7-point stencil). No two rows of the same colour are coupled, hence
+/// there are only as many levels as colours. The factorization of the
+/// reordered matrix is usually a weaker preconditioner than the one of the
+/// original ordering, but it exposes far more parallelism.
 /// \tparam Matrix The type of the Matrix.
 /// \tparam Domain The type of the Vector representing the domain.
 /// \tparam Range The type of the Vector representing the range.
@@ -97,11 +125,14 @@ public:
     typedef Range range_type;
     //! \brief The field type of the preconditioner.
     typedef typename Domain::field_type field_type;
+    //! \brief The type used for row indices.
+    typedef typename matrix_type::size_type size_type;
 
     // define the category
     enum {
         //! \brief The category the preconditioner is part of.
-        category=Dune::SolverCategory::overlapping
+        category = std::is_same<ParallelInfo, Dune::Amg::SequentialInformation>::value ?
+        Dune::SolverCategory::sequential : Dune::SolverCategory::overlapping
     };
 
     /*! \brief Constructor.
@@ -109,31 +140,47 @@ public:
       Constructor gets all parameters to operate the prec.
       \param A The matrix to operate on.
       \param w The relaxation factor.
+      \param fillInLevel The level k of the fill-in kept (ILU(k)).
+      \param milu Whether to use the modified ILU.
+      \param multicolor Whether to factorize the matrix reordered by a
+                        multicolouring of its graph.
     */
     ParallelOverlappingILU0 (const Matrix& A, const ParallelInfo& comm,
-                             field_type w)
-        : ilu_(A), comm_(comm), w_(w)
+                             field_type w, int fillInLevel = 0,
+                             bool milu = false, bool multicolor = false)
+        : ilu_(), A_(&A), comm_(&comm), w_(w), milu_(milu)
     {
-        int ilu_setup_successful = 1;
-        std::string message;
-        try
+        if ( multicolor )
         {
-            bilu0_decomposition(ilu_);
+            computeColoring();
+            dReordered_.resize(A.N());
+            vReordered_.resize(A.M());
         }
-        catch ( Dune::MatrixBlockError error )
+        if ( multicolor || fillInLevel > 0 )
         {
-            message = error.what();
-            std::cerr<<"Exception occured on process " <<
-                comm.communicator().rank() << " during " <<
-                "setup of ILU0 preconditioner with message: " <<
-                message<<std::endl;
-            ilu_setup_successful = 0;
+            createFactorMatrix(fillInLevel);
         }
-        // Check whether there was a problem on some process
-        if ( comm.communicator().min(ilu_setup_successful) == 0 )
+        else
         {
-            throw Dune::MatrixBlockError();
+            ilu_ = A;
         }
+        computeLevelSchedule();
+        decompose();
+    }
+
+    /*!
+      \brief Recompute the factorization after the values of the matrix changed.
+
+      The matrix passed to the constructor must still be alive and have the
+      same sparsity pattern, as only the numerical values are copied before
+      the decomposition is redone.
+      \param comm The parallel information to use from now on.
+    */
+    void update (const ParallelInfo& comm)
+    {
+        comm_ = &comm;
+        copyValues();
+        decompose();
     }
 
     /*!
@@ -155,31 +202,28 @@ public:
     virtual void apply (Domain& v, const Range& d)
     {
         Range& md = const_cast<Range&>(d);
-        comm_.copyOwnerToAll(md,md);
-        auto endrow=ilu_.end();
-        for ( auto row = ilu_.begin(); row != endrow; ++row )
+        comm_->copyOwnerToAll(md,md);
+        if ( ordering_.empty() )
         {
-            auto rhs(d[row.index()]);
-            for ( auto col = row->begin(); col.index() < row.index(); ++col )
-            {
-                col->mmv(v[col.index()],rhs);
-            }
-            v[row.index()] = rhs;
+            forwardSolve(v, d);
+            comm_->copyOwnerToAll(v, v);
+            backwardSolve(v);
         }
-        comm_.copyOwnerToAll(v, v);
-        auto rendrow = ilu_.beforeBegin();
-        for( auto row = ilu_.beforeEnd(); row != rendrow; --row)
+        else
         {
-            auto rhs(v[row.index()]);
-            auto col = row->beforeEnd();
-            for( ; col.index() > row.index(); --col)
+            gather(d, dReordered_);
+            forwardSolve(vReordered_, dReordered_);
+            if ( category == Dune::SolverCategory::overlapping )
             {
-                col->mmv(v[col.index()], rhs);
+                // the communication works on the original ordering
+                scatter(vReordered_, v);
+                comm_->copyOwnerToAll(v, v);
+                gather(v, vReordered_);
             }
-            v[row.index()] = 0;
-            col->umv(rhs, v[row.index()]);
+            backwardSolve(vReordered_);
+            scatter(vReordered_, v);
         }
-        comm_.copyOwnerToAll(v, v);
+        comm_->copyOwnerToAll(v, v);
         v *= w_;
     }
 
@@ -194,11 +238,424 @@ public:
     }
 
 private:
-    //! \brief The ILU0 decomposition of the matrix.
-    Matrix ilu_;
-    const ParallelInfo& comm_;
+    //! \brief Rows of a triangular solve grouped by level.
+    struct LevelSchedule
+    {
+        //! \brief The row indices, ordered by level.
+        std::vector<size_type> rows;
+        //! \brief Offsets of the levels into rows, one more than the number of levels.
+        std::vector<int> levelStart;
+    };
+
+    //! \brief Levels with fewer rows are processed by a single thread.
+    static const int minParallelLevelSize = 512;
+
+    //! \brief Solve Ly = d with the unit lower triangular factor.
+    template<class X, class Y>
+    void forwardSolve(X& v, const Y& d)
+    {
+        const int numLevels = lower_.levelStart.size() - 1;
+        for ( int level = 0; level < numLevels; ++level )
+        {
+            const int begin = lower_.levelStart[level];
+            const int end = lower_.levelStart[level + 1];
+#pragma omp parallel for schedule(static) if(end - begin >= minParallelLevelSize)
+            for ( int k = begin; k < end; ++k )
+            {
+                const size_type i = lower_.rows[k];
+                auto& row = ilu_[i];
+                auto rhs(d[i]);
+                for ( auto col = row.begin(); col.index() < i; ++col )
+                {
+                    col->mmv(v[col.index()],rhs);
+                }
+                v[i] = rhs;
+            }
+        }
+    }
+
+    //! \brief Solve Ux = y in place, the diagonal blocks store the inverse.
+    template<class X>
+    void backwardSolve(X& v)
+    {
+        const int numLevels = upper_.levelStart.size() - 1;
+        for ( int level = 0; level < numLevels; ++level )
+        {
+            const int begin = upper_.levelStart[level];
+            const int end = upper_.levelStart[level + 1];
+#pragma omp parallel for schedule(static) if(end - begin >= minParallelLevelSize)
+            for ( int k = begin; k < end; ++k )
+            {
+                const size_type i = upper_.rows[k];
+                auto& row = ilu_[i];
+                auto rhs(v[i]);
+                auto col = row.beforeEnd();
+                for( ; col.index() > i; --col)
+                {
+                    col->mmv(v[col.index()], rhs);
+                }
+                v[i] = 0;
+                col->umv(rhs, v[i]);
+            }
+        }
+    }
+
+    //! \brief Copy a vector in the original ordering to the reordered one.
+    template<class V>
+    void gather(const V& original, V& reordered) const
+    {
+        const int size = ordering_.size();
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < size; ++i )
+        {
+            reordered[i] = original[ordering_[i]];
+        }
+    }
+
+    //! \brief Copy a vector in the reordered ordering back to the original one.
+    template<class V>
+    void scatter(const V& reordered, V& original) const
+    {
+        const int size = ordering_.size();
+#pragma omp parallel for schedule(static)
+        for ( int i = 0; i < size; ++i )
+        {
+            original[ordering_[i]] = reordered[i];
+        }
+    }
+
+    //! \brief Greedy colouring of the matrix graph, rows are then ordered by colour.
+    void computeColoring()
+    {
+        const size_type n = A_->N();
+        std::vector<int> color(n, -1);
+        // forbidden[c] == i if colour c is used by a neighbour of row i
+        std::vector<size_type> forbidden;
+        int numColors = 0;
+        const auto endrow = A_->end();
+        for ( auto row = A_->begin(); row != endrow; ++row )
+        {
+            const size_type i = row.index();
+            const auto endcol = row->end();
+            for ( auto col = row->begin(); col != endcol; ++col )
+            {
+                const int c = color[col.index()];
+                if ( col.index() != i && c >= 0 )
+                {
+                    forbidden[c] = i;
+                }
+            }
+            int c = 0;
+            while ( c < numColors && forbidden[c] == i )
+            {
+                ++c;
+            }
+            if ( c == numColors )
+            {
+                forbidden.push_back(n);
+                ++numColors;
+            }
+            color[i] = c;
+        }
+
+        LevelSchedule colors;
+        groupByLevel(color, colors);
+        ordering_.swap(colors.rows);
+        inverseOrdering_.resize(n);
+        for ( size_type i = 0; i < n; ++i )
+        {
+            inverseOrdering_[ordering_[i]] = i;
+        }
+    }
+
+    //! \brief Column of the factor for column col of the matrix.
+    size_type reorderedIndex(const size_type col) const
+    {
+        return ordering_.empty() ? col : inverseOrdering_[col];
+    }
+
+    //! \brief Row of the matrix for row i of the factor.
+    size_type originalIndex(const size_type i) const
+    {
+        return ordering_.empty() ? i : ordering_[i];
+    }
+
+    //! \brief Set up the sparsity pattern of ilu_ and copy the values.
+    //!
+    //! The pattern is the one of the (reordered) matrix extended by all
+    //! fill-in entries of level at most fillInLevel. The level of a fill-in
+    //! entry (i,j) created by eliminating with row k is
+    //! level(i,k) + level(k,j) + 1, the entries of the matrix have level 0.
+    void createFactorMatrix(const int fillInLevel)
+    {
+        const size_type n = A_->N();
+        // fill levels of the upper triangular part of the rows already set up
+        std::vector<std::vector<std::pair<size_type, int> > > upperLevels(fillInLevel > 0 ? n : 0);
+        ilu_.setSize(n, n);
+        ilu_.setBuildMode(matrix_type::row_wise);
+        const auto endrow = ilu_.createend();
+        for ( auto row = ilu_.createbegin(); row != endrow; ++row )
+        {
+            const size_type i = row.index();
+            std::map<size_type, int> rowLevels;
+            const auto& originalRow = (*A_)[originalIndex(i)];
+            const auto endcol = originalRow.end();
+            for ( auto col = originalRow.begin(); col != endcol; ++col )
+            {
+                rowLevels.emplace(reorderedIndex(col.index()), 0);
+            }
+            if ( fillInLevel > 0 )
+            {
+                // entries inserted during the loop have a larger index and are visited later
+                for ( auto ik = rowLevels.begin(); ik != rowLevels.end() && ik->first < i; ++ik )
+                {
+                    for ( const auto& kj : upperLevels[ik->first] )
+                    {
+                        const int level = ik->second + kj.second + 1;
+                        if ( level > fillInLevel )
+                        {
+                            continue;
+                        }
+                        auto ij = rowLevels.find(kj.first);
+                        if ( ij == rowLevels.end() )
+                        {
+                            rowLevels.emplace(kj.first, level);
+                        }
+                        else
+                        {
+                            ij->second = std::min(ij->second, level);
+                        }
+                    }
+                }
+            }
+            for ( const auto& entry : rowLevels )
+            {
+                row.insert(entry.first);
+                if ( fillInLevel > 0 && entry.first > i )
+                {
+                    upperLevels[i].push_back(entry);
+                }
+            }
+        }
+        copyValues();
+    }
+
+    //! \brief Copy the values of the matrix into ilu_.
+    //!
+    //! Applies the reordering if any and zeroes the fill-in entries.
+    void copyValues()
+    {
+        if ( ordering_.empty() && ilu_.nonzeroes() == A_->nonzeroes() )
+        {
+            // same pattern
+            auto ilurow = ilu_.begin();
+            const auto endrow = A_->end();
+            for ( auto row = A_->begin(); row != endrow; ++row, ++ilurow )
+            {
+                auto ilucol = ilurow->begin();
+                const auto endcol = row->end();
+                for ( auto col = row->begin(); col != endcol; ++col, ++ilucol )
+                {
+                    *ilucol = *col;
+                }
+            }
+        }
+        else
+        {
+            const int n = ilu_.N();
+#pragma omp parallel for schedule(static)
+            for ( int i = 0; i < n; ++i )
+            {
+                auto& row = ilu_[i];
+                const auto endilucol = row.end();
+                for ( auto ilucol = row.begin(); ilucol != endilucol; ++ilucol )
+                {
+                    *ilucol = 0.0;
+                }
+                const auto& originalRow = (*A_)[originalIndex(i)];
+                const auto endcol = originalRow.end();
+                for ( auto col = originalRow.begin(); col != endcol; ++col )
+                {
+                    row[reorderedIndex(col.index())] = *col;
+                }
+            }
+        }
+    }
+
+    //! \brief Compute the level schedules of both triangular solves.
+    //!
+    //! Only the sparsity pattern is used, hence the schedules remain
+    //! valid when the values are refreshed by update().
+    void computeLevelSchedule()
+    {
+        std::vector<int> level(ilu_.N(), 0);
+        const auto endrow = ilu_.end();
+        for ( auto row = ilu_.begin(); row != endrow; ++row )
+        {
+            const size_type i = row.index();
+            int rowLevel = 0;
+            for ( auto col = row->begin(); col.index() < i; ++col )
+            {
+                rowLevel = std::max(rowLevel, level[col.index()] + 1);
+            }
+            level[i] = rowLevel;
+        }
+        groupByLevel(level, lower_);
+
+        const auto rendrow = ilu_.beforeBegin();
+        for ( auto row = ilu_.beforeEnd(); row != rendrow; --row )
+        {
+            const size_type i = row.index();
+            int rowLevel = 0;
+            for ( auto col = row->beforeEnd(); col.index() > i; --col )
+            {
+                rowLevel = std::max(rowLevel, level[col.index()] + 1);
+            }
+            level[i] = rowLevel;
+        }
+        groupByLevel(level, upper_);
+    }
+
+    //! \brief Sort the rows by level (counting sort, stable within a level).
+    static void groupByLevel(const std::vector<int>& level, LevelSchedule& schedule)
+    {
+        const int numLevels = level.empty() ? 0 : *std::max_element(level.begin(), level.end()) + 1;
+        schedule.levelStart.assign(numLevels + 1, 0);
+        for ( const int l : level )
+        {
+            ++schedule.levelStart[l + 1];
+        }
+        std::partial_sum(schedule.levelStart.begin(), schedule.levelStart.end(),
+                         schedule.levelStart.begin());
+        std::vector<int> position(schedule.levelStart.begin(), schedule.levelStart.end() - 1);
+        schedule.rows.resize(level.size());
+        for ( size_type i = 0; i < level.size(); ++i )
+        {
+            schedule.rows[position[level[i]]++] = i;
+        }
+    }
+
+    //! \brief Incomplete elimination of row i (same algorithm as Dune::bilu0_decomposition).
+    //!
+    //! Only rows of the lower triangular part are read, which were handled
+    //! on an earlier level of the forward schedule. Updates of entries
+    //! outside the pattern are dropped, or added to the diagonal for MILU.
+    //! \return false if the diagonal block is missing.
+    bool factorizeRow(const size_type i)
+    {
+        typedef typename matrix_type::block_type Block;
+        auto& row = ilu_[i];
+        const auto endij = row.end();
+        auto diag = row.find(i);
+        if ( diag == endij )
+        {
+            return false;
+        }
+        for ( auto ij = row.begin(); ij != diag; ++ij )
+        {
+            auto& rowj = ilu_[ij.index()];
+            auto jj = rowj.find(ij.index());
+            // L_ij = A_ij * inv(A_jj)
+            (*ij).rightmultiply(*jj);
+            // A_ik -= L_ij * U_jk
+            auto ik = ij;
+            ++ik;
+            auto jk = jj;
+            ++jk;
+            const auto endjk = rowj.end();
+            for ( ; jk != endjk; ++jk )
+            {
+                while ( ik != endij && ik.index() < jk.index() )
+                {
+                    ++ik;
+                }
+                if ( ik != endij && ik.index() == jk.index() )
+                {
+                    Block B(*jk);
+                    B.leftmultiply(*ij);
+                    *ik -= B;
+                }
+                else if ( milu_ )
+                {
+                    Block B(*jk);
+                    B.leftmultiply(*ij);
+                    *diag -= B;
+                }
+            }
+        }
+        diag->invert();
+        return true;
+    }
+
+    void decompose()
+    {
+        int ilu_setup_successful = 1;
+        std::string message;
+        const int numLevels = lower_.levelStart.size() - 1;
+        for ( int level = 0; level < numLevels && ilu_setup_successful; ++level )
+        {
+            const int begin = lower_.levelStart[level];
+            const int end = lower_.levelStart[level + 1];
+#pragma omp parallel for schedule(static) if(end - begin >= minParallelLevelSize)
+            for ( int k = begin; k < end; ++k )
+            {
+                const size_type i = lower_.rows[k];
+                try
+                {
+                    if ( ! factorizeRow(i) )
+                    {
+#pragma omp critical
+                        {
+                            message = "diagonal entry missing in row " + std::to_string(i);
+                            ilu_setup_successful = 0;
+                        }
+                    }
+                }
+                catch ( Dune::FMatrixError error )
+                {
+#pragma omp critical
+                    {
+                        message = "ILU failed to invert matrix block in row " + std::to_string(i)
+                            + ": " + error.what();
+                        ilu_setup_successful = 0;
+                    }
+                }
+            }
+        }
+        if ( ! ilu_setup_successful )
+        {
+            std::cerr<<"Exception occured on process " <<
+                comm_->communicator().rank() << " during " <<
+                "setup of ILU0 preconditioner with message: " <<
+                message<<std::endl;
+        }
+        // Check whether there was a problem on some process
+        if ( comm_->communicator().min(ilu_setup_successful) == 0 )
+        {
+            throw Dune::MatrixBlockError();
+        }
+    }
+
+    //! \brief The incomplete LU decomposition of the (possibly reordered) matrix.
+    matrix_type ilu_;
+    //! \brief The matrix the decomposition is computed from.
+    const Matrix* A_;
+    const ParallelInfo* comm_;
     //! \brief The relaxation factor to use.
     field_type w_;
+    //! \brief Whether dropped fill-in is added to the diagonal.
+    bool milu_;
+    //! \brief The level schedule of the forward substitution.
+    LevelSchedule lower_;
+    //! \brief The level schedule of the backward substitution.
+    LevelSchedule upper_;
+    //! \brief Original row index of each reordered row, empty if not reordered.
+    std::vector<size_type> ordering_;
+    //! \brief Reordered row index of each original row.
+    std::vector<size_type> inverseOrdering_;
+    //! \brief Work vectors in the reordered numbering.
+    Range dReordered_;
+    Domain vReordered_;
 
 };
 
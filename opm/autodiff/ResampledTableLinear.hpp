@@ -0,0 +1,196 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_RESAMPLEDTABLELINEAR_HEADER_INCLUDED
+#define OPM_RESAMPLEDTABLELINEAR_HEADER_INCLUDED
+
+#include <opm/core/utility/NonuniformTableLinear.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace Opm
+{
+
+    /**
+     * A piecewise linear table which can be resampled onto a uniform grid.
+     *
+     * Without resampling the table behaves exactly like
+     * NonuniformTableLinear, which searches the interval of every lookup.
+     * After resample() lookups inside the table range are plain index
+     * arithmetic on the uniform grid, which is cheaper and vectorises
+     * well when many values are evaluated at once with evaluate().
+     * Outside the table range both modes extrapolate linearly with the
+     * first or last interval of the original table.
+     *
+     * Both the original and the resampled table are piecewise linear, so
+     * their largest difference is attained at one of the original
+     * sample points. resample() returns it as the resampling error.
+     */
+    class ResampledTableLinear
+    {
+    public:
+        /// Creates an empty table.
+        ResampledTableLinear()
+            : xmin_(0.0),
+              inv_h_(0.0)
+        {
+        }
+
+        /// Creates the table through the points (x[i], y[i]), x must be
+        /// strictly increasing.
+        template <class XVec, class YVec>
+        ResampledTableLinear(const XVec& x, const YVec& y)
+            : table_(x, y),
+              x_(x.begin(), x.end()),
+              y_(y.begin(), y.end()),
+              xmin_(0.0),
+              inv_h_(0.0)
+        {
+            assert(x_.size() == y_.size());
+        }
+
+        /// Resamples the table onto num_points uniformly spaced points
+        /// covering the range of the original table, or goes back to the
+        /// original table if num_points is less than two. Returns the
+        /// largest absolute difference to the original table.
+        double resample(const int num_points)
+        {
+            values_.clear();
+            slopes_.clear();
+            if (num_points < 2 || x_.size() < 2) {
+                return 0.0;
+            }
+
+            xmin_ = x_.front();
+            const double h = (x_.back() - x_.front()) / (num_points - 1);
+            inv_h_ = 1.0 / h;
+            values_.resize(num_points);
+            for (int k = 0; k < num_points; ++k) {
+                values_[k] = table_(k + 1 < num_points ? xmin_ + k * h : x_.back());
+            }
+            slopes_.resize(num_points - 1);
+            for (int k = 0; k + 1 < num_points; ++k) {
+                slopes_[k] = (values_[k + 1] - values_[k]) * inv_h_;
+            }
+
+            double error = 0.0;
+            for (std::size_t i = 0; i < x_.size(); ++i) {
+                error = std::max(error, std::fabs((*this)(x_[i]) - y_[i]));
+            }
+            return error;
+        }
+
+        /// True if the table has been resampled onto a uniform grid.
+        bool isResampled() const { return !values_.empty(); }
+
+        /// Number of points of the uniform grid, zero if not resampled.
+        int numResampledPoints() const { return values_.size(); }
+
+        /// Largest absolute value of the original table, as a scale for
+        /// the resampling error.
+        double maxAbsValue() const
+        {
+            double m = 0.0;
+            for (const double v : y_) {
+                m = std::max(m, std::fabs(v));
+            }
+            return m;
+        }
+
+        /// Evaluates the table at x.
+        double operator()(const double x) const
+        {
+            int k;
+            double t;
+            if (!uniformInterval(x, k, t)) {
+                return table_(x);
+            }
+            return values_[k] + (t - k) * (values_[k + 1] - values_[k]);
+        }
+
+        /// Evaluates the derivative of the table at x.
+        double derivative(const double x) const
+        {
+            int k;
+            double t;
+            if (!uniformInterval(x, k, t)) {
+                return table_.derivative(x);
+            }
+            return slopes_[k];
+        }
+
+        /// Evaluates the table and its derivative at the n points x,
+        /// writing the results to y and dy.
+        void evaluate(const double* x, double* y, double* dy, const int n) const
+        {
+            if (!isResampled()) {
+                for (int i = 0; i < n; ++i) {
+                    y[i] = table_(x[i]);
+                    dy[i] = table_.derivative(x[i]);
+                }
+                return;
+            }
+
+            const int last = values_.size() - 2;
+            const double xmax = x_.back();
+            for (int i = 0; i < n; ++i) {
+                const double xi = x[i];
+                if (xi < xmin_ || xi > xmax) {
+                    y[i] = table_(xi);
+                    dy[i] = table_.derivative(xi);
+                    continue;
+                }
+                const double t = (xi - xmin_) * inv_h_;
+                const int k = std::min(int(t), last);
+                y[i] = values_[k] + (t - k) * (values_[k + 1] - values_[k]);
+                dy[i] = slopes_[k];
+            }
+        }
+
+    private:
+        // Finds the interval k of the uniform grid containing x and the
+        // scaled coordinate t of x, returns false if the table is not
+        // resampled or x is outside the table range.
+        bool uniformInterval(const double x, int& k, double& t) const
+        {
+            if (!isResampled() || x < xmin_ || x > x_.back()) {
+                return false;
+            }
+            t = (x - xmin_) * inv_h_;
+            k = std::min(int(t), int(values_.size()) - 2);
+            return true;
+        }
+
+        NonuniformTableLinear<double> table_;
+        std::vector<double> x_;
+        std::vector<double> y_;
+
+        // The uniform grid, empty if not resampled.
+        double xmin_;
+        double inv_h_;
+        std::vector<double> values_;
+        std::vector<double> slopes_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_RESAMPLEDTABLELINEAR_HEADER_INCLUDED
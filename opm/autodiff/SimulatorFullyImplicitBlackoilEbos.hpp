@@ -348,6 +348,14 @@ public:
                     "Time step took " + std::to_string(stepReport.solver_time) + " seconds; "
                     "total solver time " + std::to_string(report.solver_time) + " seconds.";
                 OpmLog::note(msg);
+
+                const int precondReuses = solver->model().linearPreconditionerReuses();
+                if (precondReuses > 0) {
+                    msg =
+                        "Linear solver preconditioner set up " + std::to_string(solver->model().linearPreconditionerRebuilds()) + " times, "
+                        "reused " + std::to_string(precondReuses) + " times so far.";
+                    OpmLog::note(msg);
+                }
             }
 
             // Increment timer, remember well state.
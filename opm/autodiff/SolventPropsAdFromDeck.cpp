@@ -22,6 +22,11 @@
 #include <opm/autodiff/AutoDiffHelpers.hpp>
 
 #include <opm/core/utility/extractPvtTableIndex.hpp>
+#include <opm/common/OpmLog/OpmLog.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
 
 #include <opm/parser/eclipse/EclipseState/Tables/TableManager.hpp>
 #include <opm/parser/eclipse/EclipseState/Tables/PvdsTable.hpp>
@@ -42,7 +47,8 @@ typedef Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> Bl
 SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                                                      const EclipseState& eclState,
                                                      const int number_of_cells,
-                                                     const int* global_cell)
+                                                     const int* global_cell,
+                                                     const int num_table_points)
 {
     if (deck.hasKeyword("SOLVENT")) {
         // retrieve the cell specific PVT table index from the deck
@@ -89,9 +95,9 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                     inverseBmu[i] = 1.0 / (b[i] * visc[i]);
                 }
 
-                b_[regionIdx] = NonuniformTableLinear<double>(press, inverseB);
-                viscosity_[regionIdx] = NonuniformTableLinear<double>(press, visc);
-                inverseBmu_[regionIdx] = NonuniformTableLinear<double>(press, inverseBmu);
+                b_[regionIdx] = ResampledTableLinear(press, inverseB);
+                viscosity_[regionIdx] = ResampledTableLinear(press, visc);
+                inverseBmu_[regionIdx] = ResampledTableLinear(press, inverseBmu);
             }
         } else {
             OPM_THROW(std::runtime_error, "PVDS must be specified in SOLVENT runs\n");
@@ -114,8 +120,8 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                 const auto& krg = ssfnTable.getGasRelPermMultiplierColumn();
                 const auto& krs = ssfnTable.getSolventRelPermMultiplierColumn();
 
-                krg_[regionIdx] = NonuniformTableLinear<double>(solventFraction, krg);
-                krs_[regionIdx] = NonuniformTableLinear<double>(solventFraction, krs);
+                krg_[regionIdx] = ResampledTableLinear(solventFraction, krg);
+                krs_[regionIdx] = ResampledTableLinear(solventFraction, krs);
             }
 
         } else {
@@ -146,7 +152,7 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                     const auto& sn = sof2Table.getSoColumn();
                     const auto& krn = sof2Table.getKroColumn();
 
-                    krn_[regionIdx] = NonuniformTableLinear<double>(sn, krn);
+                    krn_[regionIdx] = ResampledTableLinear(sn, krn);
                 }
 
             } else {
@@ -168,7 +174,7 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                     const auto& solventFraction = miscTable.getSolventFractionColumn();
                     const auto& misc = miscTable.getMiscibilityColumn();
 
-                    misc_[regionIdx] = NonuniformTableLinear<double>(solventFraction, misc);
+                    misc_[regionIdx] = ResampledTableLinear(solventFraction, misc);
 
                 }
             } else {
@@ -189,7 +195,7 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                     const auto& po = pmiscTable.getOilPhasePressureColumn();
                     const auto& pmisc = pmiscTable.getMiscibilityColumn();
 
-                    pmisc_[regionIdx] = NonuniformTableLinear<double>(po, pmisc);
+                    pmisc_[regionIdx] = ResampledTableLinear(po, pmisc);
 
                 }
             }
@@ -212,8 +218,8 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                     const auto& krsg = msfnTable.getGasSolventRelpermMultiplierColumn();
                     const auto& kro = msfnTable.getOilRelpermMultiplierColumn();
 
-                    mkrsg_[regionIdx] = NonuniformTableLinear<double>(Ssg, krsg);
-                    mkro_[regionIdx] = NonuniformTableLinear<double>(Ssg, kro);
+                    mkrsg_[regionIdx] = ResampledTableLinear(Ssg, krsg);
+                    mkro_[regionIdx] = ResampledTableLinear(Ssg, kro);
 
                 }
             }
@@ -232,7 +238,7 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                     const auto& sw = sorwmisTable.getWaterSaturationColumn();
                     const auto& sorwmis = sorwmisTable.getMiscibleResidualOilColumn();
 
-                    sorwmis_[regionIdx] = NonuniformTableLinear<double>(sw, sorwmis);
+                    sorwmis_[regionIdx] = ResampledTableLinear(sw, sorwmis);
                 }
             }
 
@@ -250,7 +256,7 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                     const auto& sw = sgcwmisTable.getWaterSaturationColumn();
                     const auto& sgcwmis = sgcwmisTable.getMiscibleResidualGasColumn();
 
-                    sgcwmis_[regionIdx] = NonuniformTableLinear<double>(sw, sgcwmis);
+                    sgcwmis_[regionIdx] = ResampledTableLinear(sw, sgcwmis);
                 }
             }
 
@@ -290,7 +296,7 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
                         const auto& po = tlpmixparTable.getOilPhasePressureColumn();
                         const auto& tlpmixpa = tlpmixparTable.getMiscibilityColumn();
 
-                        tlpmix_param_[regionIdx] = NonuniformTableLinear<double>(po, tlpmixpa);
+                        tlpmix_param_[regionIdx] = ResampledTableLinear(po, tlpmixpa);
 
                     }
                 } else {
@@ -306,6 +312,8 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
 
 
         }
+
+        resampleTables(num_table_points);
     }
 
 }
@@ -313,19 +321,12 @@ SolventPropsAdFromDeck::SolventPropsAdFromDeck(const Deck& deck,
 ADB SolventPropsAdFromDeck::muSolvent(const ADB& pg,
                                  const Cells& cells) const
 {
-    const int n = cells.size();
-    assert(pg.value().size() == n);
-    V mu(n);
-    V dmudp(n);
-    for (int i = 0; i < n; ++i) {
-        const double& pg_i = pg.value()[i];
-        int regionIdx = cellPvtRegionIdx_[cells[i]];
-        double tempInvB = b_[regionIdx](pg_i);
-        double tempInvBmu = inverseBmu_[regionIdx](pg_i);
-        mu[i] = tempInvB / tempInvBmu;
-        dmudp[i] = (tempInvBmu * b_[regionIdx].derivative(pg_i)
-                         - tempInvB * inverseBmu_[regionIdx].derivative(pg_i)) / (tempInvBmu * tempInvBmu);
-    }
+    assert(pg.value().size() == int(cells.size()));
+    V invB, dinvBdp, invBmu, dinvBmudp;
+    evaluateTables(pg.value(), cells, cellPvtRegionIdx_, b_, invB, dinvBdp);
+    evaluateTables(pg.value(), cells, cellPvtRegionIdx_, inverseBmu_, invBmu, dinvBmudp);
+    V mu = invB / invBmu;
+    V dmudp = (invBmu * dinvBdp - invB * dinvBmudp) / (invBmu * invBmu);
 
     ADB::M dmudp_diag(dmudp.matrix().asDiagonal());
     const int num_blocks = pg.numBlocks();
@@ -423,16 +424,10 @@ ADB SolventPropsAdFromDeck::miscibleResidualOilSaturationFunction (const ADB& Sw
 ADB SolventPropsAdFromDeck::makeADBfromTables(const ADB& X_AD,
                                               const Cells& cells,
                                               const std::vector<int>& regionIdx,
-                                              const std::vector<NonuniformTableLinear<double>>& tables) const {
-    const int n = cells.size();
-    assert(X_AD.value().size() == n);
-    V x(n);
-    V dx(n);
-    for (int i = 0; i < n; ++i) {
-        const double& X_i = X_AD.value()[i];
-        x[i] = tables[regionIdx[cells[i]]](X_i);
-        dx[i] = tables[regionIdx[cells[i]]].derivative(X_i);
-    }
+                                              const std::vector<ResampledTableLinear>& tables) const {
+    assert(X_AD.value().size() == int(cells.size()));
+    V x, dx;
+    evaluateTables(X_AD.value(), cells, regionIdx, tables, x, dx);
 
     ADB::M dx_diag(dx.matrix().asDiagonal());
     const int num_blocks = X_AD.numBlocks();
@@ -444,6 +439,87 @@ ADB SolventPropsAdFromDeck::makeADBfromTables(const ADB& X_AD,
 }
 
 
+void SolventPropsAdFromDeck::evaluateTables(const V& x,
+                                            const Cells& cells,
+                                            const std::vector<int>& regionIdx,
+                                            const std::vector<ResampledTableLinear>& tables,
+                                            V& y,
+                                            V& dy) const {
+    const int n = cells.size();
+    y.resize(n);
+    dy.resize(n);
+    if (tables.size() == 1) {
+        tables[0].evaluate(x.data(), y.data(), dy.data(), n);
+        return;
+    }
+
+    // Gather the lookup values of each region to evaluate its table in
+    // one batch, then scatter the results back.
+    const int num_regions = tables.size();
+    std::vector<int> start(num_regions + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        ++start[regionIdx[cells[i]] + 1];
+    }
+    for (int r = 0; r < num_regions; ++r) {
+        start[r + 1] += start[r];
+    }
+    std::vector<int> order(n);
+    std::vector<int> next(start.begin(), start.end() - 1);
+    V xr(n);
+    for (int i = 0; i < n; ++i) {
+        const int pos = next[regionIdx[cells[i]]]++;
+        order[pos] = i;
+        xr[pos] = x[i];
+    }
+    V yr(n);
+    V dyr(n);
+    for (int r = 0; r < num_regions; ++r) {
+        tables[r].evaluate(xr.data() + start[r], yr.data() + start[r], dyr.data() + start[r], start[r + 1] - start[r]);
+    }
+    for (int pos = 0; pos < n; ++pos) {
+        y[order[pos]] = yr[pos];
+        dy[order[pos]] = dyr[pos];
+    }
+}
+
+void SolventPropsAdFromDeck::resampleTables(const int num_points) {
+    if (num_points < 2) {
+        return;
+    }
+
+    std::ostringstream ss;
+    ss << "Solvent tables resampled onto " << num_points << " uniform points, largest errors:";
+    const auto resample = [&](const char* name, std::vector<ResampledTableLinear>& tables) {
+        if (tables.empty()) {
+            return;
+        }
+        double error = 0.0;
+        double relative_error = 0.0;
+        for (auto& table : tables) {
+            const double e = table.resample(num_points);
+            const double scale = table.maxAbsValue();
+            error = std::max(error, e);
+            relative_error = std::max(relative_error, scale > 0.0 ? e / scale : 0.0);
+        }
+        ss << "\n    " << std::setw(14) << std::left << name << std::setw(12) << error
+           << " (relative " << relative_error << ")";
+    };
+    resample("1/B", b_);
+    resample("viscosity", viscosity_);
+    resample("1/(B mu)", inverseBmu_);
+    resample("krg", krg_);
+    resample("krs", krs_);
+    resample("krn", krn_);
+    resample("mkro", mkro_);
+    resample("mkrsg", mkrsg_);
+    resample("misc", misc_);
+    resample("pmisc", pmisc_);
+    resample("sorwmis", sorwmis_);
+    resample("sgcwmis", sgcwmis_);
+    resample("tlpmixpa", tlpmix_param_);
+    OpmLog::info(ss.str());
+}
+
 V SolventPropsAdFromDeck::solventSurfaceDensity(const Cells& cells) const {
     const int n = cells.size();
     V density(n);
@@ -23,7 +23,7 @@
 #include <opm/autodiff/BlackoilPropsAdInterface.hpp>
 #include <opm/autodiff/AutoDiffBlock.hpp>
 
-#include <opm/core/utility/NonuniformTableLinear.hpp>
+#include <opm/autodiff/ResampledTableLinear.hpp>
 
 #include <opm/parser/eclipse/Deck/Deck.hpp>
 #include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
@@ -37,10 +37,15 @@ namespace Opm
 class SolventPropsAdFromDeck
 {
 public:
+    /// \param[in] num_table_points  If at least two, all tables are resampled
+    ///                              onto this number of uniformly spaced
+    ///                              points for faster lookups, and the
+    ///                              resampling errors are logged.
     SolventPropsAdFromDeck(const Deck& deck,
                            const EclipseState& eclipseState,
                            const int number_of_cells,
-                           const int* global_cell);
+                           const int* global_cell,
+                           const int num_table_points = 0);
 
     ////////////////////////////
     //      Fluid interface   //
@@ -160,7 +165,25 @@ private:
     ADB makeADBfromTables(const ADB& X,
                           const Cells& cells,
                           const std::vector<int>& regionIdx,
-                          const std::vector<NonuniformTableLinear<double>>& tables) const;
+                          const std::vector<ResampledTableLinear>& tables) const;
+
+    /// Evaluates the tables and their derivatives, batched by region.
+    /// \param[in]  x               Array of n table lookup values.
+    /// \param[in]  cells           Array of n cell indices to be associated with the lookup values.
+    /// \param[in]  regionIdx       Table index of each cell.
+    /// \param[in]  tables          Vector of tables, one for each region.
+    /// \param[out] y               Array of n table values.
+    /// \param[out] dy              Array of n table derivatives.
+    void evaluateTables(const V& x,
+                        const Cells& cells,
+                        const std::vector<int>& regionIdx,
+                        const std::vector<ResampledTableLinear>& tables,
+                        V& y,
+                        V& dy) const;
+
+    /// Resamples all tables onto num_points uniformly spaced points
+    /// and logs the largest resampling error of each kind of table.
+    void resampleTables(const int num_points);
 
     /// Helper function to create an array containing the
     /// table index of for each compressed cell from an Eclipse deck.
@@ -179,20 +202,20 @@ private:
     std::vector<int> cellPvtRegionIdx_;
     std::vector<int> cellMiscRegionIdx_;
     std::vector<int> cellSatNumRegionIdx_;
-    std::vector<NonuniformTableLinear<double> > b_;
-    std::vector<NonuniformTableLinear<double> > viscosity_;
-    std::vector<NonuniformTableLinear<double> > inverseBmu_;
+    std::vector<ResampledTableLinear> b_;
+    std::vector<ResampledTableLinear> viscosity_;
+    std::vector<ResampledTableLinear> inverseBmu_;
     std::vector<double> solvent_surface_densities_;
-    std::vector<NonuniformTableLinear<double> > krg_;
-    std::vector<NonuniformTableLinear<double> > krs_;
-    std::vector<NonuniformTableLinear<double> > krn_;
-    std::vector<NonuniformTableLinear<double> > mkro_;
-    std::vector<NonuniformTableLinear<double> > mkrsg_;
-    std::vector<NonuniformTableLinear<double> > misc_;
-    std::vector<NonuniformTableLinear<double> > pmisc_;
-    std::vector<NonuniformTableLinear<double> > sorwmis_;
-    std::vector<NonuniformTableLinear<double> > sgcwmis_;
-    std::vector<NonuniformTableLinear<double> > tlpmix_param_;
+    std::vector<ResampledTableLinear> krg_;
+    std::vector<ResampledTableLinear> krs_;
+    std::vector<ResampledTableLinear> krn_;
+    std::vector<ResampledTableLinear> mkro_;
+    std::vector<ResampledTableLinear> mkrsg_;
+    std::vector<ResampledTableLinear> misc_;
+    std::vector<ResampledTableLinear> pmisc_;
+    std::vector<ResampledTableLinear> sorwmis_;
+    std::vector<ResampledTableLinear> sgcwmis_;
+    std::vector<ResampledTableLinear> tlpmix_param_;
     std::vector<double> mix_param_viscosity_;
     std::vector<double> mix_param_density_;
 };
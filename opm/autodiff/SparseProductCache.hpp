@@ -0,0 +1,402 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_SPARSEPRODUCTCACHE_HEADER_INCLUDED
+#define OPM_SPARSEPRODUCTCACHE_HEADER_INCLUDED
+
+#include <opm/common/utility/platform_dependent/disable_warnings.h>
+
+#include <Eigen/Sparse>
+
+#include <opm/common/utility/platform_dependent/reenable_warnings.h>
+
+#include <opm/autodiff/fastSparseOperations.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Opm
+{
+
+    /**
+     * Cache of the symbolic structure of sparse matrix products.
+     *
+     * The discrete operators (gradient, divergence, face averages) never
+     * change, and the jacobians they are multiplied with keep their
+     * sparsity pattern between iterations. For such products the cache
+     * stores the structural pattern of the result, keyed on the patterns
+     * of the operands, so a repeated product only needs the numeric
+     * phase: accumulating each result column in a dense work array and
+     * reading off the entries of the known pattern.
+     *
+     * Like fastSparseProduct(), entries to which only zero products
+     * contribute are dropped from the result, so the result, including
+     * its number of nonzeros, is the same as that of fastSparseProduct().
+     *
+     * Patterns are looked up by a key computed from the dimensions and a
+     * fixed number of sampled indices of the operands, and a candidate is
+     * only accepted if its stored operand patterns compare equal. The
+     * memory held is bounded by a capacity in bytes, evicting the least
+     * recently used pattern first.
+     *
+     * The cache may be shared by several threads. Lookups and insertions
+     * are serialized, while the symbolic and numeric phases run
+     * concurrently. Use instance() to get the cache shared by all threads,
+     * such that a pattern computed by one thread is found by the others.
+     */
+    class SparseProductCache
+    {
+    public:
+        typedef Eigen::SparseMatrix<double> Matrix;
+
+        /// Default capacity of the cache.
+        static const std::size_t defaultCapacity = std::size_t(64) << 20;
+
+        explicit SparseProductCache(const std::size_t capacityBytes = defaultCapacity)
+            : capacity_(capacityBytes),
+              bytes_(0),
+              hits_(0),
+              misses_(0)
+        {
+        }
+
+        /// The cache shared by all threads.
+        static SparseProductCache& instance()
+        {
+            static SparseProductCache cache;
+            return cache;
+        }
+
+        /// Computes res = lhs * rhs, reusing the pattern of res if the
+        /// patterns of lhs and rhs have been seen before.
+        void multiply(const Matrix& lhs, const Matrix& rhs, Matrix& res)
+        {
+            if (capacity_ == 0 || lhs.nonZeros() == 0 || rhs.nonZeros() == 0
+                || !lhs.isCompressed() || !rhs.isCompressed()) {
+                fastSparseProduct(lhs, rhs, res);
+                return;
+            }
+
+            const std::size_t key = combine(patternKey(lhs), patternKey(rhs));
+            std::shared_ptr<const Matrix> pattern = find(key, lhs, rhs);
+
+            if (!pattern) {
+                Entry added;
+                added.key = key;
+                added.lhs = Pattern(lhs);
+                added.rhs = Pattern(rhs);
+                std::shared_ptr<Matrix> result = std::make_shared<Matrix>();
+                symbolicProduct(lhs, rhs, *result);
+                added.result = result;
+                added.bytes = added.lhs.bytes() + added.rhs.bytes() + resultBytes(*result);
+                pattern = insert(std::move(added), lhs, rhs);
+            }
+
+            numericProduct(lhs, rhs, *pattern, res);
+        }
+
+        /// Number of products that reused a cached pattern.
+        std::size_t hits() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return hits_;
+        }
+
+        /// Number of products that had to compute the pattern.
+        std::size_t misses() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return misses_;
+        }
+
+        /// Number of patterns held.
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return entries_.size();
+        }
+
+        /// Approximate number of bytes held by the patterns.
+        std::size_t bytes() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return bytes_;
+        }
+
+        /// Sets the maximal number of bytes held, zero disables the cache.
+        void setCapacity(const std::size_t capacityBytes)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacityBytes;
+            evict(capacity_);
+        }
+
+        /// Drops all patterns and resets the statistics.
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries_.clear();
+            index_.clear();
+            bytes_ = 0;
+            hits_ = 0;
+            misses_ = 0;
+        }
+
+    private:
+        typedef Matrix::Index Index;
+
+        struct Pattern
+        {
+            Pattern() : rows(0), cols(0) {}
+
+            explicit Pattern(const Matrix& m)
+                : rows(m.rows()),
+                  cols(m.cols()),
+                  outer(m.outerIndexPtr(), m.outerIndexPtr() + m.outerSize() + 1),
+                  inner(m.innerIndexPtr(), m.innerIndexPtr() + m.nonZeros())
+            {
+            }
+
+            std::size_t bytes() const
+            {
+                return (outer.size() + inner.size()) * sizeof(int);
+            }
+
+            Index rows;
+            Index cols;
+            std::vector<int> outer;
+            std::vector<int> inner;
+        };
+
+        struct Entry
+        {
+            std::size_t key;
+            std::size_t bytes;
+            Pattern lhs;
+            Pattern rhs;
+            // Structural pattern of the result. It is shared such that
+            // the numeric phase can use it while the entry is evicted.
+            std::shared_ptr<const Matrix> result;
+        };
+
+        typedef std::list<Entry>::iterator EntryIterator;
+
+        // The cached pattern of the product of lhs and rhs, or null.
+        std::shared_ptr<const Matrix> find(const std::size_t key, const Matrix& lhs, const Matrix& rhs)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const EntryIterator entry = lookup(key, lhs, rhs);
+            if (entry == entries_.end()) {
+                return std::shared_ptr<const Matrix>();
+            }
+            ++hits_;
+            entries_.splice(entries_.begin(), entries_, entry);
+            return entry->result;
+        }
+
+        // Adds a pattern computed after find() failed, unless another
+        // thread added the same pattern in the meantime or it exceeds the
+        // capacity. Returns the pattern to use.
+        std::shared_ptr<const Matrix> insert(Entry&& added, const Matrix& lhs, const Matrix& rhs)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++misses_;
+            const EntryIterator entry = lookup(added.key, lhs, rhs);
+            if (entry != entries_.end()) {
+                return entry->result;
+            }
+            if (added.bytes > capacity_) {
+                return added.result;
+            }
+            evict(capacity_ - added.bytes);
+            bytes_ += added.bytes;
+            entries_.push_front(std::move(added));
+            index_.insert(std::make_pair(entries_.front().key, entries_.begin()));
+            return entries_.front().result;
+        }
+
+        // The entry for the patterns of lhs and rhs, or entries_.end().
+        // The mutex must be held.
+        EntryIterator lookup(const std::size_t key, const Matrix& lhs, const Matrix& rhs)
+        {
+            const auto range = index_.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (samePattern(it->second->lhs, lhs) && samePattern(it->second->rhs, rhs)) {
+                    return it->second;
+                }
+            }
+            return entries_.end();
+        }
+
+        static std::size_t resultBytes(const Matrix& m)
+        {
+            return (m.outerSize() + 1) * sizeof(int)
+                + m.nonZeros() * (sizeof(int) + sizeof(double));
+        }
+
+        // Drops the least recently used patterns until at most
+        // maxBytes are held. The mutex must be held.
+        void evict(const std::size_t maxBytes)
+        {
+            while (bytes_ > maxBytes) {
+                const Entry& last = entries_.back();
+                const auto range = index_.equal_range(last.key);
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (&*it->second == &last) {
+                        index_.erase(it);
+                        break;
+                    }
+                }
+                bytes_ -= last.bytes;
+                entries_.pop_back();
+            }
+        }
+
+        static std::size_t combine(std::size_t seed, const std::size_t value)
+        {
+            seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+
+        // Key from the dimensions and a fixed number of evenly spaced
+        // indices, so computing it does not depend on the size of the
+        // matrix. The matrix must be in compressed mode.
+        static std::size_t patternKey(const Matrix& m)
+        {
+            const int samples = 16;
+            std::uint64_t h = 14695981039346656037ull;
+            const auto mix = [&h](const std::uint64_t v) { h = (h ^ v) * 1099511628211ull; };
+            mix(m.rows());
+            mix(m.cols());
+            mix(m.nonZeros());
+            const auto* outer = m.outerIndexPtr();
+            const auto* inner = m.innerIndexPtr();
+            const Index nouter = m.outerSize() + 1;
+            const Index ninner = m.nonZeros();
+            for (int s = 0; s < samples; ++s) {
+                mix(outer[(nouter - 1) * s / (samples - 1)]);
+                mix(inner[(ninner - 1) * s / (samples - 1)]);
+            }
+            return h;
+        }
+
+        static bool samePattern(const Pattern& p, const Matrix& m)
+        {
+            return p.rows == m.rows() && p.cols == m.cols()
+                && Index(p.inner.size()) == m.nonZeros()
+                && std::equal(p.outer.begin(), p.outer.end(), m.outerIndexPtr())
+                && std::equal(p.inner.begin(), p.inner.end(), m.innerIndexPtr());
+        }
+
+        // Structural product pattern, without dropping numerical zeros.
+        static void symbolicProduct(const Matrix& lhs, const Matrix& rhs, Matrix& res)
+        {
+            const Index rows = lhs.rows();
+            const Index cols = rhs.cols();
+            res = Matrix(rows, cols);
+            res.reserve(lhs.nonZeros() + rhs.nonZeros());
+
+            std::vector<bool> mask(rows, false);
+            std::vector<Index> indices(rows);
+            for (Index j = 0; j < cols; ++j) {
+                Index nnz = 0;
+                for (Matrix::InnerIterator rhsIt(rhs, j); rhsIt; ++rhsIt) {
+                    for (Matrix::InnerIterator lhsIt(lhs, rhsIt.index()); lhsIt; ++lhsIt) {
+                        const Index i = lhsIt.index();
+                        if (!mask[i]) {
+                            mask[i] = true;
+                            indices[nnz++] = i;
+                        }
+                    }
+                }
+                std::sort(indices.begin(), indices.begin() + nnz);
+                res.startVec(j);
+                for (Index k = 0; k < nnz; ++k) {
+                    res.insertBackByOuterInner(j, indices[k]) = 0.0;
+                    mask[indices[k]] = false;
+                }
+            }
+            res.finalize();
+        }
+
+        // Numeric product on the structural pattern. The products are
+        // summed in the same order as in fastSparseProduct(), which also
+        // skips the products that are zero, and only the entries that
+        // received a nonzero product are stored. The work arrays are kept
+        // per thread.
+        static void numericProduct(const Matrix& lhs, const Matrix& rhs, const Matrix& pattern, Matrix& res)
+        {
+            static thread_local std::vector<double> work;
+            static thread_local std::vector<char> touched;
+            const Index rows = lhs.rows();
+            const Index cols = rhs.cols();
+            work.assign(rows, 0.0);
+            touched.assign(rows, 0);
+
+            res = Matrix(rows, cols);
+            res.reserve(pattern.nonZeros());
+
+            const auto* outer = pattern.outerIndexPtr();
+            const auto* inner = pattern.innerIndexPtr();
+            for (Index j = 0; j < cols; ++j) {
+                for (Matrix::InnerIterator rhsIt(rhs, j); rhsIt; ++rhsIt) {
+                    const double y = rhsIt.value();
+                    for (Matrix::InnerIterator lhsIt(lhs, rhsIt.index()); lhsIt; ++lhsIt) {
+                        const double val = lhsIt.value() * y;
+                        if (std::abs(val) > 0.0) {
+                            work[lhsIt.index()] += val;
+                            touched[lhsIt.index()] = 1;
+                        }
+                    }
+                }
+                res.startVec(j);
+                for (Index k = outer[j]; k < outer[j + 1]; ++k) {
+                    const Index i = inner[k];
+                    if (touched[i]) {
+                        res.insertBackByOuterInner(j, i) = work[i];
+                        work[i] = 0.0;
+                        touched[i] = 0;
+                    }
+                }
+            }
+            res.finalize();
+        }
+
+        // Read without the mutex by multiply().
+        std::atomic<std::size_t> capacity_;
+        std::size_t bytes_;
+        std::size_t hits_;
+        std::size_t misses_;
+        std::list<Entry> entries_;
+        std::unordered_multimap<std::size_t, EntryIterator> index_;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_SPARSEPRODUCTCACHE_HEADER_INCLUDED
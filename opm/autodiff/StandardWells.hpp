@@ -41,7 +41,9 @@
 #include <opm/core/wells/WellCollection.hpp>
 #include <opm/autodiff/AutoDiffBlock.hpp>
 #include <opm/autodiff/AutoDiffHelpers.hpp>
+#include <opm/autodiff/IndexSelection.hpp>
 #include <opm/autodiff/BlackoilPropsAdInterface.hpp>
+#include <opm/autodiff/VFPProdProperties.hpp>
 #include <opm/simulators/WellSwitchingLogger.hpp>
 
 namespace Opm {
@@ -55,6 +57,7 @@ namespace Opm {
                 Eigen::SparseMatrix<double> w2p;              // well -> perf (scatter)
                 Eigen::SparseMatrix<double> p2w;              // perf -> well (gather)
                 std::vector<int> well_cells;                  // the set of perforated cells
+                IndexSelection well_cell_selection;           // gather/scatter map of well_cells
             };
 
             // ---------      Types      ---------
@@ -214,6 +217,8 @@ namespace Opm {
             const std::vector<bool>*  active_;
             const std::vector<PhasePresence>*  phase_condition_;
             const VFPProperties* vfp_properties_;
+            // VFP table lookup hint of each well, see VFPProdProperties::InterpHint
+            std::vector<VFPProdProperties::InterpHint> vfp_hints_;
             double gravity_;
             // the depth of the all the cell centers
             // for standard Wells, it the same with the perforation depth
@@ -29,6 +29,8 @@
 #include <opm/common/utility/platform_dependent/reenable_warnings.h>
 
 #include <cassert>
+#include <exception>
+#include <string>
 #include <tuple>
 
 #include <opm/parser/eclipse/EclipseState/Schedule/Schedule.hpp>
@@ -42,6 +44,7 @@
 #include <opm/autodiff/WellHelpers.hpp>
 #include <opm/autodiff/BlackoilModelEnums.hpp>
 #include <opm/autodiff/WellDensitySegmented.hpp>
+#include <opm/autodiff/WellBlockMatrix.hpp>
 #include <opm/autodiff/BlackoilDetails.hpp>
 #include <opm/autodiff/BlackoilModelParameters.hpp>
 #include <opm/autodiff/LinearisedBlackoilResidual.hpp>
@@ -174,8 +177,20 @@ enum WellVariablePositions {
                 resWell_.resize( nw );
 
                 // resize temporary class variables
-                Cx_.resize( duneC_.N() );
                 invDrw_.resize( invDuneD_.N() );
+
+                vfpHints_.resize( nw );
+
+                // number the perforated cells for computeWellContributions
+                perforatedCellIndex_.assign( nc, -1 );
+                int numPerforatedCells = 0;
+                for (int perf = 0; perf < nperf; ++perf) {
+                    const int cell_idx = wells().well_cells[perf];
+                    if (perforatedCellIndex_[cell_idx] < 0) {
+                        perforatedCellIndex_[cell_idx] = numPerforatedCells++;
+                    }
+                }
+                wellContributions_.resize( numPerforatedCells );
             }
 
 
@@ -232,63 +247,117 @@ enum WellVariablePositions {
                 auto& ebosJac = ebosSimulator.model().linearizer().matrix();
                 auto& ebosResid = ebosSimulator.model().linearizer().residual();
 
-                const double volume = 0.002831684659200; // 0.1 cu ft;
+                // The wells are assembled in parallel. Each well only writes
+                // to its own rows of B, C and D, but several wells may
+                // perforate the same cell, so the perforation fluxes are
+                // stored and subtracted from the reservoir equations after
+                // the loop, in the same order as a serial assembly. An
+                // exception must not leave the parallel region, so the
+                // first one of every well is rethrown after the loop.
+                perfFluxes_.resize(wells().well_connpos[nw] * np);
+                std::vector<std::exception_ptr> errors(nw);
+        #pragma omp parallel for schedule(dynamic)
                 for (int w = 0; w < nw; ++w) {
-                    bool allow_cf = allow_cross_flow(w, ebosSimulator);
-                    for (int perf = wells().well_connpos[w] ; perf < wells().well_connpos[w+1]; ++perf) {
+                    try {
+                        assembleWellEq(ebosSimulator, dt, w, well_state, only_wells);
+                    } catch (...) {
+                        errors[w] = std::current_exception();
+                    }
+                }
+                for (int w = 0; w < nw; ++w) {
+                    if (errors[w]) {
+                        std::rethrow_exception(errors[w]);
+                    }
+                }
 
+                if (!only_wells) {
+                    for (int perf = 0; perf < wells().well_connpos[nw]; ++perf) {
                         const int cell_idx = wells().well_cells[perf];
-                        const auto& intQuants = *(ebosSimulator.model().cachedIntensiveQuantities(cell_idx, /*timeIdx=*/0));
-                        std::vector<EvalWell> cq_s(np,0.0);
-                        computeWellFlux(w, wells().WI[perf], intQuants, wellPerforationPressureDiffs()[perf], allow_cf, cq_s);
-
                         for (int p1 = 0; p1 < np; ++p1) {
+                            const EvalWell& cq_s = perfFluxes_[perf*np + p1];
 
-                            if (!only_wells) {
-                                // subtract sum of phase fluxes in the reservoir equation.
-                                ebosResid[cell_idx][flowPhaseToEbosCompIdx(p1)] -= cq_s[p1].value();
+                            // subtract sum of phase fluxes in the reservoir equation.
+                            ebosResid[cell_idx][flowPhaseToEbosCompIdx(p1)] -= cq_s.value();
+                            for (int p2 = 0; p2 < np; ++p2) {
+                                ebosJac[cell_idx][cell_idx][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] -= cq_s.derivative(p2);
                             }
+                        }
+                    }
+                }
 
-                            // subtract sum of phase fluxes in the well equations.
-                            resWell_[w][flowPhaseToEbosCompIdx(p1)] -= cq_s[p1].value();
+                // do the local inversion of D.
+                localInvert( invDuneD_ );
 
-                            // assemble the jacobians
-                            for (int p2 = 0; p2 < np; ++p2) {
-                                if (!only_wells) {
-                                    ebosJac[cell_idx][cell_idx][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] -= cq_s[p1].derivative(p2);
-                                    duneB_[w][cell_idx][flowToEbosPvIdx(p2)][flowPhaseToEbosCompIdx(p1)] -= cq_s[p1].derivative(p2+blocksize); // intput in transformed matrix
-                                    duneC_[w][cell_idx][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] -= cq_s[p1].derivative(p2);
-                                }
-                                invDuneD_[w][w][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] -= cq_s[p1].derivative(p2+blocksize);
-                            }
+                if (!only_wells) {
+                    updateWellBlocks();
+                }
+            }
 
-                            // add trivial equation for 2p cases (Only support water + oil)
-                            if (np == 2) {
-                                assert(!(*active_)[ Gas ]);
-                                invDuneD_[w][w][flowPhaseToEbosCompIdx(Gas)][flowToEbosPvIdx(Gas)] = 1.0;
-                            }
+            /// Assembles the equations of well w, i.e. its residual and
+            /// diagonal block of D, and its rows of B and C unless
+            /// only_wells is true. The perforation fluxes are stored in
+            /// perfFluxes_ but not added to the reservoir equations.
+            template <typename Simulator>
+            void assembleWellEq(Simulator& ebosSimulator,
+                                const double dt,
+                                const int w,
+                                WellState& well_state,
+                                bool only_wells) {
+                const int np = wells().number_of_phases;
+                const int nw = wells().number_of_wells;
 
-                            // Store the perforation phase flux for later usage.
-                            well_state.perfPhaseRates()[perf*np + p1] = cq_s[p1].value();
-                        }
-                        // Store the perforation pressure for later usage.
-                        well_state.perfPress()[perf] = well_state.bhp()[w] + wellPerforationPressureDiffs()[perf];
-                    }
+                const double volume = 0.002831684659200; // 0.1 cu ft;
+
+                resWell_[w] = 0.0;
+                invDuneD_[w][w] = 0.0;
+
+                bool allow_cf = allow_cross_flow(w, ebosSimulator);
+                for (int perf = wells().well_connpos[w] ; perf < wells().well_connpos[w+1]; ++perf) {
+
+                    const int cell_idx = wells().well_cells[perf];
+                    const auto& intQuants = *(ebosSimulator.model().cachedIntensiveQuantities(cell_idx, /*timeIdx=*/0));
+                    std::vector<EvalWell> cq_s(np,0.0);
+                    computeWellFlux(w, wells().WI[perf], intQuants, wellPerforationPressureDiffs()[perf], allow_cf, cq_s);
 
-                    // add vol * dF/dt + Q to the well equations;
                     for (int p1 = 0; p1 < np; ++p1) {
-                        EvalWell resWell_loc = (wellVolumeFraction(w, p1) - F0_[w + nw*p1]) * volume / dt;
-                        resWell_loc += getQs(w, p1);
+
+                        // keep the flux for the reservoir equation.
+                        perfFluxes_[perf*np + p1] = cq_s[p1];
+
+                        // subtract sum of phase fluxes in the well equations.
+                        resWell_[w][flowPhaseToEbosCompIdx(p1)] -= cq_s[p1].value();
+
+                        // assemble the jacobians
                         for (int p2 = 0; p2 < np; ++p2) {
-                            invDuneD_[w][w][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] += resWell_loc.derivative(p2+blocksize);
+                            if (!only_wells) {
+                                duneB_[w][cell_idx][flowToEbosPvIdx(p2)][flowPhaseToEbosCompIdx(p1)] -= cq_s[p1].derivative(p2+blocksize); // intput in transformed matrix
+                                duneC_[w][cell_idx][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] -= cq_s[p1].derivative(p2);
+                            }
+                            invDuneD_[w][w][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] -= cq_s[p1].derivative(p2+blocksize);
+                        }
+
+                        // add trivial equation for 2p cases (Only support water + oil)
+                        if (np == 2) {
+                            assert(!(*active_)[ Gas ]);
+                            invDuneD_[w][w][flowPhaseToEbosCompIdx(Gas)][flowToEbosPvIdx(Gas)] = 1.0;
                         }
-                        resWell_[w][flowPhaseToEbosCompIdx(p1)] += resWell_loc.value();
+
+                        // Store the perforation phase flux for later usage.
+                        well_state.perfPhaseRates()[perf*np + p1] = cq_s[p1].value();
                     }
+                    // Store the perforation pressure for later usage.
+                    well_state.perfPress()[perf] = well_state.bhp()[w] + wellPerforationPressureDiffs()[perf];
                 }
 
-                // do the local inversion of D.
-                localInvert( invDuneD_ );
-
+                // add vol * dF/dt + Q to the well equations;
+                for (int p1 = 0; p1 < np; ++p1) {
+                    EvalWell resWell_loc = (wellVolumeFraction(w, p1) - F0_[w + nw*p1]) * volume / dt;
+                    resWell_loc += getQs(w, p1);
+                    for (int p2 = 0; p2 < np; ++p2) {
+                        invDuneD_[w][w][flowPhaseToEbosCompIdx(p1)][flowToEbosPvIdx(p2)] += resWell_loc.derivative(p2+blocksize);
+                    }
+                    resWell_[w][flowPhaseToEbosCompIdx(p1)] += resWell_loc.value();
+                }
             }
 
             template <typename Simulator>
@@ -353,32 +422,44 @@ enum WellVariablePositions {
                 if ( ! localWellsActive() ) {
                     return;
                 }
-                assert( Cx_.size() == duneC_.N() );
+                assert( wellBlocks_.numWells() == int(duneC_.N()) );
 
-                BVector& invDCx = invDrw_;
-                assert( invDCx.size() == invDuneD_.N());
-
-                duneC_.mv(x, Cx_);
-                invDuneD_.mv(Cx_, invDCx);
-                duneB_.mmtv(invDCx,Ax);
+                wellBlocks_.usmv(-1.0, x, Ax);
             }
 
-            // apply well model with scaling of alpha
+            // apply well model with scaling of alpha, i.e.
+            // subtract alpha * B*inv(D)*C * x from Ax.
+            // Only the perforated cells of Ax are touched.
             void applyScaleAdd(const Scalar alpha, const BVector& x, BVector& Ax)
             {
                 if ( ! localWellsActive() ) {
                     return;
                 }
+                assert( wellBlocks_.numWells() == int(duneC_.N()) );
+
+                wellBlocks_.usmv(-alpha, x, Ax);
+            }
 
-                if( scaleAddRes_.size() != Ax.size() ) {
-                    scaleAddRes_.resize( Ax.size() );
+            // compute B^T*inv(D)*C * x for the perforated cells only, such that
+            // A*x - B^T*inv(D)*C * x can be applied in a single pass over A,
+            // see fusedWellMatrixProduct.
+            void computeWellContributions(const BVector& x) const
+            {
+                wellContributions_ = 0.0;
+                if ( ! localWellsActive() ) {
+                    return;
                 }
 
-                scaleAddRes_ = 0.0;
-                apply( x, scaleAddRes_ );
-                Ax.axpy( alpha, scaleAddRes_ );
+                wellBlocks_.usmvPerforated(1.0, x, wellContributions_, perforatedCellIndex_);
             }
 
+            // index of every cell into wellContributions(), -1 for cells
+            // without perforations. Empty if no wells are active locally.
+            const std::vector<int>& perforatedCellIndex() const { return perforatedCellIndex_; }
+
+            // result of the last call to computeWellContributions
+            const BVector& wellContributions() const { return wellContributions_; }
+
             // xw = inv(D)*(rw - C*x)
             void recoverVariable(const BVector& x, BVector& xw) const {
                 if ( ! localWellsActive() ) {
@@ -503,14 +584,20 @@ enum WellVariablePositions {
 
             void
             setWellVariables(const WellState& xw) {
+                const int nw = wells().number_of_wells;
+                for (int w = 0; w < nw; ++w) {
+                    setWellVariables(w, xw);
+                }
+            }
+
+            void
+            setWellVariables(const int w, const WellState& xw) {
                 const int np = wells().number_of_phases;
                 const int nw = wells().number_of_wells;
                 for (int phaseIdx = 0; phaseIdx < np; ++phaseIdx) {
-                    for (int w = 0; w < nw; ++w) {
-                        wellVariables_[w + nw*phaseIdx] = 0.0;
-                        wellVariables_[w + nw*phaseIdx].setValue(xw.wellSolutions()[w + nw* phaseIdx]);
-                        wellVariables_[w + nw*phaseIdx].setDerivative(blocksize + phaseIdx, 1.0);
-                    }
+                    wellVariables_[w + nw*phaseIdx] = 0.0;
+                    wellVariables_[w + nw*phaseIdx].setValue(xw.wellSolutions()[w + nw* phaseIdx]);
+                    wellVariables_[w + nw*phaseIdx].setDerivative(blocksize + phaseIdx, 1.0);
                 }
             }
 
@@ -664,46 +751,141 @@ enum WellVariablePositions {
                 }
             }
 
+            /// Solves the well equations for fixed reservoir variables.
+            /// Every well is iterated with its own local Newton method
+            /// until its residual has converged, independently of the
+            /// other wells and in parallel, so only the wells which have
+            /// not converged yet are assembled and updated again. The
+            /// number of iterations of each well is available from
+            /// localWellIterations(), the report holds the largest one.
             template <typename Simulator>
             SimulatorReport solveWellEq(Simulator& ebosSimulator,
                                         const double dt,
                                         WellState& well_state)
             {
+                const int np = wells().number_of_phases;
                 const int nw = wells().number_of_wells;
+                const double tol_wells = param_.tolerance_wells_;
+                const double maxResidualAllowed = param_.max_residual_allowed_;
+                const int max_iter = 15;
                 WellState well_state0 = well_state;
 
-                int it  = 0;
-                bool converged;
-                do {
-                    assembleWellEq(ebosSimulator, dt, well_state, true);
-                    converged = getWellConvergence(ebosSimulator, it);
+                // The scaling of the well residuals only depends on the
+                // reservoir state, which is fixed here.
+                const std::vector<double> B_avg = averageFormationVolumeFactors(ebosSimulator);
+
+                // Logging and exceptions are not allowed inside the
+                // parallel loop, so the control switches and errors of
+                // every well are recorded and reported afterwards.
+                enum { Converged, NotConverged, InvalidResidual, Failed };
+                std::vector<int> status(nw, NotConverged);
+                std::vector<std::vector<std::string>> switch_messages(nw);
+                std::vector<std::exception_ptr> errors(nw);
+                local_well_iterations_.assign(nw, 0);
+                perfFluxes_.resize(wells().well_connpos[nw] * np);
+        #pragma omp parallel for schedule(dynamic)
+                for (int w = 0; w < nw; ++w) {
+                    int it = 0;
+                    try {
+                        do {
+                            assembleWellEq(ebosSimulator, dt, w, well_state, true);
 
-                    if (converged) {
-                        break;
+                            bool converged_well = true;
+                            for (int p = 0; p < np; ++p) {
+                                const double flux_residual = B_avg[p] * std::abs(resWell_[w][flowPhaseToEbosCompIdx(p)]);
+                                if (std::isnan(flux_residual) || flux_residual > maxResidualAllowed) {
+                                    status[w] = InvalidResidual;
+                                }
+                                converged_well = converged_well && (flux_residual < tol_wells);
+                            }
+                            if (status[w] == InvalidResidual) {
+                                break;
+                            }
+                            if (converged_well) {
+                                status[w] = Converged;
+                                break;
+                            }
+
+                            ++it;
+                            invDuneD_[w][w].invert();
+                            VectorBlockType dx_well(0.0);
+                            invDuneD_[w][w].mv(resWell_[w], dx_well);
+
+                            updateWellState(w, dx_well, well_state);
+                            std::string switch_message;
+                            updateWellControl(w, well_state, &switch_message);
+                            if (!switch_message.empty()) {
+                                switch_messages[w].push_back(switch_message);
+                            }
+                            setWellVariables(w, well_state);
+                        } while (it < max_iter);
+                    } catch (...) {
+                        status[w] = Failed;
+                        errors[w] = std::current_exception();
+                    }
+                    local_well_iterations_[w] = it;
+                }
+
+                for (int w = 0; w < nw; ++w) {
+                    for (const std::string& msg : switch_messages[w]) {
+                        OpmLog::info(msg);
                     }
+                }
 
-                    ++it;
-                    if( localWellsActive() )
-                    {
-                        BVector dx_well (nw);
-                        invDuneD_.mv(resWell_, dx_well);
+                for (int w = 0; w < nw; ++w) {
+                    if (status[w] == Failed) {
+                        std::rethrow_exception(errors[w]);
+                    }
+                }
 
-                        updateWellState(dx_well, well_state);
-                        updateWellControls(well_state);
-                        setWellVariables(well_state);
+                // if one of the residuals is NaN or too large, throw exception,
+                // so that the solver can be restarted
+                for (int w = 0; w < nw; ++w) {
+                    if (status[w] == InvalidResidual) {
+                        OPM_THROW(Opm::NumericalProblem, "NaN or too large residual for well " << wells().name[w]);
                     }
-                } while (it < 15);
+                }
+
+                bool converged = true;
+                int max_it = 0;
+                int total_it = 0;
+                for (int w = 0; w < nw; ++w) {
+                    converged = converged && (status[w] == Converged);
+                    max_it = std::max(max_it, local_well_iterations_[w]);
+                    total_it += local_well_iterations_[w];
+                }
 
                 if (!converged) {
                     well_state = well_state0;
                 }
 
+                if ( terminal_output_ )
+                {
+                    std::ostringstream ss;
+                    ss << "    Local well solve: " << total_it << " iterations for " << nw
+                       << " wells, at most " << max_it << " for one well";
+                    for (int w = 0; w < nw; ++w) {
+                        if (status[w] != Converged) {
+                            ss << "\n    Well " << wells().name[w] << " did not converge in "
+                               << local_well_iterations_[w] << " iterations";
+                        }
+                    }
+                    OpmLog::note(ss.str());
+                }
+
                 SimulatorReport report;
                 report.converged = converged;
-                report.total_well_iterations = it;
+                report.total_well_iterations = max_it;
                 return report;
             }
 
+            /// Number of local Newton iterations of each well in the
+            /// last call to solveWellEq().
+            const std::vector<int>& localWellIterations() const
+            {
+                return local_well_iterations_;
+            }
+
             void printIf(int c, double x, double y, double eps, std::string type) {
                 if (std::abs(x-y) > eps) {
                     std::cout << type << " " << c << ": "<<x << " " << y << std::endl;
@@ -711,15 +893,18 @@ enum WellVariablePositions {
             }
 
 
-            std::vector<double> residual() {
+            // residuals of the well equations, ordered by phase, in res,
+            // which only reallocates if it grows
+            void residual(std::vector<double>& res) const {
                 if( ! wellsActive() )
                 {
-                    return std::vector<double>();
+                    res.clear();
+                    return;
                 }
 
                 const int np = numPhases();
                 const int nw = wells().number_of_wells;
-                std::vector<double> res(np*nw);
+                res.resize(np*nw);
                 for( int p=0; p<np; ++p) {
                     const int ebosCompIdx = flowPhaseToEbosCompIdx(p);
                     for (int i = 0; i < nw; ++i) {
@@ -727,93 +912,28 @@ enum WellVariablePositions {
                         res[idx] = resWell_[ i ][ ebosCompIdx ];
                     }
                 }
-                return res;
             }
 
 
+            /// Average formation volume factor of each phase over the
+            /// cells, which scales the well residuals in the convergence
+            /// check.
             template <typename Simulator>
-            bool getWellConvergence(Simulator& ebosSimulator,
-                                    const int iteration)
+            std::vector<double>
+            averageFormationVolumeFactors(const Simulator& ebosSimulator) const
             {
-                typedef std::vector< double > Vector;
                 const int np = numPhases();
                 const int nc = numCells();
-                const double tol_wells = param_.tolerance_wells_;
-                const double maxResidualAllowed = param_.max_residual_allowed_;
-
-                Vector R_sum(np);
-                Vector B_avg(np);
-                Vector maxCoeff(np);
-                Vector maxNormWell(np);
-
-                std::vector< Vector > B( np, Vector( nc ) );
-                std::vector< Vector > R2( np, Vector( nc ) );
-                std::vector< Vector > tempV( np, Vector( nc ) );
-
-                for ( int idx = 0; idx < np; ++idx )
-                {
-                    Vector& B_idx  = B[ idx ];
+                std::vector<double> B_avg(np, 0.0);
+                for (int idx = 0; idx < np; ++idx) {
                     const int ebosPhaseIdx = flowPhaseToEbosPhaseIdx(idx);
-
                     for (int cell_idx = 0; cell_idx < nc; ++cell_idx) {
                         const auto& intQuants = *(ebosSimulator.model().cachedIntensiveQuantities(cell_idx, /*timeIdx=*/0));
-                        const auto& fs = intQuants.fluidState();
-
-                        B_idx [cell_idx] = 1 / fs.invB(ebosPhaseIdx).value();
-                    }
-                }
-
-                detail::convergenceReduction(B, tempV, R2,
-                                             R_sum, maxCoeff, B_avg, maxNormWell,
-                                             nc, np, pv_, residual() );
-
-
-                Vector well_flux_residual(np);
-
-                bool converged_Well = true;
-                // Finish computation
-                for ( int idx = 0; idx < np; ++idx )
-                {
-                    well_flux_residual[idx] = B_avg[idx] * maxNormWell[idx];
-                    converged_Well = converged_Well && (well_flux_residual[idx] < tol_wells);
-                }
-
-                // if one of the residuals is NaN, throw exception, so that the solver can be restarted
-                for (int phaseIdx = 0; phaseIdx < np; ++phaseIdx) {
-                    const auto& phaseName = FluidSystem::phaseName(flowPhaseToEbosPhaseIdx(phaseIdx));
-
-                    if (std::isnan(well_flux_residual[phaseIdx])) {
-                        OPM_THROW(Opm::NumericalProblem, "NaN residual for phase " << phaseName);
-                    }
-                    if (well_flux_residual[phaseIdx] > maxResidualAllowed) {
-                        OPM_THROW(Opm::NumericalProblem, "Too large residual for phase " << phaseName);
-                    }
-                }
-
-                if ( terminal_output_ )
-                {
-                    // Only rank 0 does print to std::cout
-                    if (iteration == 0) {
-                        std::string msg;
-                        msg = "Iter";
-                        for (int phaseIdx = 0; phaseIdx < np; ++phaseIdx) {
-                            const std::string& phaseName = FluidSystem::phaseName(flowPhaseToEbosPhaseIdx(phaseIdx));
-                            msg += "  W-FLUX(" + phaseName + ")";
-                        }
-                        OpmLog::note(msg);
+                        B_avg[idx] += 1 / intQuants.fluidState().invB(ebosPhaseIdx).value();
                     }
-                    std::ostringstream ss;
-                    const std::streamsize oprec = ss.precision(3);
-                    const std::ios::fmtflags oflags = ss.setf(std::ios::scientific);
-                    ss << std::setw(4) << iteration;
-                    for (int phaseIdx = 0; phaseIdx < np; ++phaseIdx) {
-                        ss << std::setw(11) << well_flux_residual[phaseIdx];
-                    }
-                    ss.precision(oprec);
-                    ss.flags(oflags);
-                    OpmLog::note(ss.str());
+                    B_avg[idx] /= nc;
                 }
-                return converged_Well;
+                return B_avg;
             }
 
 
@@ -939,408 +1059,496 @@ enum WellVariablePositions {
             {
                 if( localWellsActive() )
                 {
-                    const int np = wells().number_of_phases;
                     const int nw = wells().number_of_wells;
+                    for (int w = 0; w < nw; ++w) {
+                        updateWellState(w, dwells[w], well_state, false);
+                    }
+                    updateThpControlledProducerBhp(well_state);
+                }
+            }
 
-                    double dFLimit = dWellFractionMax();
-                    double dBHPLimit = dbhpMaxRel();
-                    std::vector<double> xvar_well_old = well_state.wellSolutions();
 
-                    for (int w = 0; w < nw; ++w) {
 
-                        // update the second and third well variable (The flux fractions)
-                        std::vector<double> F(np,0.0);
-                        if ((*active_)[ Water ]) {
-                            const int sign2 = dwells[w][flowPhaseToEbosCompIdx(WFrac)] > 0 ? 1: -1;
-                            const double dx2_limited = sign2 * std::min(std::abs(dwells[w][flowPhaseToEbosCompIdx(WFrac)]),dFLimit);
-                            well_state.wellSolutions()[WFrac*nw + w] = xvar_well_old[WFrac*nw + w] - dx2_limited;
-                        }
+            /// Updates the state of well w with the Newton update dwell.
+            /// If thp_producer_bhp is false, the bhp of a THP controlled
+            /// producer is left to updateThpControlledProducerBhp().
+            template <class WellState>
+            void updateWellState(const int w,
+                                 const VectorBlockType& dwell,
+                                 WellState& well_state,
+                                 const bool thp_producer_bhp = true)
+            {
+                const int np = wells().number_of_phases;
+                const int nw = wells().number_of_wells;
 
+                const double dFLimit = dWellFractionMax();
+                const double dBHPLimit = dbhpMaxRel();
+                std::vector<double> xvar_well_old(np);
+                for (int p = 0; p < np; ++p) {
+                    xvar_well_old[p] = well_state.wellSolutions()[p*nw + w];
+                }
+
+                // update the second and third well variable (The flux fractions)
+                std::vector<double> F(np,0.0);
+                if ((*active_)[ Water ]) {
+                    const int sign2 = dwell[flowPhaseToEbosCompIdx(WFrac)] > 0 ? 1: -1;
+                    const double dx2_limited = sign2 * std::min(std::abs(dwell[flowPhaseToEbosCompIdx(WFrac)]),dFLimit);
+                    well_state.wellSolutions()[WFrac*nw + w] = xvar_well_old[WFrac] - dx2_limited;
+                }
+
+                if ((*active_)[ Gas ]) {
+                    const int sign3 = dwell[flowPhaseToEbosCompIdx(GFrac)] > 0 ? 1: -1;
+                    const double dx3_limited = sign3 * std::min(std::abs(dwell[flowPhaseToEbosCompIdx(GFrac)]),dFLimit);
+                    well_state.wellSolutions()[GFrac*nw + w] = xvar_well_old[GFrac] - dx3_limited;
+                }
+
+                assert((*active_)[ Oil ]);
+                F[Oil] = 1.0;
+                if ((*active_)[ Water ]) {
+                    F[Water] = well_state.wellSolutions()[WFrac*nw + w];
+                    F[Oil] -= F[Water];
+                }
+
+                if ((*active_)[ Gas ]) {
+                    F[Gas] = well_state.wellSolutions()[GFrac*nw + w];
+                    F[Oil] -= F[Gas];
+                }
+
+                if ((*active_)[ Water ]) {
+                    if (F[Water] < 0.0) {
                         if ((*active_)[ Gas ]) {
-                            const int sign3 = dwells[w][flowPhaseToEbosCompIdx(GFrac)] > 0 ? 1: -1;
-                            const double dx3_limited = sign3 * std::min(std::abs(dwells[w][flowPhaseToEbosCompIdx(GFrac)]),dFLimit);
-                            well_state.wellSolutions()[GFrac*nw + w] = xvar_well_old[GFrac*nw + w] - dx3_limited;
+                            F[Gas] /= (1.0 - F[Water]);
                         }
-
-                        assert((*active_)[ Oil ]);
-                        F[Oil] = 1.0;
+                        F[Oil] /= (1.0 - F[Water]);
+                        F[Water] = 0.0;
+                    }
+                }
+                if ((*active_)[ Gas ]) {
+                    if (F[Gas] < 0.0) {
                         if ((*active_)[ Water ]) {
-                            F[Water] = well_state.wellSolutions()[WFrac*nw + w];
-                            F[Oil] -= F[Water];
+                            F[Water] /= (1.0 - F[Gas]);
                         }
+                        F[Oil] /= (1.0 - F[Gas]);
+                        F[Gas] = 0.0;
+                    }
+                }
+                if (F[Oil] < 0.0) {
+                    if ((*active_)[ Water ]) {
+                        F[Water] /= (1.0 - F[Oil]);
+                    }
+                    if ((*active_)[ Gas ]) {
+                        F[Gas] /= (1.0 - F[Oil]);
+                    }
+                    F[Oil] = 0.0;
+                }
 
-                        if ((*active_)[ Gas ]) {
-                            F[Gas] = well_state.wellSolutions()[GFrac*nw + w];
-                            F[Oil] -= F[Gas];
+                if ((*active_)[ Water ]) {
+                    well_state.wellSolutions()[WFrac*nw + w] = F[Water];
+                }
+                if ((*active_)[ Gas ]) {
+                    well_state.wellSolutions()[GFrac*nw + w] = F[Gas];
+                }
+
+                // The interpretation of the first well variable depends on the well control
+                const WellControls* wc = wells().ctrls[w];
+
+                // The current control in the well state overrides
+                // the current control set in the Wells struct, which
+                // is instead treated as a default.
+                const int current = well_state.currentControls()[w];
+                const double target_rate = well_controls_iget_target(wc, current);
+
+                std::vector<double> g = {1,1,0.01};
+                if (well_controls_iget_type(wc, current) == RESERVOIR_RATE) {
+                    const double* distr = well_controls_iget_distr(wc, current);
+                    for (int p = 0; p < np; ++p) {
+                        F[p] /= distr[p];
+                    }
+                } else {
+                    for (int p = 0; p < np; ++p) {
+                        F[p] /= g[p];
+                    }
+                }
+
+                switch (well_controls_iget_type(wc, current)) {
+                case THP: // The BHP and THP both uses the total rate as first well variable.
+                case BHP:
+                {
+                    well_state.wellSolutions()[nw*XvarWell + w] = xvar_well_old[XvarWell] - dwell[flowPhaseToEbosCompIdx(XvarWell)];
+
+                    switch (wells().type[w]) {
+                    case INJECTOR:
+                        for (int p = 0; p < np; ++p) {
+                            const double comp_frac = wells().comp_frac[np*w + p];
+                            well_state.wellRates()[w*np + p] = comp_frac * well_state.wellSolutions()[nw*XvarWell + w];
                         }
+                        break;
+                    case PRODUCER:
+                        for (int p = 0; p < np; ++p) {
+                            well_state.wellRates()[w*np + p] = well_state.wellSolutions()[nw*XvarWell + w] * F[p];
+                        }
+                        break;
+                    }
+
+                    if (well_controls_iget_type(wc, current) == THP) {
+
+                        // Calculate bhp from thp control and well rates
+                        double aqua = 0.0;
+                        double liquid = 0.0;
+                        double vapour = 0.0;
+
+                        const Opm::PhaseUsage& pu = fluid_->phaseUsage();
 
                         if ((*active_)[ Water ]) {
-                            if (F[Water] < 0.0) {
-                                if ((*active_)[ Gas ]) {
-                                    F[Gas] /= (1.0 - F[Water]);
-                                }
-                                F[Oil] /= (1.0 - F[Water]);
-                                F[Water] = 0.0;
-                            }
+                            aqua = well_state.wellRates()[w*np + pu.phase_pos[ Water ] ];
+                        }
+                        if ((*active_)[ Oil ]) {
+                            liquid = well_state.wellRates()[w*np + pu.phase_pos[ Oil ] ];
                         }
                         if ((*active_)[ Gas ]) {
-                            if (F[Gas] < 0.0) {
-                                if ((*active_)[ Water ]) {
-                                    F[Water] /= (1.0 - F[Gas]);
-                                }
-                                F[Oil] /= (1.0 - F[Gas]);
-                                F[Gas] = 0.0;
-                            }
+                            vapour = well_state.wellRates()[w*np + pu.phase_pos[ Gas ] ];
                         }
-                        if (F[Oil] < 0.0) {
-                            if ((*active_)[ Water ]) {
-                                F[Water] /= (1.0 - F[Oil]);
-                            }
-                            if ((*active_)[ Gas ]) {
-                                F[Gas] /= (1.0 - F[Oil]);
-                            }
-                            F[Oil] = 0.0;
+
+                        const int vfp        = well_controls_iget_vfp(wc, current);
+                        const double& thp    = well_controls_iget_target(wc, current);
+                        const double& alq    = well_controls_iget_alq(wc, current);
+
+                        //Set *BHP* target by calculating bhp from THP
+                        const WellType& well_type = wells().type[w];
+                        // pick the density in the top layer
+                        const int perf = wells().well_connpos[w];
+                        const double rho = well_perforation_densities_[perf];
+
+                        if (well_type == INJECTOR) {
+                            double dp = wellhelpers::computeHydrostaticCorrection(
+                                        wells(), w, vfp_properties_->getInj()->getTable(vfp)->getDatumDepth(),
+                                        rho, gravity_);
+
+                            well_state.bhp()[w] = vfp_properties_->getInj()->bhp(vfp, aqua, liquid, vapour, thp) - dp;
                         }
+                        else if (well_type == PRODUCER) {
+                            if (thp_producer_bhp) {
+                                double dp = wellhelpers::computeHydrostaticCorrection(
+                                            wells(), w, vfp_properties_->getProd()->getTable(vfp)->getDatumDepth(),
+                                            rho, gravity_);
 
-                        if ((*active_)[ Water ]) {
-                            well_state.wellSolutions()[WFrac*nw + w] = F[Water];
+                                well_state.bhp()[w] = vfp_properties_->getProd()->bhp(vfp, aqua, liquid, vapour, thp, alq, vfpHints_[w]) - dp;
+                            }
                         }
-                        if ((*active_)[ Gas ]) {
-                            well_state.wellSolutions()[GFrac*nw + w] = F[Gas];
+                        else {
+                            OPM_THROW(std::logic_error, "Expected INJECTOR or PRODUCER well");
                         }
+                    }
 
-                        // The interpretation of the first well variable depends on the well control
-                        const WellControls* wc = wells().ctrls[w];
+                }
+                    break;
+                case SURFACE_RATE: // Both rate controls use bhp as first well variable
+                case RESERVOIR_RATE:
+                {
+                    const int sign1 = dwell[flowPhaseToEbosCompIdx(XvarWell)] > 0 ? 1: -1;
+                    const double dx1_limited = sign1 * std::min(std::abs(dwell[flowPhaseToEbosCompIdx(XvarWell)]),std::abs(xvar_well_old[XvarWell])*dBHPLimit);
+                    well_state.wellSolutions()[nw*XvarWell + w] = std::max(xvar_well_old[XvarWell] - dx1_limited,1e5);
+                    well_state.bhp()[w] = well_state.wellSolutions()[nw*XvarWell + w];
 
-                        // The current control in the well state overrides
-                        // the current control set in the Wells struct, which
-                        // is instead treated as a default.
-                        const int current = well_state.currentControls()[w];
-                        const double target_rate = well_controls_iget_target(wc, current);
+                    if (well_controls_iget_type(wc, current) == SURFACE_RATE) {
+                        if (wells().type[w]==PRODUCER) {
 
-                        std::vector<double> g = {1,1,0.01};
-                        if (well_controls_iget_type(wc, current) == RESERVOIR_RATE) {
-                            const double* distr = well_controls_iget_distr(wc, current);
+                            double F_target = 0.0;
                             for (int p = 0; p < np; ++p) {
-                                F[p] /= distr[p];
+                                F_target += wells().comp_frac[np*w + p] * F[p];
+                            }
+                            for (int p = 0; p < np; ++p) {
+                                well_state.wellRates()[np*w + p] = F[p] * target_rate /F_target;
                             }
                         } else {
+
                             for (int p = 0; p < np; ++p) {
-                                F[p] /= g[p];
+                                well_state.wellRates()[w*np + p] = wells().comp_frac[np*w + p] * target_rate;
                             }
                         }
+                    } else { // RESERVOIR_RATE
+                        for (int p = 0; p < np; ++p) {
+                            well_state.wellRates()[np*w + p] = F[p] * target_rate;
+                        }
+                    }
+                }
+                    break;
+                }
+            }
 
-                        switch (well_controls_iget_type(wc, current)) {
-                        case THP: // The BHP and THP both uses the total rate as first well variable.
-                        case BHP:
-                        {
-                            well_state.wellSolutions()[nw*XvarWell + w] = xvar_well_old[nw*XvarWell + w] - dwells[w][flowPhaseToEbosCompIdx(XvarWell)];
-
-                            switch (wells().type[w]) {
-                            case INJECTOR:
-                                for (int p = 0; p < np; ++p) {
-                                    const double comp_frac = wells().comp_frac[np*w + p];
-                                    well_state.wellRates()[w*np + p] = comp_frac * well_state.wellSolutions()[nw*XvarWell + w];
-                                }
-                                break;
-                            case PRODUCER:
-                                for (int p = 0; p < np; ++p) {
-                                    well_state.wellRates()[w*np + p] = well_state.wellSolutions()[nw*XvarWell + w] * F[p];
-                                }
-                                break;
-                            }
 
-                            if (well_controls_iget_type(wc, current) == THP) {
 
-                                // Calculate bhp from thp control and well rates
-                                double aqua = 0.0;
-                                double liquid = 0.0;
-                                double vapour = 0.0;
+            /// Sets the bhp of all producers under THP control from their
+            /// rates, with one lookup in the VFP tables for all of them.
+            template <class WellState>
+            void updateThpControlledProducerBhp(WellState& well_state)
+            {
+                const int np = wells().number_of_phases;
+                const int nw = wells().number_of_wells;
+                const Opm::PhaseUsage& pu = fluid_->phaseUsage();
 
-                                const Opm::PhaseUsage& pu = fluid_->phaseUsage();
+                std::vector<int> thp_wells;
+                std::vector<int> table_id;
+                std::vector<double> aqua, liquid, vapour, thp, alq;
+                std::vector<VFPProdProperties::InterpHint> hints;
+                for (int w = 0; w < nw; ++w) {
+                    const WellControls* wc = wells().ctrls[w];
+                    const int current = well_state.currentControls()[w];
+                    if (wells().type[w] != PRODUCER || well_controls_iget_type(wc, current) != THP) {
+                        continue;
+                    }
+                    thp_wells.push_back(w);
+                    table_id.push_back(well_controls_iget_vfp(wc, current));
+                    aqua.push_back((*active_)[ Water ] ? well_state.wellRates()[w*np + pu.phase_pos[ Water ] ] : 0.0);
+                    liquid.push_back((*active_)[ Oil ] ? well_state.wellRates()[w*np + pu.phase_pos[ Oil ] ] : 0.0);
+                    vapour.push_back((*active_)[ Gas ] ? well_state.wellRates()[w*np + pu.phase_pos[ Gas ] ] : 0.0);
+                    thp.push_back(well_controls_iget_target(wc, current));
+                    alq.push_back(well_controls_iget_alq(wc, current));
+                    hints.push_back(vfpHints_[w]);
+                }
 
-                                if ((*active_)[ Water ]) {
-                                    aqua = well_state.wellRates()[w*np + pu.phase_pos[ Water ] ];
-                                }
-                                if ((*active_)[ Oil ]) {
-                                    liquid = well_state.wellRates()[w*np + pu.phase_pos[ Oil ] ];
-                                }
-                                if ((*active_)[ Gas ]) {
-                                    vapour = well_state.wellRates()[w*np + pu.phase_pos[ Gas ] ];
-                                }
+                if (thp_wells.empty()) {
+                    return;
+                }
 
-                                const int vfp        = well_controls_iget_vfp(wc, current);
-                                const double& thp    = well_controls_iget_target(wc, current);
-                                const double& alq    = well_controls_iget_alq(wc, current);
+                const std::vector<double> bhp = vfp_properties_->getProd()->bhp(table_id, aqua, liquid, vapour, thp, alq, hints);
 
-                                //Set *BHP* target by calculating bhp from THP
-                                const WellType& well_type = wells().type[w];
-                                // pick the density in the top layer
-                                const int perf = wells().well_connpos[w];
-                                const double rho = well_perforation_densities_[perf];
+                for (std::size_t i = 0; i < thp_wells.size(); ++i) {
+                    const int w = thp_wells[i];
+                    // pick the density in the top layer
+                    const int perf = wells().well_connpos[w];
+                    const double rho = well_perforation_densities_[perf];
+                    const double dp = wellhelpers::computeHydrostaticCorrection(
+                                      wells(), w, vfp_properties_->getProd()->getTable(table_id[i])->getDatumDepth(),
+                                      rho, gravity_);
 
-                                if (well_type == INJECTOR) {
-                                    double dp = wellhelpers::computeHydrostaticCorrection(
-                                                wells(), w, vfp_properties_->getInj()->getTable(vfp)->getDatumDepth(),
-                                                rho, gravity_);
+                    well_state.bhp()[w] = bhp[i] - dp;
+                    vfpHints_[w] = hints[i];
+                }
+            }
 
-                                    well_state.bhp()[w] = vfp_properties_->getInj()->bhp(vfp, aqua, liquid, vapour, thp) - dp;
-                                }
-                                else if (well_type == PRODUCER) {
-                                    double dp = wellhelpers::computeHydrostaticCorrection(
-                                                wells(), w, vfp_properties_->getProd()->getTable(vfp)->getDatumDepth(),
-                                                rho, gravity_);
 
-                                    well_state.bhp()[w] = vfp_properties_->getProd()->bhp(vfp, aqua, liquid, vapour, thp, alq) - dp;
-                                }
-                                else {
-                                    OPM_THROW(std::logic_error, "Expected INJECTOR or PRODUCER well");
-                                }
-                            }
 
-                        }
-                            break;
-                        case SURFACE_RATE: // Both rate controls use bhp as first well variable
-                        case RESERVOIR_RATE:
-                        {
-                            const int sign1 = dwells[w][flowPhaseToEbosCompIdx(XvarWell)] > 0 ? 1: -1;
-                            const double dx1_limited = sign1 * std::min(std::abs(dwells[w][flowPhaseToEbosCompIdx(XvarWell)]),std::abs(xvar_well_old[nw*XvarWell + w])*dBHPLimit);
-                            well_state.wellSolutions()[nw*XvarWell + w] = std::max(xvar_well_old[nw*XvarWell + w] - dx1_limited,1e5);
-                            well_state.bhp()[w] = well_state.wellSolutions()[nw*XvarWell + w];
-
-                            if (well_controls_iget_type(wc, current) == SURFACE_RATE) {
-                                if (wells().type[w]==PRODUCER) {
-
-                                    double F_target = 0.0;
-                                    for (int p = 0; p < np; ++p) {
-                                        F_target += wells().comp_frac[np*w + p] * F[p];
-                                    }
-                                    for (int p = 0; p < np; ++p) {
-                                        well_state.wellRates()[np*w + p] = F[p] * target_rate /F_target;
-                                    }
-                                } else {
+            template <class WellState>
+            void updateWellControls(WellState& xw)
+            {
+                if( !localWellsActive() ) return ;
 
-                                    for (int p = 0; p < np; ++p) {
-                                        well_state.wellRates()[w*np + p] = wells().comp_frac[np*w + p] * target_rate;
-                                    }
-                                }
-                            } else { // RESERVOIR_RATE
-                                for (int p = 0; p < np; ++p) {
-                                    well_state.wellRates()[np*w + p] = F[p] * target_rate;
-                                }
-                            }
-                        }
-                            break;
-                        }
-                    }
+                const int nw = wells().number_of_wells;
+                for (int w = 0; w < nw; ++w) {
+                    updateWellControl(w, xw);
                 }
             }
 
 
 
+            /// Switches the control of well w to the first broken
+            /// constraint. The switch is logged, or stored in
+            /// switch_message if given, such that it can be called for
+            /// several wells in parallel.
             template <class WellState>
-            void updateWellControls(WellState& xw)
+            void updateWellControl(const int w, WellState& xw,
+                                   std::string* switch_message = nullptr)
             {
-                if( !localWellsActive() ) return ;
-
-                std::string modestring[4] = { "BHP", "THP", "RESERVOIR_RATE", "SURFACE_RATE" };
-                // Find, for each well, if any constraints are broken. If so,
+                const char* const modestring[4] = { "BHP", "THP", "RESERVOIR_RATE", "SURFACE_RATE" };
+                // Find if any constraints are broken. If so,
                 // switch control to first broken constraint.
                 const int np = wells().number_of_phases;
                 const int nw = wells().number_of_wells;
-        #pragma omp parallel for schedule(dynamic)
-                for (int w = 0; w < nw; ++w) {
-                    WellControls* wc = wells().ctrls[w];
-                    // The current control in the well state overrides
-                    // the current control set in the Wells struct, which
-                    // is instead treated as a default.
-                    int current = xw.currentControls()[w];
-                    // Loop over all controls except the current one, and also
-                    // skip any RESERVOIR_RATE controls, since we cannot
-                    // handle those.
-                    const int nwc = well_controls_get_num(wc);
-                    int ctrl_index = 0;
-                    for (; ctrl_index < nwc; ++ctrl_index) {
-                        if (ctrl_index == current) {
-                            // This is the currently used control, so it is
-                            // used as an equation. So this is not used as an
-                            // inequality constraint, and therefore skipped.
-                            continue;
-                        }
-                        if (wellhelpers::constraintBroken(
-                                xw.bhp(), xw.thp(), xw.wellRates(),
-                                w, np, wells().type[w], wc, ctrl_index)) {
-                            // ctrl_index will be the index of the broken constraint after the loop.
-                            break;
-                        }
+                WellControls* wc = wells().ctrls[w];
+                // The current control in the well state overrides
+                // the current control set in the Wells struct, which
+                // is instead treated as a default.
+                int current = xw.currentControls()[w];
+                // Loop over all controls except the current one, and also
+                // skip any RESERVOIR_RATE controls, since we cannot
+                // handle those.
+                const int nwc = well_controls_get_num(wc);
+                int ctrl_index = 0;
+                for (; ctrl_index < nwc; ++ctrl_index) {
+                    if (ctrl_index == current) {
+                        // This is the currently used control, so it is
+                        // used as an equation. So this is not used as an
+                        // inequality constraint, and therefore skipped.
+                        continue;
+                    }
+                    if (wellhelpers::constraintBroken(
+                            xw.bhp(), xw.thp(), xw.wellRates(),
+                            w, np, wells().type[w], wc, ctrl_index)) {
+                        // ctrl_index will be the index of the broken constraint after the loop.
+                        break;
                     }
-                    if (ctrl_index != nwc) {
-                        // Constraint number ctrl_index was broken, switch to it.
-                        // We disregard terminal_ouput here as with it only messages
-                        // for wells on one process will be printed.
-                        std::ostringstream ss;
-                        ss << "    Switching control mode for well " << wells().name[w]
-                           << " from " << modestring[well_controls_iget_type(wc, current)]
-                           << " to " << modestring[well_controls_iget_type(wc, ctrl_index)];
+                }
+                if (ctrl_index != nwc) {
+                    // Constraint number ctrl_index was broken, switch to it.
+                    // We disregard terminal_ouput here as with it only messages
+                    // for wells on one process will be printed.
+                    std::ostringstream ss;
+                    ss << "    Switching control mode for well " << wells().name[w]
+                       << " from " << modestring[well_controls_iget_type(wc, current)]
+                       << " to " << modestring[well_controls_iget_type(wc, ctrl_index)];
+                    if (switch_message) {
+                        *switch_message = ss.str();
+                    } else {
                         OpmLog::info(ss.str());
-                        xw.currentControls()[w] = ctrl_index;
-                        current = xw.currentControls()[w];
-                        well_controls_set_current( wc, current);
+                    }
+                    xw.currentControls()[w] = ctrl_index;
+                    current = xw.currentControls()[w];
+                    well_controls_set_current( wc, current);
 
 
 
-                        // Updating well state and primary variables if constraint is broken
+                    // Updating well state and primary variables if constraint is broken
 
-                        // Target values are used as initial conditions for BHP, THP, and SURFACE_RATE
-                        const double target = well_controls_iget_target(wc, current);
-                        const double* distr = well_controls_iget_distr(wc, current);
-                        switch (well_controls_iget_type(wc, current)) {
-                        case BHP:
-                            xw.bhp()[w] = target;
-                            break;
+                    // Target values are used as initial conditions for BHP, THP, and SURFACE_RATE
+                    const double target = well_controls_iget_target(wc, current);
+                    const double* distr = well_controls_iget_distr(wc, current);
+                    switch (well_controls_iget_type(wc, current)) {
+                    case BHP:
+                        xw.bhp()[w] = target;
+                        break;
 
-                        case THP: {
-                            double aqua = 0.0;
-                            double liquid = 0.0;
-                            double vapour = 0.0;
+                    case THP: {
+                        double aqua = 0.0;
+                        double liquid = 0.0;
+                        double vapour = 0.0;
 
-                            const Opm::PhaseUsage& pu = fluid_->phaseUsage();
+                        const Opm::PhaseUsage& pu = fluid_->phaseUsage();
 
-                            if ((*active_)[ Water ]) {
-                                aqua = xw.wellRates()[w*np + pu.phase_pos[ Water ] ];
-                            }
-                            if ((*active_)[ Oil ]) {
-                                liquid = xw.wellRates()[w*np + pu.phase_pos[ Oil ] ];
-                            }
-                            if ((*active_)[ Gas ]) {
-                                vapour = xw.wellRates()[w*np + pu.phase_pos[ Gas ] ];
-                            }
+                        if ((*active_)[ Water ]) {
+                            aqua = xw.wellRates()[w*np + pu.phase_pos[ Water ] ];
+                        }
+                        if ((*active_)[ Oil ]) {
+                            liquid = xw.wellRates()[w*np + pu.phase_pos[ Oil ] ];
+                        }
+                        if ((*active_)[ Gas ]) {
+                            vapour = xw.wellRates()[w*np + pu.phase_pos[ Gas ] ];
+                        }
 
-                            const int vfp        = well_controls_iget_vfp(wc, current);
-                            const double& thp    = well_controls_iget_target(wc, current);
-                            const double& alq    = well_controls_iget_alq(wc, current);
+                        const int vfp        = well_controls_iget_vfp(wc, current);
+                        const double& thp    = well_controls_iget_target(wc, current);
+                        const double& alq    = well_controls_iget_alq(wc, current);
 
-                            //Set *BHP* target by calculating bhp from THP
-                            const WellType& well_type = wells().type[w];
+                        //Set *BHP* target by calculating bhp from THP
+                        const WellType& well_type = wells().type[w];
 
-                            // pick the density in the top layer
-                            const int perf = wells().well_connpos[w];
-                            const double rho = well_perforation_densities_[perf];
+                        // pick the density in the top layer
+                        const int perf = wells().well_connpos[w];
+                        const double rho = well_perforation_densities_[perf];
 
-                            if (well_type == INJECTOR) {
-                                double dp = wellhelpers::computeHydrostaticCorrection(
-                                            wells(), w, vfp_properties_->getInj()->getTable(vfp)->getDatumDepth(),
-                                            rho, gravity_);
+                        if (well_type == INJECTOR) {
+                            double dp = wellhelpers::computeHydrostaticCorrection(
+                                        wells(), w, vfp_properties_->getInj()->getTable(vfp)->getDatumDepth(),
+                                        rho, gravity_);
 
-                                xw.bhp()[w] = vfp_properties_->getInj()->bhp(vfp, aqua, liquid, vapour, thp) - dp;
-                            }
-                            else if (well_type == PRODUCER) {
-                                double dp = wellhelpers::computeHydrostaticCorrection(
-                                            wells(), w, vfp_properties_->getProd()->getTable(vfp)->getDatumDepth(),
-                                            rho, gravity_);
+                            xw.bhp()[w] = vfp_properties_->getInj()->bhp(vfp, aqua, liquid, vapour, thp) - dp;
+                        }
+                        else if (well_type == PRODUCER) {
+                            double dp = wellhelpers::computeHydrostaticCorrection(
+                                        wells(), w, vfp_properties_->getProd()->getTable(vfp)->getDatumDepth(),
+                                        rho, gravity_);
 
-                                xw.bhp()[w] = vfp_properties_->getProd()->bhp(vfp, aqua, liquid, vapour, thp, alq) - dp;
-                            }
-                            else {
-                                OPM_THROW(std::logic_error, "Expected PRODUCER or INJECTOR type of well");
-                            }
-                            break;
+                            xw.bhp()[w] = vfp_properties_->getProd()->bhp(vfp, aqua, liquid, vapour, thp, alq, vfpHints_[w]) - dp;
+                        }
+                        else {
+                            OPM_THROW(std::logic_error, "Expected PRODUCER or INJECTOR type of well");
                         }
+                        break;
+                    }
 
-                        case RESERVOIR_RATE:
-                            // No direct change to any observable quantity at
-                            // surface condition.  In this case, use existing
-                            // flow rates as initial conditions as reservoir
-                            // rate acts only in aggregate.
-                            break;
-
-                        case SURFACE_RATE:
-                            // assign target value as initial guess for injectors and
-                            // single phase producers (orat, grat, wrat)
-                            const WellType& well_type = wells().type[w];
-                            if (well_type == INJECTOR) {
-                                for (int phase = 0; phase < np; ++phase) {
-                                    const double& compi = wells().comp_frac[np * w + phase];
-                                    //if (compi > 0.0) {
-                                        xw.wellRates()[np*w + phase] = target * compi;
-                                    //}
-                                }
-                            } else if (well_type == PRODUCER) {
-
-                                // only set target as initial rates for single phase
-                                // producers. (orat, grat and wrat, and not lrat)
-                                // lrat will result in numPhasesWithTargetsUnderThisControl == 2
-                                int numPhasesWithTargetsUnderThisControl = 0;
-                                for (int phase = 0; phase < np; ++phase) {
-                                    if (distr[phase] > 0.0) {
-                                        numPhasesWithTargetsUnderThisControl += 1;
-                                    }
+                    case RESERVOIR_RATE:
+                        // No direct change to any observable quantity at
+                        // surface condition.  In this case, use existing
+                        // flow rates as initial conditions as reservoir
+                        // rate acts only in aggregate.
+                        break;
+
+                    case SURFACE_RATE:
+                        // assign target value as initial guess for injectors and
+                        // single phase producers (orat, grat, wrat)
+                        const WellType& well_type = wells().type[w];
+                        if (well_type == INJECTOR) {
+                            for (int phase = 0; phase < np; ++phase) {
+                                const double& compi = wells().comp_frac[np * w + phase];
+                                //if (compi > 0.0) {
+                                    xw.wellRates()[np*w + phase] = target * compi;
+                                //}
+                            }
+                        } else if (well_type == PRODUCER) {
+
+                            // only set target as initial rates for single phase
+                            // producers. (orat, grat and wrat, and not lrat)
+                            // lrat will result in numPhasesWithTargetsUnderThisControl == 2
+                            int numPhasesWithTargetsUnderThisControl = 0;
+                            for (int phase = 0; phase < np; ++phase) {
+                                if (distr[phase] > 0.0) {
+                                    numPhasesWithTargetsUnderThisControl += 1;
                                 }
-                                for (int phase = 0; phase < np; ++phase) {
-                                    if (distr[phase] > 0.0 && numPhasesWithTargetsUnderThisControl < 2 ) {
-                                        xw.wellRates()[np*w + phase] = target * distr[phase];
-                                    }
+                            }
+                            for (int phase = 0; phase < np; ++phase) {
+                                if (distr[phase] > 0.0 && numPhasesWithTargetsUnderThisControl < 2 ) {
+                                    xw.wellRates()[np*w + phase] = target * distr[phase];
                                 }
-                            } else {
-                                OPM_THROW(std::logic_error, "Expected PRODUCER or INJECTOR type of well");
                             }
+                        } else {
+                            OPM_THROW(std::logic_error, "Expected PRODUCER or INJECTOR type of well");
+                        }
 
 
-                            break;
+                        break;
+                    }
+                    std::vector<double> g = {1,1,0.01};
+                    if (well_controls_iget_type(wc, current) == RESERVOIR_RATE) {
+                        const double* distr = well_controls_iget_distr(wc, current);
+                        for (int phase = 0; phase < np; ++phase) {
+                            g[phase] = distr[phase];
                         }
-                        std::vector<double> g = {1,1,0.01};
-                        if (well_controls_iget_type(wc, current) == RESERVOIR_RATE) {
-                            const double* distr = well_controls_iget_distr(wc, current);
-                            for (int phase = 0; phase < np; ++phase) {
-                                g[phase] = distr[phase];
+                    }
+                    switch (well_controls_iget_type(wc, current)) {
+                    case THP:
+                    case BHP:
+                    {
+                        const WellType& well_type = wells().type[w];
+                        xw.wellSolutions()[nw*XvarWell + w] = 0.0;
+                        if (well_type == INJECTOR) {
+                            for (int p = 0; p < np; ++p)  {
+                                xw.wellSolutions()[nw*XvarWell + w] += xw.wellRates()[np*w + p] * wells().comp_frac[np*w + p];
                             }
-                        }
-                        switch (well_controls_iget_type(wc, current)) {
-                        case THP:
-                        case BHP:
-                        {
-                            const WellType& well_type = wells().type[w];
-                            xw.wellSolutions()[nw*XvarWell + w] = 0.0;
-                            if (well_type == INJECTOR) {
-                                for (int p = 0; p < np; ++p)  {
-                                    xw.wellSolutions()[nw*XvarWell + w] += xw.wellRates()[np*w + p] * wells().comp_frac[np*w + p];
-                                }
-                            } else {
-                                for (int p = 0; p < np; ++p)  {
-                                    xw.wellSolutions()[nw*XvarWell + w] += g[p] * xw.wellRates()[np*w + p];
-                                }
+                        } else {
+                            for (int p = 0; p < np; ++p)  {
+                                xw.wellSolutions()[nw*XvarWell + w] += g[p] * xw.wellRates()[np*w + p];
                             }
                         }
-                            break;
+                    }
+                        break;
 
 
-                        case RESERVOIR_RATE: // Intentional fall-through
-                        case SURFACE_RATE:
-                        {
-                            xw.wellSolutions()[nw*XvarWell + w] = xw.bhp()[w];
+                    case RESERVOIR_RATE: // Intentional fall-through
+                    case SURFACE_RATE:
+                    {
+                        xw.wellSolutions()[nw*XvarWell + w] = xw.bhp()[w];
+                    }
+                        break;
+                    }
+
+                    double tot_well_rate = 0.0;
+                    for (int p = 0; p < np; ++p)  {
+                        tot_well_rate += g[p] * xw.wellRates()[np*w + p];
+                    }
+                    if(std::abs(tot_well_rate) > 0) {
+                        if ((*active_)[ Water ]) {
+                            xw.wellSolutions()[WFrac*nw + w] = g[Water] * xw.wellRates()[np*w + Water] / tot_well_rate;
                         }
-                            break;
+                        if ((*active_)[ Gas ]) {
+                            xw.wellSolutions()[GFrac*nw + w] = g[Gas] * xw.wellRates()[np*w + Gas] / tot_well_rate ;
                         }
-
-                        double tot_well_rate = 0.0;
-                        for (int p = 0; p < np; ++p)  {
-                            tot_well_rate += g[p] * xw.wellRates()[np*w + p];
+                    } else {
+                        if ((*active_)[ Water ]) {
+                            xw.wellSolutions()[WFrac*nw + w] =  wells().comp_frac[np*w + Water];
                         }
-                        if(std::abs(tot_well_rate) > 0) {
-                            if ((*active_)[ Water ]) {
-                                xw.wellSolutions()[WFrac*nw + w] = g[Water] * xw.wellRates()[np*w + Water] / tot_well_rate;
-                            }
-                            if ((*active_)[ Gas ]) {
-                                xw.wellSolutions()[GFrac*nw + w] = g[Gas] * xw.wellRates()[np*w + Gas] / tot_well_rate ;
-                            }
-                        } else {
-                            if ((*active_)[ Water ]) {
-                                xw.wellSolutions()[WFrac*nw + w] =  wells().comp_frac[np*w + Water];
-                            }
 
-                            if ((*active_)[ Gas ]) {
-                                xw.wellSolutions()[GFrac*nw + w] =  wells().comp_frac[np*w + Gas];
-                            }
+                        if ((*active_)[ Gas ]) {
+                            xw.wellSolutions()[GFrac*nw + w] =  wells().comp_frac[np*w + Gas];
                         }
                     }
                 }
@@ -1480,6 +1688,13 @@ enum WellVariablePositions {
             }
 
         protected:
+            // copy B, C and inv(D) to the dense blocks used by apply,
+            // applyScaleAdd and computeWellContributions
+            void updateWellBlocks()
+            {
+                wellBlocks_.assign(duneB_, duneC_, invDuneD_);
+            }
+
             bool wells_active_;
             const Wells*   wells_;
             ModelParameters param_;
@@ -1506,9 +1721,23 @@ enum WellVariablePositions {
 
             BVector resWell_;
 
-            mutable BVector Cx_;
             mutable BVector invDrw_;
-            mutable BVector scaleAddRes_;
+
+            std::vector<int> perforatedCellIndex_;
+            mutable BVector wellContributions_;
+
+            // VFP table lookup hint of each well, see VFPProdProperties::InterpHint
+            mutable std::vector<VFPProdProperties::InterpHint> vfpHints_;
+
+            // dense copy of duneB_, duneC_ and invDuneD_ used by the
+            // products with B^T*inv(D)*C in the linear solver
+            WellBlockMatrix<Scalar, blocksize> wellBlocks_;
+
+            // phase fluxes of each perforation, see assembleWellEq
+            std::vector<EvalWell> perfFluxes_;
+
+            // local Newton iterations of each well, see solveWellEq
+            std::vector<int> local_well_iterations_;
 
             double dbhpMaxRel() const {return param_.dbhp_max_rel_; }
             double dWellFractionMax() const {return param_.dwell_fraction_max_; }
@@ -1547,7 +1776,7 @@ enum WellVariablePositions {
                         bhp = vfp_properties_->getInj()->bhp(table_id, aqua, liquid, vapour, thp);
                         vfp_ref_depth = vfp_properties_->getInj()->getTable(table_id)->getDatumDepth();
                     } else {
-                        bhp = vfp_properties_->getProd()->bhp(table_id, aqua, liquid, vapour, thp, alq);
+                        bhp = vfp_properties_->getProd()->bhp(table_id, aqua, liquid, vapour, thp, alq, vfpHints_[wellIdx]);
                         vfp_ref_depth = vfp_properties_->getProd()->getTable(table_id)->getDatumDepth();
                     }
 
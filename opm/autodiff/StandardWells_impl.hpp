@@ -64,6 +64,7 @@ namespace Opm
             p2w.setFromTriplets(gather .begin(), gather .end());
 
             well_cells.assign(wells->well_cells, wells->well_cells + wells->well_connpos[wells->number_of_wells]);
+            well_cell_selection = IndexSelection(well_cells);
         }
     }
 
@@ -244,9 +245,10 @@ namespace Opm
         }
 
         const std::vector<int>& well_cells = wellOps().well_cells;
+        const IndexSelection& well_cell_selection = wellOps().well_cell_selection;
 
         // Use cell values for the temperature as the wells don't knows its temperature yet.
-        const ADB perf_temp = subset(state.temperature, well_cells);
+        const ADB perf_temp = subset(state.temperature, well_cell_selection);
 
         // Compute b, rsmax, rvmax values for perforations.
         // Evaluate the properties using average well block pressures
@@ -264,14 +266,14 @@ namespace Opm
             b.col(pu.phase_pos[BlackoilPhases::Aqua]) = bw;
         }
         assert((*active_)[Oil]);
-        const Vector perf_so =  subset(state.saturation[pu.phase_pos[Oil]].value(), well_cells);
+        const Vector perf_so =  subset(state.saturation[pu.phase_pos[Oil]].value(), well_cell_selection);
         if (pu.phase_used[BlackoilPhases::Liquid]) {
-            const ADB perf_rs = (state.rs.size() > 0) ? subset(state.rs, well_cells) : ADB::null();
+            const ADB perf_rs = (state.rs.size() > 0) ? subset(state.rs, well_cell_selection) : ADB::null();
             const Vector bo = fluid_->bOil(avg_press_ad, perf_temp, perf_rs, perf_cond, well_cells).value();
             b.col(pu.phase_pos[BlackoilPhases::Liquid]) = bo;
         }
         if (pu.phase_used[BlackoilPhases::Vapour]) {
-            const ADB perf_rv = (state.rv.size() > 0) ? subset(state.rv, well_cells) : ADB::null();
+            const ADB perf_rv = (state.rv.size() > 0) ? subset(state.rv, well_cell_selection) : ADB::null();
             const Vector bg = fluid_->bGas(avg_press_ad, perf_temp, perf_rv, perf_cond, well_cells).value();
             b.col(pu.phase_pos[BlackoilPhases::Vapour]) = bg;
         }
@@ -377,13 +379,13 @@ namespace Opm
             b_perfcells.clear();
             return;
         } else {
-            const std::vector<int>& well_cells = wellOps().well_cells;
+            const IndexSelection& well_cell_selection = wellOps().well_cell_selection;
             const int num_phases = wells().number_of_phases;
             mob_perfcells.resize(num_phases, ADB::null());
             b_perfcells.resize(num_phases, ADB::null());
             for (int phase = 0; phase < num_phases; ++phase) {
-                mob_perfcells[phase] = subset(rq[phase].mob, well_cells);
-                b_perfcells[phase] = subset(rq[phase].b, well_cells);
+                mob_perfcells[phase] = subset(rq[phase].mob, well_cell_selection);
+                b_perfcells[phase] = subset(rq[phase].b, well_cell_selection);
             }
         }
     }
@@ -408,12 +410,12 @@ namespace Opm
         const int nw = wells().number_of_wells;
         const int nperf = wells().well_connpos[nw];
         Vector Tw = Eigen::Map<const Vector>(wells().WI, nperf);
-        const std::vector<int>& well_cells = wellOps().well_cells;
+        const IndexSelection& well_cell_selection = wellOps().well_cell_selection;
 
         // pressure diffs computed already (once per step, not changing per iteration)
         const Vector& cdp = wellPerforationPressureDiffs();
         // Extract needed quantities for the perforation cells
-        const ADB& p_perfcells = subset(state.pressure, well_cells);
+        const ADB& p_perfcells = subset(state.pressure, well_cell_selection);
 
         // Perforation pressure
         const ADB perfpressure = (wellOps().w2p * state.bhp) + cdp;
@@ -468,8 +470,8 @@ namespace Opm
             const int gaspos = pu.phase_pos[Gas];
             const ADB cq_psOil = cq_ps[oilpos];
             const ADB cq_psGas = cq_ps[gaspos];
-            const ADB& rv_perfcells = subset(state.rv, well_cells);
-            const ADB& rs_perfcells = subset(state.rs, well_cells);
+            const ADB& rv_perfcells = subset(state.rv, well_cell_selection);
+            const ADB& rs_perfcells = subset(state.rs, well_cell_selection);
             cq_ps[gaspos] += rs_perfcells * cq_psOil;
             cq_ps[oilpos] += rv_perfcells * cq_psGas;
         }
@@ -527,8 +529,8 @@ namespace Opm
 
         if ((*active_)[Oil] && (*active_)[Gas]) {
             // Incorporate RS/RV factors if both oil and gas active
-            const ADB& rv_perfcells = subset(state.rv, well_cells);
-            const ADB& rs_perfcells = subset(state.rs, well_cells);
+            const ADB& rv_perfcells = subset(state.rv, well_cell_selection);
+            const ADB& rs_perfcells = subset(state.rs, well_cell_selection);
             const ADB d = Vector::Constant(nperf,1.0) - rv_perfcells * rs_perfcells;
 
             const int oilpos = pu.phase_pos[Oil];
@@ -647,6 +649,7 @@ namespace Opm
 
 
             const Opm::PhaseUsage& pu = fluid_->phaseUsage();
+            vfp_hints_.resize(nw);
             //Loop over all wells
 #pragma omp parallel for schedule(static)
             for (int w = 0; w < nw; ++w) {
@@ -688,7 +691,7 @@ namespace Opm
                                     wells(), w, vfp_properties_->getProd()->getTable(table_id)->getDatumDepth(),
                                     wellPerforationDensities()[perf], gravity_);
 
-                            well_state.thp()[w] = vfp_properties_->getProd()->thp(table_id, aqua, liquid, vapour, bhp[w] + dp, alq);
+                            well_state.thp()[w] = vfp_properties_->getProd()->thp(table_id, aqua, liquid, vapour, bhp[w] + dp, alq, vfp_hints_[w]);
                         }
                         else {
                             OPM_THROW(std::logic_error, "Expected INJECTOR or PRODUCER well");
@@ -1010,6 +1013,11 @@ namespace Opm
         const Opm::PhaseUsage& pu = fluid_->phaseUsage();
 
         Vector bhps = Vector::Zero(nw);
+        // The THP controls of the producers are evaluated together below,
+        // with one lookup in the VFP tables.
+        std::vector<int> last_bhp_ctrl(nw, -1);
+        std::vector<int> thp_well, thp_ctrl, thp_table;
+        std::vector<double> thp_aqua, thp_liquid, thp_vapour, thp_target, thp_alq;
         for (int w = 0; w < nw; ++w) {
             const WellControls* ctrl = wells().ctrls[w];
             const int nwc = well_controls_get_num(ctrl);
@@ -1020,6 +1028,7 @@ namespace Opm
 
                 if (well_controls_iget_type(ctrl, ctrl_index) == BHP) {
                     bhps[w] = well_controls_iget_target(ctrl, ctrl_index);
+                    last_bhp_ctrl[w] = ctrl_index;
                 }
 
                 if (well_controls_iget_type(ctrl, ctrl_index) == THP) {
@@ -1056,15 +1065,14 @@ namespace Opm
                         }
                     }
                     else if (well_type == PRODUCER) {
-                        double dp = wellhelpers::computeHydrostaticCorrection(
-                                    wells(), w, vfp_properties_->getProd()->getTable(vfp)->getDatumDepth(),
-                                    wellPerforationDensities()[perf], gravity_);
-
-                        const double bhp = vfp_properties_->getProd()->bhp(vfp, aqua, liquid, vapour, thp, alq) - dp;
-                        // apply the strictest of the bhp controlls i.e. largest bhp for producers
-                        if ( bhp > bhps[w]) {
-                            bhps[w] = bhp;
-                        }
+                        thp_well.push_back(w);
+                        thp_ctrl.push_back(ctrl_index);
+                        thp_table.push_back(vfp);
+                        thp_aqua.push_back(aqua);
+                        thp_liquid.push_back(liquid);
+                        thp_vapour.push_back(vapour);
+                        thp_target.push_back(thp);
+                        thp_alq.push_back(alq);
                     }
                     else {
                         OPM_THROW(std::logic_error, "Expected PRODUCER or INJECTOR type of well");
@@ -1074,6 +1082,34 @@ namespace Opm
 
         }
 
+        if (!thp_well.empty()) {
+            vfp_hints_.resize(nw);
+            std::vector<VFPProdProperties::InterpHint> hints(thp_well.size());
+            for (std::size_t i = 0; i < thp_well.size(); ++i) {
+                hints[i] = vfp_hints_[thp_well[i]];
+            }
+            const std::vector<double> thp_bhp =
+                vfp_properties_->getProd()->bhp(thp_table, thp_aqua, thp_liquid, thp_vapour, thp_target, thp_alq, hints);
+            for (std::size_t i = 0; i < thp_well.size(); ++i) {
+                const int w = thp_well[i];
+                vfp_hints_[w] = hints[i];
+                // a BHP control later in the list overrides the THP control
+                if (thp_ctrl[i] < last_bhp_ctrl[w]) {
+                    continue;
+                }
+                const int perf = wells().well_connpos[w]; //first perforation
+                double dp = wellhelpers::computeHydrostaticCorrection(
+                            wells(), w, vfp_properties_->getProd()->getTable(thp_table[i])->getDatumDepth(),
+                            wellPerforationDensities()[perf], gravity_);
+
+                const double bhp = thp_bhp[i] - dp;
+                // apply the strictest of the bhp controlls i.e. largest bhp for producers
+                if ( bhp > bhps[w]) {
+                    bhps[w] = bhp;
+                }
+            }
+        }
+
         // use bhp limit from control
         state0.bhp = ADB::constant(bhps);
 
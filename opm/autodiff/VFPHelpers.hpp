@@ -28,6 +28,11 @@
 #include <opm/material/densead/Math.hpp>
 #include <opm/material/densead/Evaluation.hpp>
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
 /**
  * This file contains a set of helper functions used by VFPProd / VFPInj.
  */
@@ -205,9 +210,13 @@ struct InterpData {
  * Helper function to find indices etc. for linear interpolation and extrapolation
  *  @param value Value to find in values
  *  @param values Sorted list of values to search for value in.
+ *  @param hint Index of the interval found by a previous search, which is
+ *         checked first and updated with the interval found. Wells change
+ *         little between Newton iterations, so the previous interval
+ *         usually still contains the value.
  *  @return Data required to find the interpolated value
  */
-inline InterpData findInterpData(const double& value, const std::vector<double>& values) {
+inline InterpData findInterpData(const double& value, const std::vector<double>& values, int& hint) {
     InterpData retval;
 
     const int nvalues = values.size();
@@ -231,16 +240,21 @@ inline InterpData findInterpData(const double& value, const std::vector<double>&
             retval.ind_[0] = nvalues-2;
             retval.ind_[1] = nvalues-1;
         }
+        //Use the hinted interval if it contains value, i.e.,
+        //values[i-1] < value <= values[i]
+        else if (hint > 0 && hint < nvalues
+                 && values[hint-1] < value && value <= values[hint]) {
+            retval.ind_[0] = hint-1;
+            retval.ind_[1] = hint;
+        }
         else {
-            //Search internal intervals
-            for (int i=1; i<nvalues; ++i) {
-                if (values[i] >= value) {
-                    retval.ind_[0] = i-1;
-                    retval.ind_[1] = i;
-                    break;
-                }
-            }
+            //Binary search for the first value >= value among the
+            //internal interval ends
+            const int i = std::lower_bound(values.begin() + 1, values.end(), value) - values.begin();
+            retval.ind_[0] = i-1;
+            retval.ind_[1] = i;
         }
+        hint = retval.ind_[1];
 
         const double start = values[retval.ind_[0]];
         const double end   = values[retval.ind_[1]];
@@ -263,6 +277,19 @@ inline InterpData findInterpData(const double& value, const std::vector<double>&
 
 
 
+/**
+ * Helper function to find indices etc. for linear interpolation and extrapolation
+ *  @param value Value to find in values
+ *  @param values Sorted list of values to search for value in.
+ *  @return Data required to find the interpolated value
+ */
+inline InterpData findInterpData(const double& value, const std::vector<double>& values) {
+    int hint = 0;
+    return findInterpData(value, values, hint);
+}
+
+
+
 
 
 
@@ -505,6 +532,158 @@ inline VFPEvaluation interpolate(
 
 
 
+/**
+ * A VFP table prepared for repeated interpolation.
+ *
+ * Instead of gathering the 32 corners of the hypercube together with all
+ * derivatives and interpolating each of them, the corners are read
+ * directly from the contiguous table storage and the dimensions are
+ * removed one by one, as in interpolate(). The derivative along an axis
+ * is computed when that axis is removed, from the values which are
+ * already interpolated along the previous axes, so the evaluation is a
+ * fixed sequence of 31 linear interpolations and 31 differences. The
+ * results are the same as those of interpolate().
+ *
+ * The flo axis is the last and fastest varying one of the tables, so the
+ * two flo corners of each edge are adjacent in memory.
+ *
+ * The table is referenced, not copied, and must outlive this object.
+ */
+class PreparedVFPTable {
+public:
+    PreparedVFPTable() : data_(nullptr), stride_{0, 0, 0, 0, 0}, dims_(0) {}
+
+    explicit PreparedVFPTable(const VFPProdTable& table)
+        : data_(table.getTable().data()),
+          dims_(5)
+    {
+        const auto* strides = table.getTable().strides();
+        for (int d = 0; d < 5; ++d) {
+            stride_[d] = strides[d];
+        }
+    }
+
+    explicit PreparedVFPTable(const VFPInjTable& table)
+        : data_(table.getTable().data()),
+          stride_{0, 0, 0, 0, 0},
+          dims_(2)
+    {
+        const auto* strides = table.getTable().strides();
+        stride_[0] = strides[0];
+        stride_[4] = strides[1];
+    }
+
+    /**
+     * Interpolation in a production table, see interpolate().
+     */
+    VFPEvaluation interpolate(
+            const InterpData& flo_i,
+            const InterpData& thp_i,
+            const InterpData& wfr_i,
+            const InterpData& gfr_i,
+            const InterpData& alq_i) const {
+        assert(dims_ == 5);
+
+        //Lower corner and the steps to the upper corners along each axis
+        const double* base = data_
+            + thp_i.ind_[0]*stride_[0] + wfr_i.ind_[0]*stride_[1] + gfr_i.ind_[0]*stride_[2]
+            + alq_i.ind_[0]*stride_[3] + flo_i.ind_[0]*stride_[4];
+        const std::ptrdiff_t step[5] = {
+            (thp_i.ind_[1] - thp_i.ind_[0])*stride_[0],
+            (wfr_i.ind_[1] - wfr_i.ind_[0])*stride_[1],
+            (gfr_i.ind_[1] - gfr_i.ind_[0])*stride_[2],
+            (alq_i.ind_[1] - alq_i.ind_[0])*stride_[3],
+            (flo_i.ind_[1] - flo_i.ind_[0])*stride_[4] };
+
+        //Corner values, ordered so that the next axis to remove varies fastest,
+        //and the derivatives along the flo, alq, gfr, wfr and thp axes
+        double v[32];
+        double d[5][16];
+        int c = 0;
+        for (int t=0; t<=1; ++t) {
+            for (int w=0; w<=1; ++w) {
+                for (int g=0; g<=1; ++g) {
+                    for (int a=0; a<=1; ++a) {
+                        const double* p = base + t*step[0] + w*step[1] + g*step[2] + a*step[3];
+                        v[c++] = p[0];
+                        v[c++] = p[step[4]];
+                    }
+                }
+            }
+        }
+
+        // Remove dimensions one by one, in the same order as interpolate()
+        removeAxis(16, flo_i, v, d, 0);
+        removeAxis(8, alq_i, v, d, 1);
+        removeAxis(4, gfr_i, v, d, 2);
+        removeAxis(2, wfr_i, v, d, 3);
+        removeAxis(1, thp_i, v, d, 4);
+
+        VFPEvaluation retval;
+        retval.value = v[0];
+        retval.dthp = d[4][0];
+        retval.dwfr = d[3][0];
+        retval.dgfr = d[2][0];
+        retval.dalq = d[1][0];
+        retval.dflo = d[0][0];
+        return retval;
+    }
+
+    /**
+     * Interpolation in an injection table, see interpolate().
+     */
+    VFPEvaluation interpolate(
+            const InterpData& flo_i,
+            const InterpData& thp_i) const {
+        assert(dims_ == 2);
+
+        const double* base = data_ + thp_i.ind_[0]*stride_[0] + flo_i.ind_[0]*stride_[4];
+        const std::ptrdiff_t thp_step = (thp_i.ind_[1] - thp_i.ind_[0])*stride_[0];
+        const std::ptrdiff_t flo_step = (flo_i.ind_[1] - flo_i.ind_[0])*stride_[4];
+
+        double v[4] = { base[0], base[flo_step], base[thp_step], base[thp_step + flo_step] };
+        double d[2][16];
+        removeAxis(2, flo_i, v, d, 0);
+        removeAxis(1, thp_i, v, d, 1);
+
+        VFPEvaluation retval;
+        retval.value = v[0];
+        retval.dthp = d[1][0];
+        retval.dwfr = -1e100;
+        retval.dgfr = -1e100;
+        retval.dalq = -1e100;
+        retval.dflo = d[0][0];
+        return retval;
+    }
+
+private:
+    // Interpolates each pair (v[2i], v[2i+1]), which differ only along
+    // the k'th axis to remove, into v[i] for i < n. The derivative along
+    // the axis goes to d[k][i], and the derivatives d[j] along the
+    // previously removed axes are interpolated in the same way.
+    static void removeAxis(const int n, const InterpData& axis_i,
+                           double* v, double (*d)[16], const int k) {
+        const double t2 = axis_i.factor_;
+        const double t1 = 1.0 - t2;
+        for (int j=0; j<k; ++j) {
+            for (int i=0; i<n; ++i) {
+                d[j][i] = t1*d[j][2*i] + t2*d[j][2*i+1];
+            }
+        }
+        for (int i=0; i<n; ++i) {
+            d[k][i] = (v[2*i+1] - v[2*i]) * axis_i.inv_dist_;
+            v[i] = t1*v[2*i] + t2*v[2*i+1];
+        }
+    }
+
+    const double* data_;
+    std::ptrdiff_t stride_[5]; // thp, wfr, gfr, alq and flo axis
+    int dims_;
+};
+
+
+
+
 #ifdef __GNUC__
 #pragma GCC pop_options //unroll loops
 #endif
@@ -851,11 +1030,14 @@ inline double findX(const double& x0,
  * Essentially:
  *   Given the function f(thp_array(x)) = bhp_array(x), which is piecewise linear,
  *   find thp so that f(thp) = bhp.
+ * The hint is the end index of the interval found by a previous call,
+ * as for findInterpData(), and is checked first when bhp_array is sorted.
  */
 inline double findTHP(
         const std::vector<double>& bhp_array,
         const std::vector<double>& thp_array,
-        double bhp) {
+        double bhp,
+        int& hint) {
     int nthp = thp_array.size();
 
     double thp = -1e100;
@@ -896,9 +1078,16 @@ inline double findTHP(
             //Find i so that bhp_array[i-1] <= bhp <= bhp_array[i];
             //Assuming a small number of values in bhp_array, this should be quite
             //efficient. Other strategies might be bisection, etc.
+            //The intervals are disjoint, so the hinted one is the only
+            //candidate if it contains bhp.
             int i=0;
             bool found = false;
-            for (; i<nthp-1; ++i) {
+            if (hint > 0 && hint < nthp
+                && bhp_array[hint-1] < bhp && bhp <= bhp_array[hint]) {
+                i = hint-1;
+                found = true;
+            }
+            for (; !found && i<nthp-1; ++i) {
                 const double& y0 = bhp_array[i  ];
                 const double& y1 = bhp_array[i+1];
 
@@ -910,6 +1099,7 @@ inline double findTHP(
             //Canary in a coal mine: shouldn't really be required
             assert(found == true);
             static_cast<void>(found); //Silence compiler warning
+            hint = i+1;
 
             const double& x0 = thp_array[i  ];
             const double& x1 = thp_array[i+1];
@@ -968,6 +1158,19 @@ inline double findTHP(
 
 
 
+/**
+ * As above, without a hint.
+ */
+inline double findTHP(
+        const std::vector<double>& bhp_array,
+        const std::vector<double>& thp_array,
+        double bhp) {
+    int hint = 0;
+    return findTHP(bhp_array, thp_array, bhp, hint);
+}
+
+
+
 
 
 
@@ -56,6 +56,7 @@ VFPInjProperties::VFPInjProperties() {
 
 VFPInjProperties::VFPInjProperties(const VFPInjTable* table){
     m_tables[table->getTableNum()] = table;
+    m_prepared[table->getTableNum()] = detail::PreparedVFPTable(*table);
 }
 
 
@@ -64,6 +65,7 @@ VFPInjProperties::VFPInjProperties(const VFPInjTable* table){
 VFPInjProperties::VFPInjProperties(const std::map<int, VFPInjTable>& tables) {
     for (const auto& table : tables) {
         m_tables[table.first] = &table.second;
+        m_prepared[table.first] = detail::PreparedVFPTable(table.second);
     }
 }
 
@@ -109,7 +111,7 @@ VFPInjProperties::EvalWell VFPInjProperties::bhp(const int table_id,
         auto flo_i = detail::findInterpData(flo.value(), table->getFloAxis());
         auto thp_i = detail::findInterpData( thp, table->getTHPAxis()); // assume constant
 
-        detail::VFPEvaluation bhp_val = detail::interpolate(table->getTable(), flo_i, thp_i);
+        detail::VFPEvaluation bhp_val = m_prepared.at(table_id).interpolate(flo_i, thp_i);
 
         bhp = bhp_val.dflo * flo;
         bhp.setValue(bhp_val.value); // thp is assumed constant i.e.
@@ -161,7 +163,7 @@ VFPInjProperties::ADB VFPInjProperties::bhp(const std::vector<int>& table_id,
             auto flo_i = detail::findInterpData(flo.value()[i], table->getFloAxis());
             auto thp_i = detail::findInterpData(thp_arg.value()[i], table->getTHPAxis());
 
-            detail::VFPEvaluation bhp_val = detail::interpolate(table->getTable(), flo_i, thp_i);
+            detail::VFPEvaluation bhp_val = m_prepared.at(table_id[i]).interpolate(flo_i, thp_i);
 
             value[i] = bhp_val.value;
             dthp[i] = bhp_val.dthp;
@@ -207,8 +209,14 @@ double VFPInjProperties::bhp(int table_id,
         const double& thp_arg) const {
     const VFPInjTable* table = detail::getTable(m_tables, table_id);
 
-    detail::VFPEvaluation retval = detail::bhp(table, aqua, liquid, vapour, thp_arg);
-    return retval.value;
+    //Find interpolation variables
+    double flo = detail::getFlo(aqua, liquid, vapour, table->getFloType());
+
+    //First, find the values to interpolate between
+    auto flo_i = detail::findInterpData(flo, table->getFloAxis());
+    auto thp_i = detail::findInterpData(thp_arg, table->getTHPAxis());
+
+    return m_prepared.at(table_id).interpolate(flo_i, thp_i).value;
 }
 
 
@@ -224,7 +232,7 @@ double VFPInjProperties::thp(int table_id,
         const double& vapour,
         const double& bhp_arg) const {
     const VFPInjTable* table = detail::getTable(m_tables, table_id);
-    const VFPInjTable::array_type& data = table->getTable();
+    const detail::PreparedVFPTable& prepared = m_prepared.at(table_id);
 
     //Find interpolation variables
     double flo = detail::getFlo(aqua, liquid, vapour, table->getFloType());
@@ -241,7 +249,7 @@ double VFPInjProperties::thp(int table_id,
     std::vector<double> bhp_array(nthp);
     for (int i=0; i<nthp; ++i) {
         auto thp_i = detail::findInterpData(thp_array[i], thp_array);
-        bhp_array[i] = detail::interpolate(data, flo_i, thp_i).value;
+        bhp_array[i] = prepared.interpolate(flo_i, thp_i).value;
     }
 
     double retval = detail::findTHP(bhp_array, thp_array, bhp_arg);
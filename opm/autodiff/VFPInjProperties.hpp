@@ -23,6 +23,7 @@
 #include <opm/parser/eclipse/EclipseState/Tables/VFPInjTable.hpp>
 #include <opm/core/wells.h>
 #include <opm/autodiff/AutoDiffBlock.hpp>
+#include <opm/autodiff/VFPHelpers.hpp>
 #include <opm/material/densead/Math.hpp>
 #include <opm/material/densead/Evaluation.hpp>
 
@@ -151,6 +152,9 @@ public:
 private:
     // Map which connects the table number with the table itself
     std::map<int, const VFPInjTable*> m_tables;
+
+    // The same tables, prepared for interpolation
+    std::map<int, detail::PreparedVFPTable> m_prepared;
 };
 
 
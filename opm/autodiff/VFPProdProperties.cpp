@@ -33,6 +33,29 @@
 namespace Opm {
 
 
+namespace {
+
+    // Interpolates bhp in the table, starting the search on each axis
+    // from the interval given by the hint.
+    detail::VFPEvaluation interpolate(const VFPProdTable* table,
+                                      const detail::PreparedVFPTable& prepared,
+                                      const double flo,
+                                      const double thp,
+                                      const double wfr,
+                                      const double gfr,
+                                      const double alq,
+                                      VFPProdProperties::InterpHint& hint) {
+        //Value of FLO is negative in OPM for producers, but positive in VFP table
+        auto flo_i = detail::findInterpData(-flo, table->getFloAxis(), hint.flo);
+        auto thp_i = detail::findInterpData( thp, table->getTHPAxis(), hint.thp);
+        auto wfr_i = detail::findInterpData( wfr, table->getWFRAxis(), hint.wfr);
+        auto gfr_i = detail::findInterpData( gfr, table->getGFRAxis(), hint.gfr);
+        auto alq_i = detail::findInterpData( alq, table->getALQAxis(), hint.alq);
+
+        return prepared.interpolate(flo_i, thp_i, wfr_i, gfr_i, alq_i);
+    }
+
+} // anonymous namespace
 
 
 VFPProdProperties::VFPProdProperties() {
@@ -43,6 +66,7 @@ VFPProdProperties::VFPProdProperties() {
 
 VFPProdProperties::VFPProdProperties(const VFPProdTable* table){
     m_tables[table->getTableNum()] = table;
+    m_prepared[table->getTableNum()] = detail::PreparedVFPTable(*table);
 }
 
 
@@ -51,6 +75,7 @@ VFPProdProperties::VFPProdProperties(const VFPProdTable* table){
 VFPProdProperties::VFPProdProperties(const std::map<int, VFPProdTable>& tables) {
     for (const auto& table : tables) {
         m_tables[table.first] = &table.second;
+        m_prepared[table.first] = detail::PreparedVFPTable(table.second);
     }
 }
 
@@ -81,6 +106,19 @@ VFPProdProperties::EvalWell VFPProdProperties::bhp(const int table_id,
                                                    const EvalWell& vapour,
                                                    const double& thp,
                                                    const double& alq) const {
+    InterpHint hint;
+    return bhp(table_id, aqua, liquid, vapour, thp, alq, hint);
+}
+
+
+
+VFPProdProperties::EvalWell VFPProdProperties::bhp(const int table_id,
+                                                   const EvalWell& aqua,
+                                                   const EvalWell& liquid,
+                                                   const EvalWell& vapour,
+                                                   const double& thp,
+                                                   const double& alq,
+                                                   InterpHint& hint) const {
 
     //Get the table
     const VFPProdTable* table = detail::getTable(m_tables, table_id);
@@ -93,15 +131,8 @@ VFPProdProperties::EvalWell VFPProdProperties::bhp(const int table_id,
 
     //Compute the BHP for each well independently
     if (table != nullptr) {
-        //First, find the values to interpolate between
-        //Value of FLO is negative in OPM for producers, but positive in VFP table
-        auto flo_i = detail::findInterpData(-flo.value(), table->getFloAxis());
-        auto thp_i = detail::findInterpData( thp, table->getTHPAxis()); // assume constant
-        auto wfr_i = detail::findInterpData( wfr.value(), table->getWFRAxis());
-        auto gfr_i = detail::findInterpData( gfr.value(), table->getGFRAxis());
-        auto alq_i = detail::findInterpData( alq, table->getALQAxis()); //assume constant
-
-        detail::VFPEvaluation bhp_val = detail::interpolate(table->getTable(), flo_i, thp_i, wfr_i, gfr_i, alq_i);
+        //thp and alq are assumed constant
+        detail::VFPEvaluation bhp_val = interpolate(table, m_prepared.at(table_id), flo.value(), thp, wfr.value(), gfr.value(), alq, hint);
 
         bhp = (bhp_val.dwfr * wfr) + (bhp_val.dgfr * gfr) - (bhp_val.dflo * flo);
         bhp.setValue(bhp_val.value);
@@ -164,7 +195,7 @@ VFPProdProperties::ADB VFPProdProperties::bhp(const std::vector<int>& table_id,
             auto gfr_i = detail::findInterpData( gfr.value()[i], table->getGFRAxis());
             auto alq_i = detail::findInterpData( alq.value()[i], table->getALQAxis());
 
-            detail::VFPEvaluation bhp_val = detail::interpolate(table->getTable(), flo_i, thp_i, wfr_i, gfr_i, alq_i);
+            detail::VFPEvaluation bhp_val = m_prepared.at(table_id[i]).interpolate(flo_i, thp_i, wfr_i, gfr_i, alq_i);
 
             value[i] = bhp_val.value;
             dthp[i] = bhp_val.dthp;
@@ -222,10 +253,59 @@ double VFPProdProperties::bhp(int table_id,
         const double& vapour,
         const double& thp_arg,
         const double& alq) const {
+    InterpHint hint;
+    return bhp(table_id, aqua, liquid, vapour, thp_arg, alq, hint);
+}
+
+
+
+double VFPProdProperties::bhp(int table_id,
+        const double& aqua,
+        const double& liquid,
+        const double& vapour,
+        const double& thp_arg,
+        const double& alq,
+        InterpHint& hint) const {
     const VFPProdTable* table = detail::getTable(m_tables, table_id);
 
-    detail::VFPEvaluation retval = detail::bhp(table, aqua, liquid, vapour, thp_arg, alq);
-    return retval.value;
+    //Find interpolation variables
+    double flo = detail::getFlo(aqua, liquid, vapour, table->getFloType());
+    double wfr = detail::getWFR(aqua, liquid, vapour, table->getWFRType());
+    double gfr = detail::getGFR(aqua, liquid, vapour, table->getGFRType());
+
+    return interpolate(table, m_prepared.at(table_id), flo, thp_arg, wfr, gfr, alq, hint).value;
+}
+
+
+
+std::vector<double> VFPProdProperties::bhp(const std::vector<int>& table_id,
+        const std::vector<double>& aqua,
+        const std::vector<double>& liquid,
+        const std::vector<double>& vapour,
+        const std::vector<double>& thp_arg,
+        const std::vector<double>& alq,
+        std::vector<InterpHint>& hints) const {
+    const int nw = table_id.size();
+
+    assert(static_cast<int>(aqua.size())    == nw);
+    assert(static_cast<int>(liquid.size())  == nw);
+    assert(static_cast<int>(vapour.size())  == nw);
+    assert(static_cast<int>(thp_arg.size()) == nw);
+    assert(static_cast<int>(alq.size())     == nw);
+
+    hints.resize(nw);
+    std::vector<double> retval(nw, -1e100); //-1e100 signals a "missing" table
+    for (int i=0; i<nw; ++i) {
+        if (table_id[i] < 0) {
+            continue;
+        }
+        const VFPProdTable* table = detail::getTable(m_tables, table_id[i]);
+        const double flo = detail::getFlo(aqua[i], liquid[i], vapour[i], table->getFloType());
+        const double wfr = detail::getWFR(aqua[i], liquid[i], vapour[i], table->getWFRType());
+        const double gfr = detail::getGFR(aqua[i], liquid[i], vapour[i], table->getGFRType());
+        retval[i] = interpolate(table, m_prepared.at(table_id[i]), flo, thp_arg[i], wfr, gfr, alq[i], hints[i]).value;
+    }
+    return retval;
 }
 
 
@@ -236,8 +316,21 @@ double VFPProdProperties::thp(int table_id,
         const double& vapour,
         const double& bhp_arg,
         const double& alq) const {
+    InterpHint hint;
+    return thp(table_id, aqua, liquid, vapour, bhp_arg, alq, hint);
+}
+
+
+
+double VFPProdProperties::thp(int table_id,
+        const double& aqua,
+        const double& liquid,
+        const double& vapour,
+        const double& bhp_arg,
+        const double& alq,
+        InterpHint& hint) const {
     const VFPProdTable* table = detail::getTable(m_tables, table_id);
-    const VFPProdTable::array_type& data = table->getTable();
+    const detail::PreparedVFPTable& prepared = m_prepared.at(table_id);
 
     //Find interpolation variables
     double flo = detail::getFlo(aqua, liquid, vapour, table->getFloType());
@@ -253,17 +346,19 @@ double VFPProdProperties::thp(int table_id,
      * expensive, but let us assome that nthp is small
      * Recall that flo is negative in Opm, so switch the sign
      */
-    auto flo_i = detail::findInterpData(-flo, table->getFloAxis());
-    auto wfr_i = detail::findInterpData( wfr, table->getWFRAxis());
-    auto gfr_i = detail::findInterpData( gfr, table->getGFRAxis());
-    auto alq_i = detail::findInterpData( alq, table->getALQAxis());
+    auto flo_i = detail::findInterpData(-flo, table->getFloAxis(), hint.flo);
+    auto wfr_i = detail::findInterpData( wfr, table->getWFRAxis(), hint.wfr);
+    auto gfr_i = detail::findInterpData( gfr, table->getGFRAxis(), hint.gfr);
+    auto alq_i = detail::findInterpData( alq, table->getALQAxis(), hint.alq);
     std::vector<double> bhp_array(nthp);
     for (int i=0; i<nthp; ++i) {
-        auto thp_i = detail::findInterpData(thp_array[i], thp_array);
-        bhp_array[i] = detail::interpolate(data, flo_i, thp_i, wfr_i, gfr_i, alq_i).value;
+        //thp_array[i] is the end of interval i, so start the search there
+        int thp_hint = i;
+        auto thp_i = detail::findInterpData(thp_array[i], thp_array, thp_hint);
+        bhp_array[i] = prepared.interpolate(flo_i, thp_i, wfr_i, gfr_i, alq_i).value;
     }
 
-    double retval = detail::findTHP(bhp_array, thp_array, bhp_arg);
+    double retval = detail::findTHP(bhp_array, thp_array, bhp_arg, hint.thp);
     return retval;
 }
 
@@ -23,6 +23,7 @@
 #include <opm/parser/eclipse/EclipseState/Tables/VFPProdTable.hpp>
 #include <opm/core/wells.h>
 #include <opm/autodiff/AutoDiffBlock.hpp>
+#include <opm/autodiff/VFPHelpers.hpp>
 #include <opm/material/densead/Math.hpp>
 #include <opm/material/densead/Evaluation.hpp>
 
@@ -42,6 +43,21 @@ class VFPProdProperties {
 public:
     typedef AutoDiffBlock<double> ADB;
 
+    /**
+     * The table intervals found by the last lookup for a well, which are
+     * checked first by the next lookup for the same well. Well conditions
+     * change little between Newton iterations, so this usually avoids
+     * searching the axes. Each well should have its own hint.
+     */
+    struct InterpHint {
+        InterpHint() : flo(0), thp(0), wfr(0), gfr(0), alq(0) {}
+        int flo;
+        int thp;
+        int wfr;
+        int gfr;
+        int alq;
+    };
+
     /**
      * Empty constructor
      */
@@ -110,6 +126,17 @@ public:
             const double& thp,
             const double& alq) const;
 
+    /**
+     * As above, using and updating the lookup hint of the well.
+     */
+    EvalWell bhp(const int table_id,
+            const EvalWell& aqua,
+            const EvalWell& liquid,
+            const EvalWell& vapour,
+            const double& thp,
+            const double& alq,
+            InterpHint& hint) const;
+
     /**
      * Linear interpolation of bhp as a function of the input parameters
      * @param table_id Table number to use
@@ -129,6 +156,39 @@ public:
             const double& thp,
             const double& alq) const;
 
+    /**
+     * As above, using and updating the lookup hint of the well.
+     */
+    double bhp(int table_id,
+            const double& aqua,
+            const double& liquid,
+            const double& vapour,
+            const double& thp,
+            const double& alq,
+            InterpHint& hint) const;
+
+    /**
+     * Linear interpolation of bhp for several wells in one call.
+     * @param table_id Table number to use for each well. A negative entry
+     *                 indicates that no table is used, and the corresponding
+     *                 BHP will be -1e100.
+     * @param aqua Water phase rate of each well
+     * @param liquid Oil phase rate of each well
+     * @param vapour Gas phase rate of each well
+     * @param thp Tubing head pressure of each well
+     * @param alq Artificial lift or other parameter of each well
+     * @param hints Lookup hint of each well, updated by the call.
+     *
+     * @return The bottom hole pressure of each well.
+     */
+    std::vector<double> bhp(const std::vector<int>& table_id,
+            const std::vector<double>& aqua,
+            const std::vector<double>& liquid,
+            const std::vector<double>& vapour,
+            const std::vector<double>& thp,
+            const std::vector<double>& alq,
+            std::vector<InterpHint>& hints) const;
+
     /**
      * Linear interpolation of thp as a function of the input parameters
      * @param table_id Table number to use
@@ -148,6 +208,17 @@ public:
             const double& bhp,
             const double& alq) const;
 
+    /**
+     * As above, using and updating the lookup hint of the well.
+     */
+    double thp(int table_id,
+            const double& aqua,
+            const double& liquid,
+            const double& vapour,
+            const double& bhp,
+            const double& alq,
+            InterpHint& hint) const;
+
     /**
      * Returns the table associated with the ID, or throws an exception if
      * the table does not exist
@@ -164,6 +235,9 @@ public:
 private:
     // Map which connects the table number with the table itself
     std::map<int, const VFPProdTable*> m_tables;
+
+    // The same tables, prepared for interpolation
+    std::map<int, detail::PreparedVFPTable> m_prepared;
 };
 
 
@@ -0,0 +1,221 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPM_WELLBLOCKMATRIX_HEADER_INCLUDED
+#define OPM_WELLBLOCKMATRIX_HEADER_INCLUDED
+
+#include <cassert>
+#include <vector>
+
+namespace Opm
+{
+
+    /**
+     * Dense per-well storage of the Schur complement W = B^T inv(D) C of
+     * the well equations, with n x n blocks.
+     *
+     * The blocks of B, C and inv(D) are copied from the assembled block
+     * sparse matrices, where B and C have one row per well and one block
+     * per perforated cell, and inv(D) is block diagonal. The perforations
+     * of every well are stored contiguously in chunks of chunkSize, with
+     * the entries of a chunk interleaved such that the kernels run over
+     * the perforations of a chunk with unit stride. Together with the
+     * compile-time block size this lets the compiler unroll the block
+     * products and vectorise them over the perforations.
+     */
+    template <class Scalar, int n>
+    class WellBlockMatrix
+    {
+    public:
+        /// Number of perforations processed together by the kernels.
+        static const int chunkSize = 8;
+
+        /// Creates an empty matrix without wells.
+        WellBlockMatrix()
+            : chunk_start_(1, 0)
+        {
+        }
+
+        /// Copies the blocks of B, C and inv(D). B and C must have the
+        /// same sparsity pattern.
+        template <class Mat>
+        void assign(const Mat& B, const Mat& C, const Mat& invD)
+        {
+            const int nw = B.N();
+            assert(int(C.N()) == nw);
+            assert(int(invD.N()) == nw);
+
+            chunk_start_.resize(nw + 1);
+            chunk_start_[0] = 0;
+            for (int w = 0; w < nw; ++w) {
+                int nperf = 0;
+                for (auto col = B[w].begin(), colend = B[w].end(); col != colend; ++col) {
+                    ++nperf;
+                }
+                chunk_start_[w + 1] = chunk_start_[w] + (nperf + chunkSize - 1) / chunkSize;
+            }
+
+            const int nchunks = chunk_start_[nw];
+            cells_.assign(nchunks * chunkSize, -1);
+            C_.assign(nchunks * n * n * chunkSize, 0.0);
+            Bt_.assign(nchunks * n * n * chunkSize, 0.0);
+            invD_.resize(nw * n * n);
+
+            for (int w = 0; w < nw; ++w) {
+                int k = chunk_start_[w] * chunkSize;
+                auto ccol = C[w].begin();
+                for (auto bcol = B[w].begin(), bcolend = B[w].end(); bcol != bcolend; ++bcol, ++ccol, ++k) {
+                    assert(ccol != C[w].end() && ccol.index() == bcol.index());
+                    cells_[k] = bcol.index();
+                    const int chunk = k / chunkSize;
+                    const int lane = k % chunkSize;
+                    for (int i = 0; i < n; ++i) {
+                        for (int j = 0; j < n; ++j) {
+                            C_[entry(chunk, i, j) + lane] = (*ccol)[i][j];
+                            Bt_[entry(chunk, j, i) + lane] = (*bcol)[i][j];
+                        }
+                    }
+                }
+                const auto& d = invD[w][w];
+                for (int i = 0; i < n; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        invD_[(w*n + i)*n + j] = d[i][j];
+                    }
+                }
+            }
+        }
+
+        /// Number of wells.
+        int numWells() const { return int(chunk_start_.size()) - 1; }
+
+        /// y += alpha * B^T inv(D) C x. Only the perforated cells of y are
+        /// touched.
+        template <class X, class Y>
+        void usmv(const Scalar alpha, const X& x, Y& y) const
+        {
+            apply(alpha, x, y, Identity());
+        }
+
+        /// y[k] += alpha * (B^T inv(D) C x)[i] for the perforated cells i,
+        /// where k = perforatedCellIndex[i].
+        template <class X, class Y>
+        void usmvPerforated(const Scalar alpha, const X& x, Y& y,
+                            const std::vector<int>& perforatedCellIndex) const
+        {
+            apply(alpha, x, y, Mapped(perforatedCellIndex));
+        }
+
+    private:
+        struct Identity
+        {
+            int operator()(const int cell) const { return cell; }
+        };
+
+        struct Mapped
+        {
+            explicit Mapped(const std::vector<int>& index) : index_(index) {}
+            int operator()(const int cell) const { return index_[cell]; }
+            const std::vector<int>& index_;
+        };
+
+        // Start of the lanes of block entry (i, j) in the given chunk.
+        static int entry(const int chunk, const int i, const int j)
+        {
+            return ((chunk*n + i)*n + j)*chunkSize;
+        }
+
+        template <class X, class Y, class OutputIndex>
+        void apply(const Scalar alpha, const X& x, Y& y, const OutputIndex& outputIndex) const
+        {
+            const int nw = numWells();
+            for (int w = 0; w < nw; ++w) {
+                // C x, accumulated separately for every lane.
+                Scalar cx[n][chunkSize] = {};
+                for (int chunk = chunk_start_[w]; chunk < chunk_start_[w + 1]; ++chunk) {
+                    const int* cells = &cells_[chunk * chunkSize];
+                    Scalar xc[n][chunkSize] = {};
+                    for (int lane = 0; lane < chunkSize && cells[lane] >= 0; ++lane) {
+                        const auto& xcell = x[cells[lane]];
+                        for (int j = 0; j < n; ++j) {
+                            xc[j][lane] = xcell[j];
+                        }
+                    }
+                    for (int i = 0; i < n; ++i) {
+                        for (int j = 0; j < n; ++j) {
+                            const Scalar* c = &C_[entry(chunk, i, j)];
+                            for (int lane = 0; lane < chunkSize; ++lane) {
+                                cx[i][lane] += c[lane] * xc[j][lane];
+                            }
+                        }
+                    }
+                }
+                Scalar cxw[n] = {};
+                for (int i = 0; i < n; ++i) {
+                    for (int lane = 0; lane < chunkSize; ++lane) {
+                        cxw[i] += cx[i][lane];
+                    }
+                }
+
+                // v = alpha * inv(D) C x
+                Scalar v[n] = {};
+                const Scalar* d = &invD_[w*n*n];
+                for (int i = 0; i < n; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        v[i] += d[i*n + j] * cxw[j];
+                    }
+                    v[i] *= alpha;
+                }
+
+                // y += B^T v
+                for (int chunk = chunk_start_[w]; chunk < chunk_start_[w + 1]; ++chunk) {
+                    Scalar out[n][chunkSize] = {};
+                    for (int j = 0; j < n; ++j) {
+                        for (int i = 0; i < n; ++i) {
+                            const Scalar* bt = &Bt_[entry(chunk, j, i)];
+                            for (int lane = 0; lane < chunkSize; ++lane) {
+                                out[j][lane] += bt[lane] * v[i];
+                            }
+                        }
+                    }
+                    const int* cells = &cells_[chunk * chunkSize];
+                    for (int lane = 0; lane < chunkSize && cells[lane] >= 0; ++lane) {
+                        auto& ycell = y[outputIndex(cells[lane])];
+                        for (int j = 0; j < n; ++j) {
+                            ycell[j] += out[j][lane];
+                        }
+                    }
+                }
+            }
+        }
+
+        // Chunks of well w are chunk_start_[w] to chunk_start_[w+1].
+        std::vector<int> chunk_start_;
+        // Cell of every perforation, -1 for the unused lanes of the last
+        // chunk of a well.
+        std::vector<int> cells_;
+        // Blocks of C and transposed blocks of B, see entry().
+        std::vector<Scalar> C_;
+        std::vector<Scalar> Bt_;
+        // Diagonal blocks of inv(D), row major.
+        std::vector<Scalar> invD_;
+    };
+
+} // namespace Opm
+
+#endif // OPM_WELLBLOCKMATRIX_HEADER_INCLUDED
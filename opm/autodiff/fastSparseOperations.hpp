@@ -142,7 +142,8 @@ void fastSparseProduct(const Lhs& lhs, const Rhs& rhs, ResultType& res)
 
 
 
-inline void fastDiagSparseProduct(const std::vector<double>& lhs,
+template <class DiagVector>
+inline void fastDiagSparseProduct(const DiagVector& lhs,
                                   const Eigen::SparseMatrix<double>& rhs,
                                   Eigen::SparseMatrix<double>& res)
 {
@@ -161,8 +162,9 @@ inline void fastDiagSparseProduct(const std::vector<double>& lhs,
 
 
 
+template <class DiagVector>
 inline void fastSparseDiagProduct(const Eigen::SparseMatrix<double>& lhs,
-                                  const std::vector<double>& rhs,
+                                  const DiagVector& rhs,
                                   Eigen::SparseMatrix<double>& res)
 {
     res = lhs;
@@ -0,0 +1,131 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_MODULE AutoDiffArenaTest
+
+#include <opm/autodiff/AutoDiffArena.hpp>
+#include <opm/autodiff/AutoDiffBlock.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    typedef std::vector<double, Opm::AutoDiffArenaAllocator<double> > ArenaVector;
+}
+
+
+BOOST_AUTO_TEST_CASE(HeapWithoutScope)
+{
+    Opm::AutoDiffArena arena;
+    ArenaVector v(100, 1.0);
+    BOOST_CHECK_EQUAL(arena.statistics().allocations, 0u);
+    BOOST_CHECK_EQUAL(v[99], 1.0);
+}
+
+
+BOOST_AUTO_TEST_CASE(ChunksAreReused)
+{
+    Opm::AutoDiffArena arena(1 << 16);
+    for (int iteration = 0; iteration < 10; ++iteration) {
+        arena.reset();
+        Opm::AutoDiffArena::Scope scope(arena);
+        for (int i = 0; i < 100; ++i) {
+            ArenaVector v(1000, double(i));
+            BOOST_CHECK(reinterpret_cast<std::uintptr_t>(v.data()) % 16 == 0);
+            BOOST_CHECK_EQUAL(v[999], double(i));
+        }
+        BOOST_CHECK_EQUAL(arena.iterationStatistics().allocations, 100u);
+    }
+    BOOST_CHECK_EQUAL(arena.statistics().allocations, 1000u);
+    BOOST_CHECK_EQUAL(arena.statistics().chunkAllocations, 1u);
+}
+
+
+BOOST_AUTO_TEST_CASE(LiveAllocationsArePreserved)
+{
+    Opm::AutoDiffArena arena(1 << 12);
+    std::vector<ArenaVector> kept;
+    {
+        Opm::AutoDiffArena::Scope scope(arena);
+        for (int i = 0; i < 10; ++i) {
+            kept.push_back(ArenaVector(200, double(i)));
+        }
+    }
+    arena.reset();
+    {
+        Opm::AutoDiffArena::Scope scope(arena);
+        for (int i = 0; i < 10; ++i) {
+            ArenaVector v(200, -1.0);
+        }
+    }
+    for (int i = 0; i < 10; ++i) {
+        BOOST_CHECK_EQUAL(kept[i].front(), double(i));
+        BOOST_CHECK_EQUAL(kept[i].back(), double(i));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(AllocationsOutliveArena)
+{
+    std::unique_ptr<ArenaVector> v;
+    {
+        Opm::AutoDiffArena arena;
+        Opm::AutoDiffArena::Scope scope(arena);
+        v.reset(new ArenaVector(50, 3.0));
+    }
+    BOOST_CHECK_EQUAL((*v)[49], 3.0);
+    v.reset();
+}
+
+
+BOOST_AUTO_TEST_CASE(AutoDiffBlockTemporaries)
+{
+    typedef Opm::AutoDiffBlock<double> ADB;
+    const int n = 1000;
+    const ADB::V v0 = ADB::V::LinSpaced(n, 1.0, 2.0);
+
+    const ADB x = ADB::variable(0, v0, { n });
+    const ADB reference = x * x * v0 + x / v0;
+
+    Opm::AutoDiffArena arena;
+    ADB::V value;
+    Eigen::SparseMatrix<double> jr, jref;
+    {
+        Opm::AutoDiffArena::Scope scope(arena);
+        const ADB result = x * x * v0 + x / v0;
+        value = result.value();
+        result.derivative()[0].toSparse(jr);
+    }
+    BOOST_CHECK(arena.statistics().allocations > 0);
+
+    BOOST_CHECK((value == reference.value()).all());
+    reference.derivative()[0].toSparse(jref);
+    BOOST_CHECK_EQUAL((Eigen::MatrixXd(jr) - Eigen::MatrixXd(jref)).norm(), 0.0);
+}
@@ -158,6 +158,56 @@ BOOST_AUTO_TEST_CASE(vertcatCollapseJacsTest)
 }
 
 
+
+
+BOOST_AUTO_TEST_CASE(collapseJacsTest)
+{
+    typedef AutoDiffBlock<double> ADB;
+    typedef ADB::V V;
+    typedef ADB::M M;
+    typedef Eigen::SparseMatrix<double> S;
+
+    // Three rows with jacobian blocks of every kind:
+    // diagonal (3 columns), zero (2 columns) and sparse (2 columns),
+    // where the sparse block holds an explicit zero that is dropped.
+    //
+    //   1 0 0 | 0 0 | 0 7
+    //   0 2 0 | 0 0 | 0 0
+    //   0 0 3 | 0 0 | 8 0
+    V val(3);
+    val << 1, 2, 3;
+    std::vector<M> jacs;
+    jacs.push_back(M(Eigen::DiagonalMatrix<double, Eigen::Dynamic>(V::LinSpaced(3, 1.0, 3.0).matrix())));
+    jacs.push_back(M(3, 2));
+    S s(3, 2);
+    s.insert(1, 0) = 0.0;
+    s.insert(2, 0) = 8.0;
+    s.insert(0, 1) = 7.0;
+    s.makeCompressed();
+    jacs.push_back(M(s));
+    const ADB x = ADB::function(std::move(val), std::move(jacs));
+
+    S expected(3, 7);
+    expected.insert(0, 0) = 1.0;
+    expected.insert(1, 1) = 2.0;
+    expected.insert(2, 2) = 3.0;
+    expected.insert(2, 5) = 8.0;
+    expected.insert(0, 6) = 7.0;
+    expected.makeCompressed();
+
+    S jac;
+    collapseJacs(x, jac);
+    BOOST_CHECK_EQUAL(jac.nonZeros(), 5);
+    BOOST_CHECK((Eigen::MatrixXd(jac) - Eigen::MatrixXd(expected)).norm() == 0.0);
+
+    // Row major targets, as used by the linear solvers.
+    Eigen::SparseMatrix<double, Eigen::RowMajor> row_jac;
+    collapseJacs(x, row_jac);
+    BOOST_CHECK_EQUAL(row_jac.nonZeros(), 5);
+    BOOST_CHECK((Eigen::MatrixXd(row_jac) - Eigen::MatrixXd(expected)).norm() == 0.0);
+}
+
+
 BOOST_AUTO_TEST_CASE(supersetTest)
 {
     typedef AutoDiffBlock<double> ADB;
@@ -228,3 +278,56 @@ BOOST_AUTO_TEST_CASE(subsetEmptyTest)
     }
 }
 
+
+BOOST_AUTO_TEST_CASE(subsetSupersetJacobianTest)
+{
+    typedef AutoDiffBlock<double> ADB;
+    typedef Eigen::SparseMatrix<double> S;
+
+    // Two variables, one with a diagonal and one with a full sparse jacobian.
+    const int n = 8;
+    const ADB::V v0 = ADB::V::LinSpaced(n, 1.0, 2.0);
+    const ADB::V v1 = ADB::V::LinSpaced(n, -1.0, 3.0);
+    std::vector<ADB> vars = ADB::variables(std::vector<ADB::V>{ v0, v1 });
+    S grad(n, n);
+    for (int i = 0; i < n; ++i) {
+        grad.insert(i, i) = 2.0;
+        grad.insert(i, (i + 3) % n) = -1.0 - i;
+    }
+    grad.makeCompressed();
+    const ADB x = vars[0] * v1 + grad * vars[1];
+
+    // Unsorted and repeated indices, as for several perforations in a cell.
+    const std::vector<int> indices = { 6, 1, 4, 1, 7 };
+    S sel(indices.size(), n);
+    for (int p = 0; p < int(indices.size()); ++p) {
+        sel.insert(p, indices[p]) = 1.0;
+    }
+
+    const ADB sub = subset(x, indices);
+    const ADB sub_cached = subset(x, IndexSelection(indices));
+    BOOST_CHECK_EQUAL(sub.size(), int(indices.size()));
+    for (int block = 0; block < x.numBlocks(); ++block) {
+        S jac, jac_cached, expected;
+        sub.derivative()[block].toSparse(jac);
+        sub_cached.derivative()[block].toSparse(jac_cached);
+        x.derivative()[block].toSparse(expected);
+        expected = sel * expected;
+        BOOST_CHECK_EQUAL((Eigen::MatrixXd(jac) - Eigen::MatrixXd(expected)).norm(), 0.0);
+        BOOST_CHECK_EQUAL(jac.nonZeros(), jac_cached.nonZeros());
+        BOOST_CHECK((Eigen::MatrixXd(jac) - Eigen::MatrixXd(jac_cached)).norm() == 0.0);
+    }
+
+    const ADB super = superset(sub, indices, n);
+    const S selT = sel.transpose();
+    BOOST_CHECK_EQUAL(super.size(), n);
+    const Eigen::VectorXd expected_val = selT * sub.value().matrix();
+    BOOST_CHECK_EQUAL((super.value().matrix() - expected_val).norm(), 0.0);
+    for (int block = 0; block < x.numBlocks(); ++block) {
+        S jac, expected;
+        super.derivative()[block].toSparse(jac);
+        sub.derivative()[block].toSparse(expected);
+        expected = selT * expected;
+        BOOST_CHECK_EQUAL((Eigen::MatrixXd(jac) - Eigen::MatrixXd(expected)).norm(), 0.0);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_MODULE AutoDiffKernelsTest
+
+#include <opm/autodiff/AutoDiffKernels.hpp>
+#include <opm/autodiff/AutoDiffMatrix.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    using namespace Opm::AutoDiffKernels;
+
+    std::vector<double> values(const int n, const double seed)
+    {
+        std::vector<double> v(n);
+        for (int i = 0; i < n; ++i) {
+            v[i] = std::sin(seed + 0.37*i);
+        }
+        return v;
+    }
+
+    // Distinct indices in [0, n).
+    std::vector<int> permutation(const int n)
+    {
+        std::vector<int> index(n);
+        for (int k = 0; k < n; ++k) {
+            index[k] = (7*k + 3) % n;
+        }
+        return index;
+    }
+
+    // Restores the best instruction set when leaving a test.
+    struct InstructionSetGuard
+    {
+        ~InstructionSetGuard() { setInstructionSet(bestInstructionSet()); }
+    };
+
+    // Sizes covering empty input, pure tails and full vector lanes.
+    const int sizes[] = { 0, 1, 3, 4, 7, 8, 9, 17, 101 };
+}
+
+
+BOOST_AUTO_TEST_CASE(AllInstructionSetsMatchScalar)
+{
+    InstructionSetGuard guard;
+    const InstructionSet sets[] = { AVX2, AVX512 };
+    for (const InstructionSet set : sets) {
+        for (const int n : sizes) {
+            const std::vector<double> d = values(n, 1.0);
+            const std::vector<int> index = permutation(n == 0 ? 1 : n);
+
+            std::vector<double> ref = values(n, 2.0);
+            std::vector<double> x = ref;
+            setInstructionSet(Scalar);
+            multiply(ref.data(), d.data(), n);
+            setInstructionSet(set);
+            multiply(x.data(), d.data(), n);
+            BOOST_CHECK(x == ref);
+
+            setInstructionSet(Scalar);
+            multiplyGathered(ref.data(), index.data(), d.data(), n);
+            setInstructionSet(set);
+            multiplyGathered(x.data(), index.data(), d.data(), n);
+            BOOST_CHECK(x == ref);
+
+            setInstructionSet(Scalar);
+            add(ref.data(), d.data(), n);
+            setInstructionSet(set);
+            add(x.data(), d.data(), n);
+            BOOST_CHECK(x == ref);
+
+            setInstructionSet(Scalar);
+            addScattered(ref.data(), index.data(), d.data(), n);
+            setInstructionSet(set);
+            addScattered(x.data(), index.data(), d.data(), n);
+            BOOST_CHECK(x == ref);
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(InstructionSetIsLimitedByCpu)
+{
+    InstructionSetGuard guard;
+    setInstructionSet(AVX512);
+    BOOST_CHECK(instructionSet() <= bestInstructionSet());
+    setInstructionSet(Scalar);
+    BOOST_CHECK_EQUAL(instructionSet(), Scalar);
+}
+
+
+BOOST_AUTO_TEST_CASE(DiagonalPlusSparse)
+{
+    typedef Eigen::SparseMatrix<double> Sp;
+    const int n = 13;
+    std::vector<Eigen::Triplet<double>> t;
+    for (int i = 0; i < n; ++i) {
+        t.push_back(Eigen::Triplet<double>(i, i, 1.0 + i));
+        t.push_back(Eigen::Triplet<double>(i, (i + 5) % n, -0.5*i));
+    }
+    Sp s(n, n);
+    s.setFromTriplets(t.begin(), t.end());
+    const Eigen::VectorXd d = Eigen::VectorXd::LinSpaced(n, 2.0, 3.0);
+    const Eigen::DiagonalMatrix<double, Eigen::Dynamic> dm(d);
+
+    const Opm::AutoDiffMatrix sum = Opm::AutoDiffMatrix(s) + Opm::AutoDiffMatrix(dm);
+    Sp result;
+    sum.toSparse(result);
+    const Eigen::MatrixXd ref = Eigen::MatrixXd(s) + Eigen::MatrixXd(d.asDiagonal());
+    BOOST_CHECK_EQUAL((Eigen::MatrixXd(result) - ref).norm(), 0.0);
+    BOOST_CHECK_EQUAL(result.nonZeros(), s.nonZeros());
+
+    // A pattern without full diagonal takes the general path.
+    Sp offdiag(n, n);
+    offdiag.insert(0, 1) = 1.0;
+    offdiag.makeCompressed();
+    const Opm::AutoDiffMatrix sum2 = Opm::AutoDiffMatrix(offdiag) + Opm::AutoDiffMatrix(dm);
+    sum2.toSparse(result);
+    const Eigen::MatrixXd ref2 = Eigen::MatrixXd(offdiag) + Eigen::MatrixXd(d.asDiagonal());
+    BOOST_CHECK_EQUAL((Eigen::MatrixXd(result) - ref2).norm(), 0.0);
+}
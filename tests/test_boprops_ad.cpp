@@ -210,3 +210,48 @@ BOOST_FIXTURE_TEST_CASE(criticalSaturations, TestFixture<SetupSimple>)
     BOOST_CHECK_EQUAL(sogcr[0], 0.13);
 
 }
+
+BOOST_FIXTURE_TEST_CASE(TabulatedPvt, TestFixture<SetupSimple>)
+{
+    const Opm::BlackoilPropsAdFromDeck::Cells cells(5, 0);
+
+    typedef Opm::BlackoilPropsAdFromDeck::V V;
+    typedef Opm::BlackoilPropsAdFromDeck::ADB ADB;
+
+    V Vpw;
+    Vpw.resize(cells.size());
+    Vpw[0] =   3*Opm::unit::barsa;
+    Vpw[1] =  17*Opm::unit::barsa;
+    Vpw[2] =  55*Opm::unit::barsa;
+    Vpw[3] = 120*Opm::unit::barsa;
+    Vpw[4] = 900*Opm::unit::barsa; // outside the tabulated range
+
+    // standard temperature
+    V T = V::Constant(cells.size(), 273.15+20);
+
+    const ADB pw = ADB::constant(Vpw);
+    const ADB AT = ADB::constant(T);
+    const V bWat  = boprops_ad.bWat (pw, AT, cells).value();
+    const V muWat = boprops_ad.muWat(pw, AT, cells).value();
+
+    boprops_ad.tabulatePvt(200, 1.0*Opm::unit::barsa, 500.0*Opm::unit::barsa);
+
+    const V bWatTab  = boprops_ad.bWat (pw, AT, cells).value();
+    const V muWatTab = boprops_ad.muWat(pw, AT, cells).value();
+
+    for (V::Index i = 0, n = Vpw.size(); i < n; ++i) {
+        BOOST_CHECK_CLOSE(bWatTab[i],  bWat[i],  1.0e-6);
+        BOOST_CHECK_CLOSE(muWatTab[i], muWat[i], 1.0e-6);
+    }
+    BOOST_CHECK_EQUAL(bWatTab[4], bWat[4]);
+
+    // the tables are only used at the temperature they were built for
+    const ADB AT2 = ADB::constant(V::Constant(cells.size(), 273.15+50));
+    boprops_ad.tabulatePvt(0, 0.0, 0.0);
+    const V bWat2 = boprops_ad.bWat(pw, AT2, cells).value();
+    boprops_ad.tabulatePvt(200, 1.0*Opm::unit::barsa, 500.0*Opm::unit::barsa);
+    const V bWat2Tab = boprops_ad.bWat(pw, AT2, cells).value();
+    for (V::Index i = 0, n = Vpw.size(); i < n; ++i) {
+        BOOST_CHECK_EQUAL(bWat2Tab[i], bWat2[i]);
+    }
+}
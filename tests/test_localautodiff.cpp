@@ -0,0 +1,121 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_MODULE LocalAutoDiffTest
+
+#include <opm/autodiff/LocalAutoDiff.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using namespace Opm;
+
+namespace
+{
+    typedef AutoDiffBlock<double> ADB;
+
+    // Two cell blocks of size n and a well block of size 2.
+    std::vector<ADB> cellVariables(const int n)
+    {
+        std::vector<ADB::V> initial;
+        initial.push_back(ADB::V::LinSpaced(n, 100.0, 200.0));
+        initial.push_back(ADB::V::LinSpaced(n, 0.1, 0.9));
+        initial.push_back(ADB::V::Constant(2, 150.0));
+        return ADB::variables(initial);
+    }
+
+    void checkEqual(const ADB& x, const ADB& y)
+    {
+        BOOST_REQUIRE_EQUAL(x.size(), y.size());
+        BOOST_CHECK_SMALL((x.value() - y.value()).abs().maxCoeff(), 1e-12);
+        BOOST_REQUIRE(x.blockPattern() == y.blockPattern());
+        for (int block = 0; block < x.numBlocks(); ++block) {
+            Eigen::SparseMatrix<double> jx, jy;
+            x.derivative()[block].toSparse(jx);
+            y.derivative()[block].toSparse(jy);
+            BOOST_CHECK_SMALL((Eigen::MatrixXd(jx) - Eigen::MatrixXd(jy)).norm(), 1e-12);
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(ProductMatchesAutoDiffBlock)
+{
+    const int n = 5;
+    const std::vector<ADB> vars = cellVariables(n);
+    const ADB& p = vars[0];
+    const ADB& s = vars[1];
+    const ADB x = p * s + p;
+    const ADB c = ADB::constant(ADB::V::Constant(n, 3.0));
+
+    const LocalAutoDiff local({ &p, &x, &c, nullptr });
+    BOOST_REQUIRE(local.valid());
+    BOOST_CHECK_EQUAL(local.numCells(), n);
+    BOOST_CHECK(local[3].empty());
+
+    LocalAutoDiff::Vector y(n);
+    for (int i = 0; i < n; ++i) {
+        y[i] = local[0][i] * local[1][i] + local[2][i];
+    }
+    checkEqual(local.toAutoDiffBlock(y), p * x + c);
+}
+
+
+BOOST_AUTO_TEST_CASE(ConstantInputs)
+{
+    const ADB c = ADB::constant(ADB::V::Constant(4, 2.0));
+    const LocalAutoDiff local({ &c });
+    BOOST_REQUIRE(local.valid());
+    const ADB y = local.toAutoDiffBlock(local[0]);
+    BOOST_CHECK(y.derivative().empty());
+    BOOST_CHECK((y.value() == c.value()).all());
+}
+
+
+BOOST_AUTO_TEST_CASE(NonLocalInputs)
+{
+    const int n = 4;
+    const std::vector<ADB> vars = cellVariables(n);
+
+    // Couples neighbouring cells.
+    Eigen::SparseMatrix<double> shift(n, n);
+    for (int i = 0; i + 1 < n; ++i) {
+        shift.insert(i, i + 1) = 1.0;
+    }
+    const ADB x = ADB::M(shift) * vars[0];
+    BOOST_CHECK(!LocalAutoDiff({ &x }).valid());
+
+    // Depends on the well variables.
+    Eigen::SparseMatrix<double> perf(n, 2);
+    perf.insert(0, 0) = 1.0;
+    perf.insert(n - 1, 1) = 1.0;
+    const ADB w = ADB::M(perf) * vars[2];
+    BOOST_CHECK(!LocalAutoDiff({ &w }).valid());
+
+    // Inputs of different sizes.
+    BOOST_CHECK(!LocalAutoDiff({ &vars[0], &vars[2] }).valid());
+}
@@ -39,6 +39,7 @@
 #include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
 #include <opm/parser/eclipse/Deck/Deck.hpp>
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
 
@@ -146,6 +147,71 @@ BOOST_AUTO_TEST_CASE(PMISC)
         BOOST_CHECK_EQUAL(pmisc[2], 1.0);
 }
 
+BOOST_AUTO_TEST_CASE(PMISC_RESAMPLED)
+{
+        Opm::ParseContext parseContext;
+        Opm::Parser parser;
+        auto deck = parser.parseString(deckData + solventData + pmiscData, parseContext);
+        Opm::EclipseState eclState(deck , parseContext);
+        const Opm::SolventPropsAdFromDeck::Cells cells(3, 0);
+        typedef Opm::SolventPropsAdFromDeck::V V;
+        std::vector<int> global_ind = {0 , 1 , 2};
+        Opm::SolventPropsAdFromDeck solventprops(deck, eclState, 3, global_ind.data(), 1000);
+        V po(3);
+        po << 150,250,550;
+        po = po * Opm::unit::barsa;
+        V pmisc = solventprops.pressureMiscibilityFunction(Opm::SolventPropsAdFromDeck::ADB::constant(po), cells).value();
+        BOOST_REQUIRE_EQUAL(pmisc.size(), cells.size());
+        // The lookup values are away from the kinks of the table, so
+        // the resampled table is exact there.
+        const double tol = 1e-8;
+        BOOST_CHECK_SMALL(pmisc[0], tol);
+        BOOST_CHECK_CLOSE(pmisc[1], (250.0 - 200.0) / (500.0 - 200.0), tol);
+        BOOST_CHECK_CLOSE(pmisc[2], 1.0, tol);
+}
+
+BOOST_AUTO_TEST_CASE(ResampledTable)
+{
+        const std::vector<double> x = {0.0, 0.15, 0.5, 1.0};
+        const std::vector<double> y = {0.0, 0.3, 0.4, 1.0};
+        Opm::ResampledTableLinear table(x, y);
+        const Opm::ResampledTableLinear original(x, y);
+
+        // 0.15 is not on the grid of 11 points, the error is the distance
+        // of the interpolated value at 0.15 from the kink.
+        const double error = table.resample(11);
+        BOOST_CHECK(table.isResampled());
+        BOOST_CHECK_EQUAL(table.numResampledPoints(), 11);
+        const double interpolated = 0.2 + 0.5 * (original(0.2) - 0.2);
+        BOOST_CHECK_CLOSE(error, std::fabs(interpolated - 0.3), 1e-10);
+
+        // Exact on the grid points and on linear parts of the table,
+        // and linear extrapolation outside of it.
+        const double tol = 1e-10;
+        BOOST_CHECK_CLOSE(table(0.4), original(0.4), tol);
+        BOOST_CHECK_CLOSE(table(0.75), original(0.75), tol);
+        BOOST_CHECK_CLOSE(table.derivative(0.75), 1.2, tol);
+        BOOST_CHECK_CLOSE(table(1.0), 1.0, tol);
+        BOOST_CHECK_CLOSE(table(1.5), original(1.5), tol);
+        BOOST_CHECK_CLOSE(table(-0.5), original(-0.5), tol);
+        BOOST_CHECK_CLOSE(table.derivative(-0.5), 2.0, tol);
+
+        // Batched evaluation agrees with the single lookups.
+        const std::vector<double> xs = {-0.5, 0.0, 0.13, 0.4, 0.75, 1.0, 1.5};
+        std::vector<double> ys(xs.size());
+        std::vector<double> dys(xs.size());
+        table.evaluate(xs.data(), ys.data(), dys.data(), xs.size());
+        for (std::size_t i = 0; i < xs.size(); ++i) {
+                BOOST_CHECK_EQUAL(ys[i], table(xs[i]));
+                BOOST_CHECK_EQUAL(dys[i], table.derivative(xs[i]));
+        }
+
+        // Back to the original table.
+        BOOST_CHECK_EQUAL(table.resample(0), 0.0);
+        BOOST_CHECK(!table.isResampled());
+        BOOST_CHECK_EQUAL(table(0.15), 0.3);
+}
+
 const std::string tlpmixpaData = "\n\
 TLPMIXPA\n\
 100 0.0 \n\
@@ -0,0 +1,171 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_MODULE SparseProductCacheTest
+
+#include <opm/autodiff/SparseProductCache.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    typedef Eigen::SparseMatrix<double> Sp;
+
+    // Gradient-like operator of a 1D grid with n cells.
+    Sp gradient(const int n)
+    {
+        std::vector<Eigen::Triplet<double>> t;
+        for (int f = 0; f < n - 1; ++f) {
+            t.push_back(Eigen::Triplet<double>(f, f, -1.0));
+            t.push_back(Eigen::Triplet<double>(f, f + 1, 1.0));
+        }
+        Sp g(n - 1, n);
+        g.setFromTriplets(t.begin(), t.end());
+        return g;
+    }
+
+    // Tridiagonal jacobian whose values depend on seed.
+    Sp jacobian(const int n, const double seed)
+    {
+        std::vector<Eigen::Triplet<double>> t;
+        for (int i = 0; i < n; ++i) {
+            for (int j = std::max(0, i - 1); j <= std::min(n - 1, i + 1); ++j) {
+                t.push_back(Eigen::Triplet<double>(i, j, std::sin(seed + 3*i + j)));
+            }
+        }
+        Sp jac(n, n);
+        jac.setFromTriplets(t.begin(), t.end());
+        return jac;
+    }
+
+    double maxDifference(const Sp& a, const Sp& b)
+    {
+        return (Eigen::MatrixXd(a) - Eigen::MatrixXd(b)).cwiseAbs().maxCoeff();
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(MatchesEigenProduct)
+{
+    const int n = 50;
+    Opm::SparseProductCache cache;
+    const Sp grad = gradient(n);
+
+    for (int iteration = 0; iteration < 5; ++iteration) {
+        const Sp jac = jacobian(n, iteration);
+        Sp res;
+        cache.multiply(grad, jac, res);
+        const Sp ref = grad * jac;
+        BOOST_CHECK_EQUAL(res.rows(), ref.rows());
+        BOOST_CHECK_EQUAL(res.cols(), ref.cols());
+        BOOST_CHECK_SMALL(maxDifference(res, ref), 1e-14);
+    }
+    BOOST_CHECK_EQUAL(cache.misses(), 1u);
+    BOOST_CHECK_EQUAL(cache.hits(), 4u);
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+}
+
+
+BOOST_AUTO_TEST_CASE(ZeroProductsAreDropped)
+{
+    const int n = 20;
+    Opm::SparseProductCache cache;
+    const Sp grad = gradient(n);
+
+    // Zero out every other column, such that some entries of the
+    // structural pattern of the result only receive zero products.
+    Sp jac = jacobian(n, 0.0);
+    for (int j = 0; j < n; j += 2) {
+        for (Sp::InnerIterator it(jac, j); it; ++it) {
+            it.valueRef() = 0.0;
+        }
+    }
+    for (int iteration = 0; iteration < 2; ++iteration) {
+        Sp res, ref;
+        cache.multiply(grad, jac, res);
+        Opm::fastSparseProduct(grad, jac, ref);
+        BOOST_CHECK_EQUAL(res.nonZeros(), ref.nonZeros());
+        BOOST_CHECK_EQUAL(maxDifference(res, ref), 0.0);
+    }
+    BOOST_CHECK_EQUAL(cache.hits(), 1u);
+
+    // The cached pattern still covers the entries that were dropped.
+    const Sp full = jacobian(n, 1.0);
+    Sp res, ref;
+    cache.multiply(grad, full, res);
+    Opm::fastSparseProduct(grad, full, ref);
+    BOOST_CHECK_EQUAL(cache.hits(), 2u);
+    BOOST_CHECK_EQUAL(res.nonZeros(), ref.nonZeros());
+    BOOST_CHECK_EQUAL(maxDifference(res, ref), 0.0);
+}
+
+
+BOOST_AUTO_TEST_CASE(DifferentPatternsAndEviction)
+{
+    // Bytes of the patterns for n = 12 and n = 13.
+    std::size_t capacity = 0;
+    for (int n = 12; n < 14; ++n) {
+        Opm::SparseProductCache probe;
+        Sp res;
+        probe.multiply(gradient(n), jacobian(n, n), res);
+        capacity += probe.bytes();
+    }
+
+    Opm::SparseProductCache cache(capacity);
+    for (int n = 10; n < 14; ++n) {
+        const Sp grad = gradient(n);
+        const Sp jac = jacobian(n, n);
+        Sp res;
+        cache.multiply(grad, jac, res);
+        BOOST_CHECK_SMALL(maxDifference(res, grad * jac), 1e-14);
+        BOOST_CHECK(cache.bytes() <= capacity);
+    }
+    BOOST_CHECK_EQUAL(cache.misses(), 4u);
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+
+    // The pattern for n = 13 is still cached, the one for n = 10 is not.
+    const Sp grad = gradient(13);
+    Sp res;
+    cache.multiply(grad, jacobian(13, 0.5), res);
+    BOOST_CHECK_EQUAL(cache.hits(), 1u);
+    cache.multiply(gradient(10), jacobian(10, 0.5), res);
+    BOOST_CHECK_EQUAL(cache.misses(), 5u);
+
+    // A pattern larger than the capacity is not cached.
+    cache.setCapacity(1);
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+    cache.multiply(grad, jacobian(13, 0.5), res);
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+    BOOST_CHECK_SMALL(maxDifference(res, grad * jacobian(13, 0.5)), 1e-14);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+    BOOST_CHECK_EQUAL(cache.bytes(), 0u);
+    BOOST_CHECK_EQUAL(cache.hits(), 0u);
+}
@@ -27,6 +27,8 @@
 #define BOOST_TEST_MODULE AutoDiffBlockTest
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <memory>
 #include <map>
 #include <sstream>
@@ -108,6 +110,25 @@ BOOST_AUTO_TEST_CASE(findInterpData)
     BOOST_CHECK_EQUAL(eval5.factor_, 1.0);
 }
 
+BOOST_AUTO_TEST_CASE(findInterpDataHint)
+{
+    std::vector<double> values = {1, 5, 7, 9, 11, 15};
+    std::vector<double> lookups = {9.0, 6.0, -1.0, 19.0, 1.0, 15.0, 8.5, 12.0, 7.0, 5.0};
+
+    //A hint gives the same result as a plain search, whether it is right or wrong
+    for (int start=-1; start<=7; ++start) {
+        int hint = start;
+        for (double value : lookups) {
+            Opm::detail::InterpData plain = Opm::detail::findInterpData(value, values);
+            Opm::detail::InterpData hinted = Opm::detail::findInterpData(value, values, hint);
+            BOOST_CHECK_EQUAL(hinted.ind_[0], plain.ind_[0]);
+            BOOST_CHECK_EQUAL(hinted.ind_[1], plain.ind_[1]);
+            BOOST_CHECK_EQUAL(hinted.factor_, plain.factor_);
+            BOOST_CHECK_EQUAL(hint, plain.ind_[1]);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END() // HelperTests
 
 
@@ -943,6 +964,176 @@ BOOST_AUTO_TEST_CASE(PartialDerivatives)
 
 
 
+/**
+ * Evenly spread lookup points covering the axes of the table and a bit
+ * outside of them, one InterpData per axis in the order flo, thp, wfr, gfr, alq
+ */
+std::vector<Opm::detail::InterpData> lookupPoints(const Opm::VFPProdTable& table, const int n) {
+    const std::vector<double>* axes[5] = { &table.getFloAxis(), &table.getTHPAxis(),
+            &table.getWFRAxis(), &table.getGFRAxis(), &table.getALQAxis() };
+    std::vector<Opm::detail::InterpData> retval;
+    for (int i=0; i<n; ++i) {
+        for (int d=0; d<5; ++d) {
+            const std::vector<double>& axis = *axes[d];
+            //Golden ratio sequence, shifted per axis
+            const double s = std::fmod(0.618033988749895*(i+1)*(d+1), 1.0);
+            const double value = axis.front() - 0.1 + s*(axis.back() - axis.front() + 0.2);
+            retval.push_back(Opm::detail::findInterpData(value, axis));
+        }
+    }
+    return retval;
+}
+
+
+
+/**
+ * Test that the prepared table interpolates like detail::interpolate
+ */
+BOOST_AUTO_TEST_CASE(PreparedTable)
+{
+    fillDataRandom();
+    initProperties();
+
+    const Opm::detail::PreparedVFPTable prepared(table);
+    const int n = 1000;
+    const std::vector<Opm::detail::InterpData> points = lookupPoints(table, n);
+
+    VFPEvaluation max_d;
+    for (int i=0; i<n; ++i) {
+        const Opm::detail::InterpData* p = &points[5*i];
+        const VFPEvaluation reference = Opm::detail::interpolate(table.getTable(), p[0], p[1], p[2], p[3], p[4]);
+        const VFPEvaluation actual = prepared.interpolate(p[0], p[1], p[2], p[3], p[4]);
+        max_d.value = std::max(max_d.value, std::abs(actual.value - reference.value));
+        max_d.dthp = std::max(max_d.dthp, std::abs(actual.dthp - reference.dthp));
+        max_d.dwfr = std::max(max_d.dwfr, std::abs(actual.dwfr - reference.dwfr));
+        max_d.dgfr = std::max(max_d.dgfr, std::abs(actual.dgfr - reference.dgfr));
+        max_d.dalq = std::max(max_d.dalq, std::abs(actual.dalq - reference.dalq));
+        max_d.dflo = std::max(max_d.dflo, std::abs(actual.dflo - reference.dflo));
+    }
+
+    BOOST_CHECK_SMALL(max_d.value, max_d_tol);
+    BOOST_CHECK_SMALL(max_d.dthp, max_d_tol);
+    BOOST_CHECK_SMALL(max_d.dwfr, max_d_tol);
+    BOOST_CHECK_SMALL(max_d.dgfr, max_d_tol);
+    BOOST_CHECK_SMALL(max_d.dalq, max_d_tol);
+    BOOST_CHECK_SMALL(max_d.dflo, max_d_tol);
+}
+
+
+
+/**
+ * Microbenchmark of detail::interpolate against the prepared table
+ */
+BOOST_AUTO_TEST_CASE(PreparedTableTiming)
+{
+    fillDataRandom();
+    initProperties();
+
+    const Opm::detail::PreparedVFPTable prepared(table);
+    const int n = 10000;
+    const int repeats = 50;
+    const std::vector<Opm::detail::InterpData> points = lookupPoints(table, n);
+
+    typedef std::chrono::steady_clock Clock;
+    double sum_reference = 0.0;
+    double sum_prepared = 0.0;
+    const auto t0 = Clock::now();
+    for (int r=0; r<repeats; ++r) {
+        for (int i=0; i<n; ++i) {
+            const Opm::detail::InterpData* p = &points[5*i];
+            sum_reference += Opm::detail::interpolate(table.getTable(), p[0], p[1], p[2], p[3], p[4]).dflo;
+        }
+    }
+    const auto t1 = Clock::now();
+    for (int r=0; r<repeats; ++r) {
+        for (int i=0; i<n; ++i) {
+            const Opm::detail::InterpData* p = &points[5*i];
+            sum_prepared += prepared.interpolate(p[0], p[1], p[2], p[3], p[4]).dflo;
+        }
+    }
+    const auto t2 = Clock::now();
+
+    const double reference = std::chrono::duration<double>(t1 - t0).count() / (repeats*n);
+    const double actual = std::chrono::duration<double>(t2 - t1).count() / (repeats*n);
+    BOOST_TEST_MESSAGE("VFP interpolation: detail::interpolate " << reference*1e9
+                       << " ns, prepared table " << actual*1e9 << " ns");
+    BOOST_CHECK_SMALL(sum_prepared - sum_reference, 1e-6);
+}
+
+
+
+/**
+ * Test that the batched bhp gives the same values as one call per well
+ */
+BOOST_AUTO_TEST_CASE(BatchedBHP)
+{
+    fillDataRandom();
+    initProperties();
+
+    const int nw = 7;
+    std::vector<int> ids(nw, 1);
+    ids[3] = -1;
+    std::vector<double> aqua(nw), liquid(nw), vapour(nw), thp(nw), alq(nw);
+    for (int i=0; i<nw; ++i) {
+        aqua[i] = -0.1 - 0.15*i;
+        liquid[i] = -0.9 + 0.1*i;
+        vapour[i] = -0.05*i;
+        thp[i] = 0.2*i - 0.1;
+        alq[i] = 0.13*i;
+    }
+
+    std::vector<Opm::VFPProdProperties::InterpHint> hints;
+    //Twice, so that the second call uses the hints of the first
+    for (int iter=0; iter<2; ++iter) {
+        const std::vector<double> bhp = properties->bhp(ids, aqua, liquid, vapour, thp, alq, hints);
+        BOOST_REQUIRE_EQUAL(static_cast<int>(bhp.size()), nw);
+        BOOST_REQUIRE_EQUAL(static_cast<int>(hints.size()), nw);
+        for (int i=0; i<nw; ++i) {
+            if (ids[i] < 0) {
+                BOOST_CHECK_EQUAL(bhp[i], -1e100);
+            }
+            else {
+                BOOST_CHECK_EQUAL(bhp[i], properties->bhp(ids[i], aqua[i], liquid[i], vapour[i], thp[i], alq[i]));
+            }
+        }
+        for (int i=0; i<nw; ++i) {
+            thp[i] += 0.01;
+        }
+    }
+}
+
+
+
+/**
+ * Test that bhp and thp give the same values with and without hints
+ */
+BOOST_AUTO_TEST_CASE(HintedBHPAndTHP)
+{
+    fillDataPlane();
+    initProperties();
+
+    const double aqua = -0.05;
+    const double vapour = -0.01;
+
+    Opm::VFPProdProperties::InterpHint hint;
+    //Moves slowly through the table, so that some lookups hit the
+    //hinted intervals and others do not
+    for (int i=0; i<20; ++i) {
+        const double liquid = -0.1 - 0.04*i;
+        const double thp = 0.05 + 0.04*i;
+        const double alq = 0.02 + 0.045*i;
+
+        const double bhp = properties->bhp(1, aqua, liquid, vapour, thp, alq, hint);
+        BOOST_CHECK_EQUAL(bhp, properties->bhp(1, aqua, liquid, vapour, thp, alq));
+
+        const double thp_val = properties->thp(1, aqua, liquid, vapour, bhp, alq, hint);
+        BOOST_CHECK_EQUAL(thp_val, properties->thp(1, aqua, liquid, vapour, bhp, alq));
+        BOOST_CHECK_CLOSE(thp_val, thp, max_d_tol);
+    }
+}
+
+
+
 BOOST_AUTO_TEST_CASE(THPToBHPAndBackPlane)
 {
     fillDataPlane();
@@ -0,0 +1,380 @@
+/*
+  Copyright 2017 Statoil ASA.
+
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <config.h>
+
+#if HAVE_DYNAMIC_BOOST_TEST
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_MODULE WellBlockMatrixTest
+
+#include <opm/autodiff/WellBlockMatrix.hpp>
+#include <opm/autodiff/FusedWellMatrixProduct.hpp>
+#include <opm/autodiff/StandardWellsDense.hpp>
+#include <opm/autodiff/BlackoilPropsAdFromDeck.hpp>
+
+#include <opm/common/utility/platform_dependent/disable_warnings.h>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <opm/common/utility/platform_dependent/reenable_warnings.h>
+
+#include <opm/core/grid/GridManager.hpp>
+#include <opm/core/wells.h>
+#include <opm/material/fluidsystems/BlackOilFluidSystem.hpp>
+#include <opm/parser/eclipse/Parser/Parser.hpp>
+#include <opm/parser/eclipse/Parser/ParseContext.hpp>
+#include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
+#include <opm/parser/eclipse/Deck/Deck.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const int blocksize = 3;
+    typedef Dune::FieldVector<double, blocksize> VectorBlock;
+    typedef Dune::FieldMatrix<double, blocksize, blocksize> MatrixBlock;
+    typedef Dune::BCRSMatrix<MatrixBlock> Mat;
+    typedef Dune::BlockVector<VectorBlock> BVector;
+    typedef Opm::WellBlockMatrix<double, blocksize> WellBlocks;
+
+    // Well matrices in the layout of StandardWellsDense, well w
+    // perforating perfs[w] consecutive cells.
+    struct WellMatrices
+    {
+        WellMatrices(const int nc, const std::vector<int>& perfs)
+            : B(perfs.size(), nc, numPerforations(perfs), Mat::row_wise),
+              C(perfs.size(), nc, numPerforations(perfs), Mat::row_wise),
+              invD(perfs.size(), perfs.size(), perfs.size(), Mat::row_wise)
+        {
+            const int nw = perfs.size();
+            const int spacing = nc / nw;
+            for (auto row = B.createbegin(); row != B.createend(); ++row) {
+                for (int p = 0; p < perfs[row.index()]; ++p) row.insert(row.index()*spacing + p);
+            }
+            for (auto row = C.createbegin(); row != C.createend(); ++row) {
+                for (int p = 0; p < perfs[row.index()]; ++p) row.insert(row.index()*spacing + p);
+            }
+            for (auto row = invD.createbegin(); row != invD.createend(); ++row) {
+                row.insert(row.index());
+            }
+
+            fill(B, 0.5);
+            fill(C, 0.25);
+            fill(invD, 2.0);
+            blocks.assign(B, C, invD);
+
+            Cx.resize(nw);
+            invDCx.resize(nw);
+        }
+
+        static int numPerforations(const std::vector<int>& perfs)
+        {
+            int nperf = 0;
+            for (const int p : perfs) {
+                nperf += p;
+            }
+            return nperf;
+        }
+
+        static void fill(Mat& M, const double scale)
+        {
+            for (auto row = M.begin(); row != M.end(); ++row) {
+                for (auto col = row->begin(); col != row->end(); ++col) {
+                    for (int i = 0; i < blocksize; ++i) {
+                        for (int j = 0; j < blocksize; ++j) {
+                            (*col)[i][j] = scale * std::sin(1.0 + row.index() + 3*col.index() + 5*i + 7*j);
+                        }
+                    }
+                }
+            }
+        }
+
+        // y += alpha * B^T inv(D) C x with the sparse matrices
+        void usmvSparse(const double alpha, const BVector& x, BVector& y)
+        {
+            C.mv(x, Cx);
+            invD.mv(Cx, invDCx);
+            B.usmtv(alpha, invDCx, y);
+        }
+
+        Mat B, C, invD;
+        WellBlocks blocks;
+        BVector Cx, invDCx;
+    };
+
+    BVector makeVector(const int n)
+    {
+        BVector x(n);
+        for (int i = 0; i < n; ++i) {
+            for (int k = 0; k < blocksize; ++k) {
+                x[i][k] = std::cos(0.5 + i + 11*k);
+            }
+        }
+        return x;
+    }
+
+    double maxDifference(const BVector& a, const BVector& b)
+    {
+        BVector diff(a);
+        diff -= b;
+        return diff.infinity_norm();
+    }
+
+    // Primary variables in the order of the Ebos black-oil model.
+    struct Indices
+    {
+        enum { waterSaturationIdx = 0, pressureSwitchIdx = 1, compositionSwitchIdx = 2 };
+    };
+
+    typedef Opm::StandardWellsDense<Opm::FluidSystems::BlackOil<double>, Indices> StandardWells;
+
+    // Gives access to the well matrices. Assembling them needs an Ebos
+    // simulator, so they are filled with test values instead.
+    class TestWellModel : public StandardWells
+    {
+    public:
+        TestWellModel(const Wells* wells, const std::vector<double>& pv)
+            : StandardWells(wells, Opm::BlackoilModelParameters(), false, pv)
+        {
+        }
+
+        void fillMatrices()
+        {
+            WellMatrices::fill(duneB_, 0.5);
+            WellMatrices::fill(duneC_, 0.25);
+            WellMatrices::fill(invDuneD_, 2.0);
+            updateWellBlocks();
+        }
+
+        // y += alpha * B^T inv(D) C x with the sparse matrices
+        void usmvSparse(const double alpha, const BVector& x, BVector& y) const
+        {
+            BVector Cx(duneC_.N());
+            BVector invDCx(invDuneD_.N());
+            duneC_.mv(x, Cx);
+            invDuneD_.mv(Cx, invDCx);
+            duneB_.usmtv(alpha, invDCx, y);
+        }
+    };
+
+    // Reservoir matrix of a 1D grid of nc cells plus a well model with
+    // a producer perforating the cells 0, ..., 10 and an injector
+    // perforating 8, ..., 12, such that the wells share perforated cells.
+    struct WellModelFixture
+    {
+        WellModelFixture()
+            : deck(Opm::Parser{}.parseFile("fluid.data")),
+              eclState(deck, Opm::ParseContext()),
+              grid(eclState.getInputGrid()),
+              props(deck, eclState, *grid.c_grid(), false),
+              wells(create_wells(3, 2, 16), destroy_wells),
+              active(3, true),
+              pv(nc, 1.0),
+              depth(nc, 0.0),
+              A(nc, nc, 3*nc - 2, Mat::row_wise)
+        {
+            for (auto row = A.createbegin(); row != A.createend(); ++row) {
+                const int i = row.index();
+                if (i > 0) row.insert(i - 1);
+                row.insert(i);
+                if (i < nc - 1) row.insert(i + 1);
+            }
+            WellMatrices::fill(A, 1.0);
+
+            const std::vector<int> producerCells = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+            const std::vector<int> injectorCells = { 8, 9, 10, 11, 12 };
+            const double compFrac[3] = { 1.0, 0.0, 0.0 };
+            BOOST_REQUIRE(add_well(PRODUCER, 0.0, producerCells.size(), compFrac, producerCells.data(),
+                                   nullptr, "PROD", true, wells.get()));
+            BOOST_REQUIRE(add_well(INJECTOR, 0.0, injectorCells.size(), compFrac, injectorCells.data(),
+                                   nullptr, "INJ", true, wells.get()));
+
+            model.reset(new TestWellModel(wells.get(), pv));
+            model->init(&props, &active, nullptr, 9.81, depth, pv);
+            model->fillMatrices();
+        }
+
+        // y = A x - B^T inv(D) C x with separate products
+        void applySeparate(const BVector& x, BVector& y)
+        {
+            A.mv(x, y);
+            model->usmvSparse(-1.0, x, y);
+        }
+
+        // y = A x - B^T inv(D) C x, or y += alpha * (A x - B^T inv(D) C x),
+        // in a single pass over A
+        void applyFused(const BVector& x, BVector& y, const double alpha, const bool overwrite)
+        {
+            model->computeWellContributions(x);
+            Opm::fusedWellMatrixProduct(A, x, y, model->perforatedCellIndex(),
+                                        model->wellContributions(), alpha, overwrite);
+        }
+
+        static const int nc = 20;
+        Opm::Deck deck;
+        Opm::EclipseState eclState;
+        Opm::GridManager grid;
+        Opm::BlackoilPropsAdFromDeck props;
+        std::shared_ptr<Wells> wells;
+        std::vector<bool> active;
+        std::vector<double> pv;
+        std::vector<double> depth;
+        Mat A;
+        std::unique_ptr<TestWellModel> model;
+    };
+}
+
+
+BOOST_AUTO_TEST_CASE(UsmvMatchesSparseProducts)
+{
+    const int nc = 200;
+    // Wells with one, exactly one chunk, several chunks and no perforations.
+    const std::vector<int> perfs = { 1, WellBlocks::chunkSize, 2*WellBlocks::chunkSize + 3, 0, 5 };
+    WellMatrices wells(nc, perfs);
+    BOOST_CHECK_EQUAL(wells.blocks.numWells(), int(perfs.size()));
+
+    const BVector x = makeVector(nc);
+    const double alpha = -0.7;
+    BVector yRef = makeVector(nc);
+    wells.usmvSparse(alpha, x, yRef);
+    BVector y = makeVector(nc);
+    wells.blocks.usmv(alpha, x, y);
+    BOOST_CHECK_SMALL(maxDifference(y, yRef), 1e-12);
+}
+
+
+BOOST_AUTO_TEST_CASE(UsmvPerforatedMatchesSparseProducts)
+{
+    const int nc = 100;
+    const std::vector<int> perfs = { 3, 12, 7 };
+    WellMatrices wells(nc, perfs);
+
+    std::vector<int> perforatedCellIndex(nc, -1);
+    int numPerforatedCells = 0;
+    for (auto row = wells.B.begin(); row != wells.B.end(); ++row) {
+        for (auto col = row->begin(); col != row->end(); ++col) {
+            perforatedCellIndex[col.index()] = numPerforatedCells++;
+        }
+    }
+
+    const BVector x = makeVector(nc);
+    BVector yRef(nc);
+    yRef = 0.0;
+    wells.usmvSparse(1.0, x, yRef);
+
+    BVector contributions(numPerforatedCells);
+    contributions = 0.0;
+    wells.blocks.usmvPerforated(1.0, x, contributions, perforatedCellIndex);
+    for (int cell = 0; cell < nc; ++cell) {
+        const int k = perforatedCellIndex[cell];
+        if (k < 0) {
+            BOOST_CHECK_EQUAL(yRef[cell].infinity_norm(), 0.0);
+        } else {
+            VectorBlock diff = contributions[k];
+            diff -= yRef[cell];
+            BOOST_CHECK_SMALL(diff.infinity_norm(), 1e-12);
+        }
+    }
+}
+
+
+BOOST_FIXTURE_TEST_CASE(WellModelApply, WellModelFixture)
+{
+    const BVector x = makeVector(nc);
+    BVector yRef = makeVector(nc);
+    model->usmvSparse(-1.0, x, yRef);
+    BVector y = makeVector(nc);
+    model->apply(x, y);
+    BOOST_CHECK_SMALL(maxDifference(y, yRef), 1e-12);
+}
+
+
+BOOST_FIXTURE_TEST_CASE(WellModelApplyScaleAdd, WellModelFixture)
+{
+    const double alpha = 0.3;
+    const BVector x = makeVector(nc);
+    BVector yRef = makeVector(nc);
+    model->usmvSparse(-alpha, x, yRef);
+    BVector y = makeVector(nc);
+    model->applyScaleAdd(alpha, x, y);
+    BOOST_CHECK_SMALL(maxDifference(y, yRef), 1e-12);
+}
+
+
+BOOST_FIXTURE_TEST_CASE(PerforatedCellIndex, WellModelFixture)
+{
+    const std::vector<int>& index = model->perforatedCellIndex();
+    BOOST_REQUIRE_EQUAL(index.size(), std::size_t(nc));
+    int numPerforatedCells = 0;
+    for (int cell = 0; cell < nc; ++cell) {
+        if (cell <= 12) {
+            BOOST_CHECK_EQUAL(index[cell], numPerforatedCells++);
+        } else {
+            BOOST_CHECK_EQUAL(index[cell], -1);
+        }
+    }
+    BOOST_CHECK_EQUAL(int(model->wellContributions().size()), numPerforatedCells);
+}
+
+
+BOOST_FIXTURE_TEST_CASE(FusedApplyMatchesSeparateProducts, WellModelFixture)
+{
+    const BVector x = makeVector(nc);
+
+    BVector yRef(nc), y(nc);
+    applySeparate(x, yRef);
+    y = 1.0;
+    applyFused(x, y, 1.0, true);
+    BOOST_CHECK_SMALL(maxDifference(y, yRef), 1e-12);
+}
+
+
+BOOST_FIXTURE_TEST_CASE(FusedScaleAddMatchesSeparateProducts, WellModelFixture)
+{
+    const double alpha = -0.7;
+    const BVector x = makeVector(nc);
+
+    BVector Ax(nc);
+    applySeparate(x, Ax);
+    BVector yRef = makeVector(nc);
+    yRef.axpy(alpha, Ax);
+
+    BVector y = makeVector(nc);
+    applyFused(x, y, alpha, false);
+    BOOST_CHECK_SMALL(maxDifference(y, yRef), 1e-12);
+}
+
+
+BOOST_FIXTURE_TEST_CASE(FusedNoWells, WellModelFixture)
+{
+    const BVector x = makeVector(nc);
+
+    BVector yRef(nc), y(nc);
+    A.mv(x, yRef);
+    Opm::fusedWellMatrixProduct(A, x, y, std::vector<int>(), BVector(), 1.0, true);
+    BOOST_CHECK_SMALL(maxDifference(y, yRef), 1e-12);
+}